@@ -42,6 +42,20 @@
 #include "VHDMultiSDRunAction.hh"
 #include "VHDMultiSDRunActionROOT.hh"
 #include "VHDMSDSteppingAction.hh"
+#include "VHDNumaMessenger.hh"
+#include "VHDNumaUtil.hh"
+
+#ifdef G4MULTITHREADED
+#include "VHDMTRunManager.hh"
+#include "VHDActionInitialization.hh"
+#include "VHDWorkerThreadInitialization.hh"
+#include "VHDWorkerInitialization.hh"
+#include "TROOT.h"
+#endif
+
+#ifndef G4MULTITHREADED
+#include "VHDForkRunner.hh"
+#endif
 
 #ifdef G4UI_USE
 #include "G4UIExecutive.hh"
@@ -65,14 +79,28 @@ int main(int argc,char **argv) {
   G4int photoneh = atoi(argv[9]);
   G4int isroot = atoi(argv[10]);
   G4int ebin = atoi(argv[11]);  //ebin == 0, use 25 energy bins; ebin == 1, use 28 energy bins
+  //argv[12] is the macro file (see below)
+  G4int nThreads = 0;  //number of worker threads (MT build only); 0 ==> Geant4 default or /run/numberOfThreads in the macro
+  if(argc > 13) nThreads = atoi(argv[13]);
   //===END OF READING INPUT PARAMETERS====
 
-  //choose a random number generator
+  //choose a random number generator (/VHDMSDv1/random/engine philox selects the counter-based engine)
   CLHEP::HepRandom::setTheEngine(new CLHEP::RanecuEngine);
 
   //--- Run manager ----//
+#ifdef G4MULTITHREADED
+  ROOT::EnableThreadSafety();  //the stepping actions fill ROOT histograms from every worker thread
+  VHDMTRunManager * runManager = new VHDMTRunManager;  //the workers pull adaptive chunks of events (see /VHDMSDv1/sched/)
+  if(nThreads > 0) runManager->SetNumberOfThreads(nThreads);
+  G4cout << "after the MT runmanager! nThreads = " << nThreads << G4endl;
+#else
   G4RunManager * runManager = new G4RunManager;
   G4cout << "after the runmanager!" << G4endl;
+#endif
+
+  //--- NUMA placement of the worker threads and voxel arrays (/VHDMSDv1/numa/) ----//
+  VHDNumaMessenger* numaMessenger = new VHDNumaMessenger;
+  VHDNumaUtil::PrintTopology();
 
   //--- Detector Definition ----//
   VHDDetectorConstruction* theGeometry = 0;   //'=0' indicates that theGeometry must be overriden by a derived class
@@ -96,19 +124,26 @@ int main(int argc,char **argv) {
   runManager->SetUserInitialization(new VHDPhysicsList);
   G4cout << "after the PhysicsList!" << G4endl;
 
-  //--- Primary Generation Definition ---//
-  G4String srcmpdirname = SRCMPdir + "/" + SRCMPname;
-  VHDPrimaryGeneratorAction* primgen = new VHDPrimaryGeneratorAction(srcmpdirname,isSRCMPsparse);
-  G4cout << "after the PrimaryGenerator!" << G4endl;
-  runManager->SetUserAction(primgen);
- 
-
   //Define data directory name
   size_t len;
   char datadrive[300];
   len = DATAdir.copy(datadrive,DATAdir.length(),0);
   datadrive[len] = '\0';
 
+  G4String srcmpdirname = SRCMPdir + "/" + SRCMPname;
+#ifdef G4MULTITHREADED
+  //--- the user actions are built per thread: the master gets the run action writing the merged output,
+  //--- each worker its own primary generator, stepping, event and run action
+  runManager->SetUserInitialization(new VHDActionInitialization(srcmpdirname,isSRCMPsparse,datadrive,isroot));
+  runManager->SetUserInitialization(new VHDWorkerThreadInitialization);  //worker engines (/VHDMSDv1/random/engine)
+  runManager->SetUserInitialization(new VHDWorkerInitialization);  //worker pinning (/VHDMSDv1/numa/pin)
+  G4cout << "after VHDActionInitialization!" << G4endl;
+#else
+  //--- Primary Generation Definition ---//
+  VHDPrimaryGeneratorAction* primgen = new VHDPrimaryGeneratorAction(srcmpdirname,isSRCMPsparse);
+  G4cout << "after the PrimaryGenerator!" << G4endl;
+  runManager->SetUserAction(primgen);
+
   //---- User-defined  SteppingAction ---//
   VHDMSDSteppingAction* step = new VHDMSDSteppingAction(datadrive);
   //step->SetMaterialOfInterest(geodirname);
@@ -132,6 +167,10 @@ int main(int argc,char **argv) {
   G4cout << "after VHDMultiSDRunAction!" << G4endl;
   //=====================================================================
 
+  //---- fork-after-initialization mode (/VHDMSDv1/fork/beamOn in the macro) ----//
+  VHDForkRunner* forkRunner = new VHDForkRunner(run,step);
+#endif
+
   //initialize RunManager in the macro I131_EMPhysics2.mac instead of here in the code
   //runManager->Initialize();  //Initialize G4 kernel
   //G4cout << "after Initialize runManager for the 1st time!" << G4endl;
@@ -153,7 +192,11 @@ int main(int argc,char **argv) {
   G4cout << "It took " << diffT << " seconds to complete this execution!" << G4endl;
   G4cout << "W00t! Finish this VoxelizedHumanDoseMultiSDv1 simulation!" << G4endl;
 
+#ifndef G4MULTITHREADED
+  delete forkRunner;
+#endif
   delete runManager;
+  delete numaMessenger;
 
   return 0;
 }
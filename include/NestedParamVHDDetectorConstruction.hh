@@ -15,6 +15,9 @@ public:
 private:
 
   virtual void ConstructPhantom();
+  virtual void ConstructMultiSensDet();
+  virtual G4bool SupportsRunLookup() const {return true;}
+  virtual G4bool SupportsCompactIndices() const {return true;}
   VHDNestedPhantomParameterisation* param;
 
 };
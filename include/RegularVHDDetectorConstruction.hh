@@ -43,6 +43,7 @@ public:
 private:
 
   virtual void ConstructPhantom();
+  virtual void ConstructMultiSensDet();
 
 };
 
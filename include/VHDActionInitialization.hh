@@ -0,0 +1,32 @@
+#ifndef VHDActionInitialization_h
+#define VHDActionInitialization_h 1
+
+#ifdef G4MULTITHREADED
+
+#include "G4VUserActionInitialization.hh"
+#include "globals.hh"
+
+class VHDPrimaryGeneratorAction;
+
+//Build the user actions for the master and each worker thread (multi-threaded mode only)
+// - the master only gets a run action, which merges the worker runs and writes the output files
+// - each worker gets its own primary generator, stepping, event and run action
+// - the source probability map is read once here and shared read-only by all the workers
+class VHDActionInitialization : public G4VUserActionInitialization
+{
+  public:
+    VHDActionInitialization(const G4String& srcmpdirname, G4int isSparse, char dname[], G4int isroot);
+    virtual ~VHDActionInitialization();
+
+    virtual void BuildForMaster() const;
+    virtual void Build() const;
+
+  private:
+    VHDPrimaryGeneratorAction* fMasterGen;
+    char datadir[300];
+    G4int fIsRoot;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef VHDBrickTally_h
+#define VHDBrickTally_h 1
+
+#include "VHDVTally.hh"
+#include "VHDTallyReducer.hh"
+#include <vector>
+
+//Thread-private bricked backend ("brick"): a two-level grid for sources that only touch part of the phantom
+// - a table of one pointer per brick of 8x8x8 voxels, NULL until a voxel of the brick is first scored; the
+//   brick is then a dense block of 512*nBins values (bins of a voxel contiguous, x fastest inside the brick)
+// - an add is a division of the copy number, one table lookup and one indexed add in the brick, and the
+//   voxels around a track share a few bricks; the memory follows the region hit
+// - compensated: the compensation (remainder) of every value follows the sums in the same block (see VHDTallyReducer)
+// - the output writers iterate over the bricks allocated (GetBrick, FillZSlice) instead of every voxel
+class VHDBrickTally : public VHDVTally
+{
+  public:
+    enum { BrickDim = 8, BrickVoxels = 512 };
+
+    VHDBrickTally(const G4String& name, G4int nx, G4int ny, G4int nz, G4int nBins = 1, G4bool compensated = false);
+    virtual ~VHDBrickTally();
+
+    virtual void Add(G4long copyNo, G4double val);
+    virtual G4double Get(G4long copyNo) const;
+    virtual void Merge(const VHDVTally& other);
+    virtual void GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& val) const;
+    virtual void GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& sum, std::vector<G4double>& comp) const;
+    virtual void SetEntries(const std::vector<G4long>& copyNo, const std::vector<G4double>& sum, const std::vector<G4double>& comp);
+    virtual void Reset();
+    virtual void Report() const;
+    virtual void Describe() const;
+    virtual G4bool IsCompensated() const {return fCompensated;}
+    virtual void FillZSlice(G4int iz, G4int nxny, G4double* img, G4int bin = 0, G4int nBins = 1) const;
+
+    //--- brick-level access
+    G4int GetNumberOfBricks() const {return fBrick.size();}
+    G4int GetNumberOfAllocatedBricks() const {return fNAllocated;}
+    const G4double* GetBrick(G4int ib) const {return fBrick[ib];}
+    // sums of brick ib, value (lx + (ly + lz*8)*8)*nBins + bin; NULL if nothing was scored in it
+    void GetBrickOrigin(G4int ib, G4int& ix0, G4int& iy0, G4int& iz0) const;
+    // voxel (ix0,iy0,iz0) of the corner of brick ib; the bricks of the far edges are partly outside the grid
+
+  private:
+    inline G4int Locate(G4long copyNo, G4int& k) const;
+    // brick of copy number copyNo and position k of its value in the brick
+    G4double* NewBrick(G4int ib);
+    G4int BrickValues() const {return BrickVoxels*fNBins;}
+
+    G4int fNx, fNy, fNz, fNBins;
+    G4long fSize;                 //nx*ny*nz*nBins copy numbers
+    G4int fNbx, fNby, fNbz;       //bricks per axis
+    G4bool fCompensated;
+    std::vector<G4double*> fBrick;
+    G4int fNAllocated;
+};
+
+inline G4int VHDBrickTally::Locate(G4long copyNo, G4int& k) const
+{
+  G4int voxel = static_cast<G4int>(copyNo), bin = 0;
+  if(fNBins > 1){
+	voxel = static_cast<G4int>(copyNo/fNBins);
+	bin = static_cast<G4int>(copyNo - static_cast<G4long>(voxel)*fNBins);
+  }
+  G4int r = voxel/fNx;
+  G4int ix = voxel - r*fNx;
+  G4int iz = r/fNy;
+  G4int iy = r - iz*fNy;
+  k = ((ix & 7) + ((iy & 7) + (iz & 7)*BrickDim)*BrickDim)*fNBins + bin;
+  return (ix >> 3) + ((iy >> 3) + (iz >> 3)*fNby)*fNbx;
+}
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef VHDCacheTally_h
+#define VHDCacheTally_h 1
+
+#include "VHDVTally.hh"
+#include <vector>
+
+//Per-thread write-combining cache in front of a run tally (/VHDMSDv1/tally/writeCache)
+// - direct-mapped on the copy number (voxel*nBins + bin): the consecutive steps of a track that stay in the
+//   same few voxels add into the cache, and only an evicted entry or the flush at the end of the event
+//   writes into the run tally; with a shared tally (atomic backends) far fewer atomic adds reach the grid
+// - the worker owns the cache but not a shared data tally; reads flush the cache first
+// - hits, evictions and the writes that reach the data tally are counted for the report of the run
+class VHDCacheTally : public VHDVTally
+{
+  public:
+    VHDCacheTally(const G4String& name, VHDVTally* data, G4bool ownsData, G4int nSlots);
+    virtual ~VHDCacheTally();
+
+    virtual void Add(G4long copyNo, G4double val);
+    virtual G4double Get(G4long copyNo) const;
+    virtual void Merge(const VHDVTally& other);
+    virtual void GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& val) const;
+    virtual void GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& sum, std::vector<G4double>& comp) const;
+    virtual void SetEntries(const std::vector<G4long>& copyNo, const std::vector<G4double>& sum, const std::vector<G4double>& comp);
+    virtual void Reset();
+    virtual void Report() const;
+    virtual void Describe() const;
+    virtual void FirstTouch();
+    virtual G4bool IsCompensated() const {return fData->IsCompensated();}
+    virtual void FillZSlice(G4int iz, G4int nxny, G4double* img, G4int bin = 0, G4int nBins = 1) const;
+
+    void Flush() const;
+    // write every cached entry into the data tally (end of event)
+    const VHDVTally* GetData() const {return fData;}
+    G4long GetNumberOfAdds() const {return fNAdd;}
+    G4long GetNumberOfHits() const {return fNHit;}
+    G4long GetNumberOfEvictions() const {return fNEvict;}
+    G4long GetNumberOfWrites() const {return fNWrite;}
+    // writes into the data tally (evictions and flushed entries)
+    G4long GetNumberOfFlushes() const {return fNFlush;}
+
+    static void SetSize(G4int nSlots) {sSize = nSlots;}
+    static G4int GetSize() {return sSize;}
+    // slots of the caches of the next runs, 0: no cache
+
+  private:
+    inline G4int Slot(G4long copyNo) const {return static_cast<G4int>((static_cast<unsigned long long>(copyNo)*0x9e3779b97f4a7c15ULL) >> (64 - fBits));}
+
+    VHDVTally* fData;
+    G4bool fOwnsData;
+    G4int fBits;
+    mutable std::vector<G4long> fKey;    //copy number of the slot, -1 if empty
+    mutable std::vector<G4double> fVal;
+    mutable std::vector<G4int> fUsed;    //slots filled since the last flush
+    G4long fNAdd;
+    G4long fNHit;
+    G4long fNEvict;
+    mutable G4long fNWrite;
+    mutable G4long fNFlush;
+
+    static G4int sSize;
+};
+
+inline void VHDCacheTally::Add(G4long copyNo, G4double val)
+{
+  if(copyNo < 0){  //out of range: left to the data tally
+	fData->Add(copyNo,val);
+	return;
+  }
+  fNAdd++;
+  G4int slot = Slot(copyNo);
+  G4long key = fKey[slot];
+  if(key == copyNo){
+	fNHit++;
+	fVal[slot] += val;
+	return;
+  }
+  if(key >= 0){
+	fNEvict++;
+	fNWrite++;
+	fData->Add(key,fVal[slot]);
+  }else{
+	fUsed.push_back(slot);
+  }
+  fKey[slot] = copyNo;
+  fVal[slot] = val;
+}
+
+#endif
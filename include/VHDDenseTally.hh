@@ -0,0 +1,51 @@
+#ifndef VHDDenseTally_h
+#define VHDDenseTally_h 1
+
+#include "VHDVTally.hh"
+#include "VHDVoxelLayout.hh"
+
+//Thread-private dense backend of the collections scored by a VHDDirectScorer (e.g. totalEDep)
+// - one contiguous array of nVoxels values per thread, indexed by copy number: O(1) adds, no allocation per hit,
+//   and the scorer adds straight into it, so there is no event HitsMap to merge
+// - compensated: a second array keeps the compensation (remainder) of every voxel (see VHDTallyReducer)
+// - the arrays come from VHDNumaUtil::Allocate: the zero pages of the voxels never hit cost no memory
+// - the arrays are in the order of the layout (linear or Morton, see VHDVoxelLayout), the interface in copy numbers
+// - the run only creates it while all the threads' copies fit in GetMemoryLimit() (/VHDMSDv1/tally/denseLimit),
+//   else the collection gets a VHDHashTally (see VHDMultiSDRun::CreateStore)
+class VHDDenseTally : public VHDVTally
+{
+  public:
+    VHDDenseTally(const G4String& name, G4long nVoxels, G4bool compensated = false, const VHDVoxelLayout* layout = 0);
+    virtual ~VHDDenseTally();
+
+    virtual void Add(G4long copyNo, G4double val);
+    virtual void Add(const G4THitsMap<G4double>& evtMap);
+    virtual G4double Get(G4long copyNo) const;
+    virtual void Merge(const VHDVTally& other);
+    virtual void GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& val) const;
+    virtual void GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& sum, std::vector<G4double>& comp) const;
+    virtual void SetEntries(const std::vector<G4long>& copyNo, const std::vector<G4double>& sum, const std::vector<G4double>& comp);
+    virtual void Reset();
+    virtual void FirstTouch();
+    virtual G4bool IsCompensated() const {return fComp != 0;}
+
+    G4long GetSize() const {return fSize;}
+
+    static void SetMemoryLimit(G4int mb) {sMemoryLimit = mb;}
+    static G4int GetMemoryLimit() {return sMemoryLimit;}
+    // [MB] of the dense arrays of one collection over all the threads, 0: no limit
+
+  private:
+    void Allocate();
+    void Free();
+
+    G4long fSize;
+    VHDVoxelLayout fLayout;
+    G4double* fSum;
+    G4double* fComp;  //NULL unless compensated
+    G4bool fCompensated;
+
+    static G4int sMemoryLimit;
+};
+
+#endif
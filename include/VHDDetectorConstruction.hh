@@ -9,8 +9,14 @@
 #include "G4MultiFunctionalDetector.hh"
 
 class G4Material;
+class G4Element;
 class G4Box;
 class G4LogicalVolume;
+class VHDDetectorMessenger;
+class VHDVoxelTable;
+class VHDPhantomFile;
+class VHDRunLengthLabels;
+class VHDMaterialIndices;
 
 class VHDDetectorConstruction : public G4VUserDetectorConstruction
 {
@@ -22,35 +28,94 @@ public:
   G4VPhysicalVolume* Construct();
   // trigger the construction of the geometry
 
+  virtual void ConstructSDandField();
+  // build the multifunctional detector and its scorers (called by every worker thread in multi-threaded mode)
+
   G4int GetNX() const {return nVoxelX;}
   G4int GetNY() const {return nVoxelY;}
   G4int GetNZ() const {return fNoFiles;}  //number of file is the same as the number of voxels in the z-direction
   G4int GetNEngbin() const {return NEngbin;}
+  const VHDVoxelTable* GetVoxelTable() const {return fVoxelTable;}
+  // per-voxel scoring metadata, built in Construct()
   void SetDirName(G4String name) {dirname = name;}
   void SetParticleFlag(G4int isElectron, G4int isPhoton);
   void DefineMaterialsOfInterest();
   void SetEnergyBinOption (G4int ieng) {ebin = ieng;};
+  void SetScoring(const G4String& scoring) {fScoring = scoring;}
+  // "fused" (VHDVoxelSD, default) or "legacy" (multifunctional detector with one scorer per energy bin)
+  void SetPhantomFile(const G4String& fname) {fPhantomFileName = fname;}
+  // read the phantom from a binary phantom file (memory-mapped) instead of Data.dat and the .g4m slices
+  void SetWritePhantomFile(const G4String& fname) {fWritePhantomFileName = fname;}
+  // write the phantom read from Data.dat and the .g4m slices to a binary phantom file
+  void SetWriteRunLengthDir(const G4String& dir) {fWriteRunLengthDir = dir;}
+  // write the phantom read to dir as Data.dat and run-length-encoded slices (compression 1)
+  void SetRunLookup(G4bool val) {fRunLookup = val;}
+  // keep the RLE slices as runs, without the per-voxel material array (nested geometry only)
+  void SetIndexBytes(G4int bytes) {fIndexBytes = bytes;}
+  // width of the material indices: 1, 2 or 8 bytes, 0 the smallest for the number of materials
+  void SetReadThreads(G4int n) {fReadThreads = n;}
+  // threads reading the phantom slices, 0: one per core (one in the sequential build)
   //G4double GetObjMass() const;
 
 protected:
   void InitialisationOfMaterials();
-  // create the original materials
+  // create the elements and air, read the composition of every organ label (no G4Material for the organs yet)
+  void BuildReferencedMaterials();
+  // after the phantom is read: one G4Material per distinct composition among the organ labels of the voxels
+
+  struct OrganComposition {
+    G4String name;
+    G4double density;
+    std::map<G4int,G4double> fractions;  // element (1..14, see InitialisationOfMaterials) -> mass fraction
+    OrganComposition() : density(0.) {;}
+  };
 
   void ReadPhantomData();
   // read the DICOM files describing the phantom
 
-  void ReadPhantomDataFile(const G4String& fname);
-  // read one of the DICOM files describing the phantom (usually one per Z slice). Build a VHDPhantomZSliceHeader for each file
+  struct SliceTask {
+    G4String fname;
+    std::streamoff body;  // position of the labels, after the header
+    G4int first;          // copy number of the first voxel of the slice
+    std::vector<std::pair<unsigned int,G4int> > runs;  // RLE slices: (material index, number of voxels)
+    G4String error;
+  };
+  void ReadSlicesInParallel(G4int nThreads, G4bool body, std::vector<SliceTask>& tasks);
+  // read the headers (body false) or the labels of all the slices on nThreads threads, fatal on the first error
+  void ReadSlices(G4int ithread, G4int nThreads, G4bool body, std::vector<SliceTask>* tasks);
+  void ReadSliceHeader(SliceTask& task, G4int islice);
+  // read the header of one of the DICOM files describing the phantom (usually one per Z slice) into fZSliceHeaders[islice]
+  void ReadSliceBody(SliceTask& task, G4int nVoxels);
+  // read the organ tags (or runs) of one slice into fMateIDs (or task.runs)
+
+  void WriteRunLengthPhantom(const G4String& dir) const;
+  // write Data.dat (compression 1) and one RLE slice per .g4m slice to dir
+  virtual G4bool SupportsRunLookup() const {return false;}
+  // the parameterisation can look the material indices up in fRunLabels
+  virtual G4bool SupportsCompactIndices() const {return false;}
+  // the parameterisation reads fMateIDs in 1 or 2 bytes (else size_t, as G4PhantomParameterisation needs)
+  G4int ChooseIndexBytes() const;
+  // width of fMateIDs for the organ labels, /VHDMSDv1/det/indexBytes and the parameterisation
+
+  void MapPhantomFile();
+  // map the binary phantom file (/VHDMSDv1/det/phantomFile): merged header and material indices without parsing
 
   void MergeZSliceHeaders();
   // merge the slice headers of all the files
+  void CheckMaterialNames() const;
+  // the material names of the slice headers are organ names of OrgantagvsName.txt (fatal otherwise)
 
   void ConstructPhantomContainer();
   virtual void ConstructPhantom() = 0;  //syntax "=0" indicates that ConstructPhantom() is an abstract member function!!
   // construct the phantom volumes. This method should be implemented for each of the derived classes
+  virtual void ConstructMultiSensDet() = 0;
+  // attach the scorers to fVoxelLogic; calls SetMultiSensDet_NestedParam or SetMultiSensDet_RegParam in the derived classes
  
   void SetMultiSensDet_NestedParam(G4LogicalVolume* voxel_logic);
   void SetMultiSensDet_RegParam(G4LogicalVolume* voxel_logic);
+  void SetVoxelSD(G4LogicalVolume* voxel_logic, G4bool nested);
+  // fused scoring, called by SetMultiSensDet_* unless fScoring is "legacy"
+  void ReadEnergyBins(std::vector<G4double>& engbin);
 
 
 protected:   //define all "private"-like variables in "protected" since there is class inheritence going on in this class
@@ -66,14 +131,27 @@ protected:   //define all "private"-like variables in "protected" since there is
   G4VPhysicalVolume* container_phys;
 
   G4int fNoFiles; // number of DICOM files
-  std::map<unsigned int,unsigned int> Organtag2MatIndx;
-  std::vector<G4Material*> fOriginalMaterials;  // list of original materials
-  //std::vector<G4Material*> fMaterials;  // list of new materials created to distinguish different density voxels that have the same original materials
+  std::map<unsigned int,unsigned int> Organtag2MatIndx;  // organ tag -> organ label (row of ECompDensity.txt, 0: air)
+  std::vector<OrganComposition> fOrganCompositions;  // per organ label
+  std::vector<G4Element*> fElements;
+  std::vector<G4Material*> fOriginalMaterials;  // material of each organ label: shared by the labels of the same composition, air if no voxel uses it
+  std::vector<G4Material*> fMaterials;  // the materials built (owned), air first
+  std::vector<unsigned int> fLabelsOfInterest;  // organ labels of OrgantagOfInterest.txt
   std::vector<G4Material*> MaterialsOfInterest;
   
   std::vector<VHDPhantomZSliceHeader*> fZSliceHeaders; // list of z slice header (one per DICOM files)
   VHDPhantomZSliceHeader* fZSliceHeaderMerged; // z slice header resulted from merging all z slice headers
-  size_t* fMateIDs; // index of material of each voxel
+  VHDMaterialIndices* fMateIDs; // organ label of each voxel, the index in fOriginalMaterials (owned, or wrapping the array mapped from fPhantomFile)
+  G4int fIndexBytes;  // /VHDMSDv1/det/indexBytes
+  G4int fReadThreads;  // /VHDMSDv1/det/readThreads
+  std::vector<G4int> fOrgantagTable;  // organ tag -> organ label (-1: unknown), read by the slice parsers
+  VHDPhantomFile* fPhantomFile;  // binary phantom file mapped, 0 if read from the .g4m slices
+  G4String fPhantomFileName, fWritePhantomFileName;
+  G4int fCompression;  // of the slices (Data.dat): 0 one organ tag per voxel, 1 runs
+  std::vector<G4String> fSliceFileNames;
+  VHDRunLengthLabels* fRunLabels;  // runs of the RLE slices, 0 for uncompressed slices
+  G4bool fRunLookup;
+  G4String fWriteRunLengthDir;
   //VHDPhantomZSliceHeader* sliceHeader;
 
   //unsigned int* fMateIDs; // index of material of each voxel
@@ -83,9 +161,13 @@ protected:   //define all "private"-like variables in "protected" since there is
   G4double voxelHalfDimX,  voxelHalfDimY, voxelHalfDimZ,totDensity;
   G4String dirname;
   //G4int isVis;
-  G4MultiFunctionalDetector* MFDet;
+  G4MultiFunctionalDetector* MFDet;  //the master's detector (each worker thread owns its own copy in MT mode)
+  G4LogicalVolume* fVoxelLogic;  //the sensitive voxel volume set up by ConstructPhantom()
   G4bool electronflag, photonflag;   //flag to see if one wants to track electron or gamma rays or not in SetMultiSensDet function
   G4int ebin;  //flag to select the energy bin used in the simulation
+  G4String fScoring;  //fused or legacy (/VHDMSDv1/det/scoring)
+  VHDDetectorMessenger* fMessenger;
+  VHDVoxelTable* fVoxelTable;
 };
 
 #endif
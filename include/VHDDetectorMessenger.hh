@@ -0,0 +1,35 @@
+#ifndef VHDDetectorMessenger_h
+#define VHDDetectorMessenger_h 1
+
+#include "globals.hh"
+#include "G4UImessenger.hh"
+
+class VHDDetectorConstruction;
+class G4UIdirectory;
+class G4UIcmdWithAString;
+class G4UIcmdWithABool;
+class G4UIcmdWithAnInteger;
+
+class VHDDetectorMessenger: public G4UImessenger
+{
+  public:
+
+    VHDDetectorMessenger(VHDDetectorConstruction* );
+   ~VHDDetectorMessenger();
+
+    void SetNewValue(G4UIcommand*, G4String);
+
+  private:
+
+    VHDDetectorConstruction* pDetector;
+    G4UIdirectory*        detDir;
+    G4UIcmdWithAString*   scoringCmd;
+    G4UIcmdWithAString*   phantomFileCmd;
+    G4UIcmdWithAString*   writePhantomFileCmd;
+    G4UIcmdWithAString*   writeRLEPhantomCmd;
+    G4UIcmdWithABool*     runLookupCmd;
+    G4UIcmdWithAnInteger* indexBytesCmd;
+    G4UIcmdWithAnInteger* readThreadsCmd;
+};
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef VHDDirectScorer_h
+#define VHDDirectScorer_h 1
+
+#include "VHDVTally.hh"
+#include "VHDPooledScorer.hh"
+
+//Mix-in of the primitive scorers that add straight into the run tally of their collection
+// - VHDMultiSDRun binds the thread-private run tally at the creation of the run (SetRunTally) and then
+//   skips the collection in RecordEvent; with no tally bound (e.g. a shared backend) the scorer fills
+//   its pooled event buffer (see VHDPooledScorer), or its event HitsMap
+// - the run tally is dense (VHDDenseTally), so a hit is one indexed add, or a sparse hash table (VHDHashTally)
+class VHDDirectScorer : public VHDPooledScorer
+{
+  public:
+    VHDDirectScorer() : fRunTally(0) {;}
+    virtual ~VHDDirectScorer() {;}
+
+    void SetRunTally(VHDVTally* tally) {fRunTally = tally;}
+    G4bool IsDirect() const {return fRunTally != 0;}
+
+  protected:
+    VHDVTally* fRunTally;
+};
+
+#endif
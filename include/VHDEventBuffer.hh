@@ -0,0 +1,72 @@
+#ifndef VHDEventBuffer_h
+#define VHDEventBuffer_h 1
+
+#include "globals.hh"
+#include <vector>
+
+//Reusable event store of one primitive scorer (replaces the G4THitsMap allocated by every Initialize)
+// - owned by the run (VHDMultiSDRun), one per pooled collection and thread, allocated once per run
+// - open addressing on the copy number with linear probing; the slots used in the event are listed
+//   in first-touch order, so the run adds them up and Reset() clears them in O(entries of the event)
+// - the table only grows (doubling, kept at most half full); the allocations are counted for the report
+// - the first entry of an event appends the ID of the buffer to the dirty list of the run, so the run
+//   only visits the buffers hit in the event
+class VHDEventBuffer
+{
+  public:
+    VHDEventBuffer(G4int capacity = 1024);
+    ~VHDEventBuffer() {;}
+
+    inline void Add(G4long copyNo, G4double val);
+    G4int GetNumberOfEntries() const {return fTouched.size();}
+    G4long GetCopyNo(G4int i) const {return fKey[fTouched[i]];}
+    G4double GetValue(G4int i) const {return fVal[fTouched[i]];}
+    // entry i of the event, in first-touch order
+    void Reset();
+    void SetDirtyList(std::vector<G4int>* dirty, G4int id) {fDirty = dirty; fID = id;}
+
+    G4int GetNumberOfAllocations() const {return fNAlloc;}
+    G4int GetPeakEntries() const {return fPeak;}
+
+    static void SetPooled(G4bool val) {sPooled = val;}
+    static G4bool IsPooled() {return sPooled;}
+    // false: the scorers allocate a G4THitsMap per event as before (/VHDMSDv1/tally/eventPool)
+
+  private:
+    void Allocate(G4int bits);
+    inline G4int Slot(G4long copyNo) const {return static_cast<G4int>((static_cast<unsigned long long>(copyNo)*0x9e3779b97f4a7c15ULL) >> (64 - fBits));}
+
+    G4int fBits;  //capacity = 2^fBits slots
+    G4int fMask;
+    std::vector<G4long> fKey;    //copy number of the slot, -1 if empty
+    std::vector<G4double> fVal;
+    std::vector<G4int> fTouched; //slots used in this event
+    G4int fNAlloc;
+    G4int fPeak;
+    std::vector<G4int>* fDirty;  //owned by the run, NULL if none
+    G4int fID;
+
+    static G4bool sPooled;
+};
+
+inline void VHDEventBuffer::Add(G4long copyNo, G4double val)
+{
+  G4int slot = Slot(copyNo);
+  while(fKey[slot] != copyNo){
+    if(fKey[slot] < 0){
+      if(2*(fTouched.size()+1) > fKey.size()){  //keep the table at most half full
+	Allocate(fBits+1);
+	Add(copyNo,val);
+	return;
+      }
+      if(fTouched.empty() && fDirty) fDirty->push_back(fID);  //first entry of the event
+      fKey[slot] = copyNo;
+      fTouched.push_back(slot);
+      break;
+    }
+    slot = (slot + 1) & fMask;
+  }
+  fVal[slot] += val;
+}
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef VHDForkRunner_h
+#define VHDForkRunner_h 1
+
+#ifndef G4MULTITHREADED
+
+#include "globals.hh"
+
+class VHDMultiSDRunAction;
+class VHDMSDSteppingAction;
+class VHDForkRunnerMessenger;
+
+//Fork-after-initialization mode of the sequential build (/VHDMSDv1/fork/beamOn)
+// - the parent builds the geometry, materials, physics tables and source map once (BeamOn(0))
+// - it then forks nProcesses children sharing that memory copy-on-write; each child runs its shard
+//   of the events with its own seed (or its own event streams of the counter-based engine)
+//   and saves its tallies to a shard file (VHDMultiSDRun::WriteShard)
+// - the parent waits for the children, adds the shards into one run and writes the usual output
+//   through the EndOfRunAction of the run action
+class VHDForkRunner
+{
+  public:
+    VHDForkRunner(VHDMultiSDRunAction* run, VHDMSDSteppingAction* step);
+    ~VHDForkRunner();
+
+    void SetNumberOfProcesses(G4int n) {fNProc = n;}
+    void BeamOn(G4int nEvent);
+
+  private:
+    void RunShard(G4int id, G4int nEvent, G4int firstEvent, G4long seed);  //executed by a child process; never returns
+
+  private:
+    VHDForkRunnerMessenger* fMessenger;
+    VHDMultiSDRunAction* fRunAction;
+    VHDMSDSteppingAction* fStepAction;
+    G4int fNProc;
+};
+
+#endif
+
+#endif
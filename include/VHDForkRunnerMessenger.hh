@@ -0,0 +1,32 @@
+#ifndef VHDForkRunnerMessenger_h
+#define VHDForkRunnerMessenger_h 1
+
+#ifndef G4MULTITHREADED
+
+#include "globals.hh"
+#include "G4UImessenger.hh"
+
+class VHDForkRunner;
+class G4UIdirectory;
+class G4UIcmdWithAnInteger;
+
+class VHDForkRunnerMessenger: public G4UImessenger
+{
+  public:
+
+    VHDForkRunnerMessenger(VHDForkRunner* );
+   ~VHDForkRunnerMessenger();
+
+    void SetNewValue(G4UIcommand*, G4String);
+
+  private:
+
+    VHDForkRunner* pForkRunner;
+    G4UIdirectory*        forkDir;
+    G4UIcmdWithAnInteger* nProcCmd;
+    G4UIcmdWithAnInteger* beamOnCmd;
+};
+
+#endif
+
+#endif
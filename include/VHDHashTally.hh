@@ -0,0 +1,95 @@
+#ifndef VHDHashTally_h
+#define VHDHashTally_h 1
+
+#include "VHDVTally.hh"
+#include "VHDTallyReducer.hh"
+#include <vector>
+
+//Thread-private sparse backend for grids too large for a dense [voxel][bin] array (sub-millimetre phantoms)
+// - one flat open-addressing table with 64-bit keys (voxel << 32 | bin) built from the G4long copy number
+//   voxel*nBins + bin, linear probing, no heap node per entry
+//   (16 bytes per slot, 24 compensated, vs. a map node plus a heap double per entry of G4THitsMap)
+// - the table grows in batches: an event reserves room for all its entries first, so it is rehashed
+//   at most once per event; it is kept at most 70 % full (MaxLoadPercent)
+// - chosen per quantity with /VHDMSDv1/tally/hashQuantities (see VHDMultiSDRun::CreateTally)
+// - compensated: a third array keeps the compensation (remainder) of every entry (see VHDTallyReducer)
+class VHDHashTally : public VHDVTally
+{
+  public:
+    VHDHashTally(const G4String& name, G4int nBins = 1, G4bool compensated = false, G4int capacity = 4096);
+    virtual ~VHDHashTally();
+
+    virtual void Add(G4long copyNo, G4double val);
+    virtual void Add(const G4THitsMap<G4double>& evtMap);
+    virtual void Add(const VHDEventBuffer& evtBuf);
+    virtual G4double Get(G4long copyNo) const;
+    virtual void Merge(const VHDVTally& other);
+    virtual void GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& val) const;
+    virtual void GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& sum, std::vector<G4double>& comp) const;
+    virtual void SetEntries(const std::vector<G4long>& copyNo, const std::vector<G4double>& sum, const std::vector<G4double>& comp);
+    virtual void Reset();
+    virtual void Report() const;
+    virtual void Describe() const;
+    virtual G4bool IsCompensated() const {return fCompensated;}
+
+    void Reserve(G4long n);
+    // make room for n more entries (one rehash at most)
+    G4long GetNumberOfEntries() const {return fCount;}
+    G4double GetLoadFactor() const {return static_cast<G4double>(fCount)/fKey.size();}
+    G4double GetMemory() const;
+    // bytes of the table
+
+    static void SetQuantities(const G4String& names);
+    static G4bool IsHashed(const G4String& colName);
+    // colName contains one of the names given to /VHDMSDv1/tally/hashQuantities
+
+  private:
+    inline G4long Key(G4long copyNo) const
+    { return ((copyNo/fNBins) << 32) | (copyNo%fNBins); }
+    // the voxel (a G4int copy number of the geometry) in the high 32 bits, the bin in the low ones
+    inline G4long CopyNo(G4long key) const
+    { return (key >> 32)*fNBins + (key & 0xffffffffL); }
+    inline G4long Slot(G4long key) const
+    { return static_cast<G4long>((static_cast<unsigned long long>(key)*0x9E3779B97F4A7C15ULL) >> (64 - fBits)); }
+    inline G4long Find(G4long key) const;
+    // slot of key, or the empty slot where it goes
+    inline void AddKey(G4long key, G4double val);
+    // no growth check: Reserve first
+    void Rehash(G4int bits);
+
+    enum { MaxLoadPercent = 70 };
+    G4int fNBins;
+    G4bool fCompensated;
+    G4int fBits0;
+    G4int fBits;                 //capacity = 2^fBits slots
+    G4long fMask;
+    G4long fCount;
+    std::vector<G4long> fKey;    //-1 if empty
+    std::vector<G4double> fSum;
+    std::vector<G4double> fComp; //empty unless compensated
+    G4int fNRehash;
+
+    static std::vector<G4String> sQuantities;
+};
+
+inline G4long VHDHashTally::Find(G4long key) const
+{
+  G4long slot = Slot(key);
+  while(fKey[slot] != key && fKey[slot] >= 0) slot = (slot + 1) & fMask;
+  return slot;
+}
+
+inline void VHDHashTally::AddKey(G4long key, G4double val)
+{
+  G4long slot = Find(key);
+  if(fKey[slot] < 0){
+	fKey[slot] = key;
+	fCount++;
+  }
+  if(fCompensated)
+	VHDTallyReducer::Add(fSum[slot],fComp[slot],val);
+  else
+	fSum[slot] += val;
+}
+
+#endif
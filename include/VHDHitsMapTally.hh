@@ -0,0 +1,37 @@
+#ifndef VHDHitsMapTally_h
+#define VHDHitsMapTally_h 1
+
+#include "VHDVTally.hh"
+
+//Thread-private replica backend ("replica", the default): one G4THitsMap per thread,
+//added into the master run at the end of the run (VHDMultiSDRun::Merge)
+// - compensated: every entry also keeps the compensation (remainder) of its sum (value = sum + comp), so the
+//   partials can be reduced in a fixed order without the rounding depending on the split of the events
+//   (see VHDTallyReducer)
+// - G4THitsMap is keyed by G4int: only for the voxel-indexed collections, never for the fused [voxel][bin] tallies
+class VHDHitsMapTally : public VHDVTally
+{
+  public:
+    VHDHitsMapTally(const G4String& detName, const G4String& colName, G4bool compensated = false);
+    virtual ~VHDHitsMapTally();
+
+    virtual void Add(G4long copyNo, G4double val);
+    virtual void Add(const G4THitsMap<G4double>& evtMap);
+    virtual G4double Get(G4long copyNo) const;
+    virtual void Merge(const VHDVTally& other);
+    virtual void GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& val) const;
+    virtual void Reset();
+
+    G4THitsMap<G4double>* GetHitsMap() const {return fMap;}
+    // the sums only; the compensation terms are kept apart
+    virtual G4bool IsCompensated() const {return fCompensated;}
+    virtual void GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& sum, std::vector<G4double>& comp) const;
+    virtual void SetEntries(const std::vector<G4long>& copyNo, const std::vector<G4double>& sum, const std::vector<G4double>& comp);
+
+  private:
+    G4THitsMap<G4double>* fMap;
+    G4bool fCompensated;
+    std::map<G4int,G4double> fComp;  //compensation of each entry of fMap (compensated tally)
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef VHDLogTally_h
+#define VHDLogTally_h 1
+
+#include "VHDVTally.hh"
+#include <vector>
+
+class VHDHashTally;
+
+//Log-structured front of a thread-private run tally (/VHDMSDv1/tally/depositLog)
+// - every Add appends a (copy number, event, value) record to a flat buffer: streaming writes instead of
+//   scattered updates of a large tally on every step
+// - after a batch of events (/VHDMSDv1/tally/logBatch) the records are radix sorted by (copy number, event)
+//   and each segment of a copy number is added once into the data tally; the per-event sums of the segment
+//   give the sum of squares of the voxel (history-by-history variance) at no extra pass
+// - the pending records are flushed before any read (Get, GetEntries, Merge, Report); the run is read
+//   by the thread that filled it (Merge runs on the worker thread), so the lazy flush needs no lock
+// - owns the data tally; compensated and reduced as the data tally is, never shared
+class VHDLogTally : public VHDVTally
+{
+  public:
+    VHDLogTally(const G4String& name, VHDVTally* data);
+    virtual ~VHDLogTally();
+
+    virtual void Add(G4long copyNo, G4double val);
+    virtual G4double Get(G4long copyNo) const;
+    virtual void Merge(const VHDVTally& other);
+    virtual void GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& val) const;
+    virtual void GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& sum, std::vector<G4double>& comp) const;
+    virtual void SetEntries(const std::vector<G4long>& copyNo, const std::vector<G4double>& sum, const std::vector<G4double>& comp);
+    virtual void Reset();
+    virtual void Report() const;
+    virtual void Describe() const;
+    virtual void FirstTouch();
+    virtual G4bool IsCompensated() const {return fData->IsCompensated();}
+    virtual void FillZSlice(G4int iz, G4int nxny, G4double* img, G4int bin = 0, G4int nBins = 1) const;
+
+    void EndOfEvent();
+    // called by the run at the end of every event: flushes every logBatch events
+    G4double GetSumSq(G4long copyNo) const;
+    // sum over the events of the squared event sums of copyNo
+    void MergeStats(const VHDVTally& other);
+    // add the sums of squares and the counters of a worker's log tally (the data go through Merge or the reducer)
+
+    static void SetEnabled(G4bool val) {sEnabled = val;}
+    static G4bool IsEnabled() {return sEnabled;}
+    static void SetBatchSize(G4int n) {if(n > 0 && n <= MaxBatch) sBatch = n;}
+    static G4int GetBatchSize() {return sBatch;}
+
+  private:
+    struct Record {
+      unsigned long long key;  //copy number << EventBits | event in the batch (48 bits of copy number)
+      G4double val;
+    };
+    enum { EventBits = 16, MaxBatch = (1 << EventBits) - 1, RadixBits = 11 };
+
+    void Flush() const;
+    // sort the pending records and add them into the data tally (const: the pending records are part of the value)
+    void RadixSort() const;
+
+    VHDVTally* fData;
+    VHDHashTally* fSumSq;
+    mutable std::vector<Record> fRecord;
+    mutable std::vector<Record> fSorted;  //scratch buffer of the sort
+    mutable G4int fEvent;                 //event in the current batch
+    G4long fNEvent;                       //events of the run (with the merged workers)
+    mutable G4long fNRecord;              //records logged
+    mutable G4long fNSegment;             //segments (one copy number of a batch) added into the data tally
+    mutable G4long fNFlush;
+    mutable G4double fFlushTime;          //[s] spent sorting and reducing
+
+    static G4bool sEnabled;
+    static G4int sBatch;
+};
+
+#endif
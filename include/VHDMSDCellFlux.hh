@@ -0,0 +1,209 @@
+#ifndef VHDMSDCellFlux_h
+#define VHDMSDCellFlux_h 1
+
+#include "G4VPrimitiveScorer.hh"
+#include "G4THitsMap.hh"
+#include "G4Material.hh"
+#include "G4VSolid.hh"
+#include "G4VPVParameterisation.hh"
+#include "G4UnitsTable.hh"
+#include "G4SystemOfUnits.hh"
+#include "VHDVoxelIndex.hh"
+#include "VHDVoxelTable.hh"
+#include "VHDPooledScorer.hh"
+#include <algorithm>
+
+//very similar definition to G4PSCellFlux class except ProcessHits class, which involves accessing the EvtMap (a private variable)
+//so i can't just derive a class from G4PSCellFlux class but need to write another class that is derived from G4VPrimitiveScorer where i can access the EvtMap!
+//IndexPolicy (VHDRegularIndex or VHDNestedIndex, see VHDVoxelIndex.hh) gives the voxel index of a step at compile time
+//the cell flux goes into the pooled event buffer bound by VHDMultiSDRun (see VHDPooledScorer), else into a new HitsMap per event
+template <class IndexPolicy>
+class VHDMSDCellFlux: public G4VPrimitiveScorer, public VHDPooledScorer
+{
+   public:
+	VHDMSDCellFlux(G4String name,G4int nx, G4int ny, G4int nz,G4int depth=0);
+	VHDMSDCellFlux(G4String name, const G4String& unit,G4int depth=0);
+	virtual ~VHDMSDCellFlux();
+
+	inline void Weighted(G4bool flg=true){ weighted = flg;}  //multiply track weight
+	void SetMaterialsOfInterest(std::vector<G4Material*> moi) {MaterialsOfInterest = moi;}
+	void SetVoxelTable(const VHDVoxelTable* table) {fTable = table;}
+	//with a voxel table the organ test and the voxel volume are table lookups (no ComputeVolume per step)
+
+   protected:
+   	virtual G4bool ProcessHits(G4Step*,G4TouchableHistory*);
+   	virtual G4double ComputeVolume(G4Step*,G4int idx);
+   	virtual G4int GetIndex(G4Step* aStep) {return fIndex(aStep->GetPreStepPoint()->GetTouchable());}
+
+   public:
+   	virtual void Initialize(G4HCofThisEvent*);
+   	virtual void EndOfEvent(G4HCofThisEvent*);
+   	virtual void clear();
+   	virtual void DrawAll();
+   	virtual void PrintAll();
+
+	virtual void SetUnit(const G4String& unit);
+
+   protected:
+   	virtual void DefineUnitAndCategory();
+   	inline void Score(G4int index, G4double val)
+   	{
+   		if(fEventBuffer)	fEventBuffer->Add(index,val);
+   		else			EvtMap->add(index,val);
+   	}
+
+   private:
+   	G4int HCID;
+   	G4THitsMap<G4double>* EvtMap;
+   	G4bool weighted;
+   	IndexPolicy fIndex;
+   	std::vector<G4Material*> MaterialsOfInterest;
+   	const VHDVoxelTable* fTable;
+};
+
+typedef VHDMSDCellFlux<VHDRegularIndex> VHDMSDCellFlux_RegParam;
+typedef VHDMSDCellFlux<VHDNestedIndex> VHDMSDCellFlux_NestedParam;
+
+
+template <class IndexPolicy>
+VHDMSDCellFlux<IndexPolicy>::VHDMSDCellFlux(G4String name,G4int nx, G4int ny, G4int nz,G4int depth)
+  :G4VPrimitiveScorer(name,depth),HCID(-1),EvtMap(0),weighted(TRUE),fIndex(nx,ny,nz),fTable(0)
+{
+	DefineUnitAndCategory();
+	SetUnit("percm2");  //default unit if cm-2
+}
+
+template <class IndexPolicy>
+VHDMSDCellFlux<IndexPolicy>::VHDMSDCellFlux(G4String name, const G4String& unit,G4int depth)
+  :G4VPrimitiveScorer(name,depth),HCID(-1),EvtMap(0),weighted(TRUE),fTable(0)
+{
+	DefineUnitAndCategory();
+	SetUnit(unit);  //set a preferred unit to use!
+}
+
+template <class IndexPolicy>
+VHDMSDCellFlux<IndexPolicy>::~VHDMSDCellFlux()
+{
+	if(filter){  //'filter' is a private variable that is definied in G4VPrimitiveScorer
+		delete filter;  //delete it if it's defined
+	}
+
+	MaterialsOfInterest.clear();
+
+	G4cout << "destroying VHDMSDCellFlux..." << G4endl;
+}
+
+template <class IndexPolicy>
+G4bool VHDMSDCellFlux<IndexPolicy>::ProcessHits(G4Step* aStep,G4TouchableHistory*)
+{
+	G4double steplen = aStep->GetStepLength();
+	if(steplen == 0.)	return FALSE;
+
+	G4StepPoint* preStep = aStep->GetPreStepPoint();
+	if(fTable){
+		//one lookup for the organ of interest, the same volume for all the voxels
+		G4int index = fIndex(preStep->GetTouchable());
+		if(!fTable->IsOfInterest(index))	return FALSE;
+		G4double CellFlux = steplen/fTable->GetVoxelVolume();
+		if(weighted)	CellFlux *= preStep->GetWeight();
+		Score(index,CellFlux);
+		return TRUE;
+	}
+
+	if(!MaterialsOfInterest.empty()){
+		//use String comparison when tallying ==> can slow down CPU performance
+		//Do the following when steplen > 0
+		G4Material* lemat = preStep->GetMaterial();
+		std::vector<G4Material*>::iterator itr;
+		itr = find(MaterialsOfInterest.begin(),MaterialsOfInterest.end(),lemat);
+		if(itr != MaterialsOfInterest.end())
+		{
+			//tally cell flux!! it's one of the material of interest!
+			G4int idx = ((G4TouchableHistory*)(preStep->GetTouchable()))->GetReplicaNumber(indexDepth);
+			G4double cubicVolume = ComputeVolume(aStep,idx);
+			G4double CellFlux = steplen/cubicVolume;
+			if(weighted)	CellFlux *= preStep->GetWeight();
+			Score(fIndex(preStep->GetTouchable()),CellFlux);
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+template <class IndexPolicy>
+void VHDMSDCellFlux<IndexPolicy>::Initialize(G4HCofThisEvent* HCE)
+{
+	if(fEventBuffer)	return;  //the run adds up and resets the buffer
+	EvtMap = new G4THitsMap<G4double>(detector->GetName(),GetName());
+	if(HCID < 0)	HCID = GetCollectionID(0);
+	HCE->AddHitsCollection(HCID,EvtMap);
+}
+
+template <class IndexPolicy>
+void VHDMSDCellFlux<IndexPolicy>::EndOfEvent(G4HCofThisEvent*)
+{;}
+
+template <class IndexPolicy>
+void VHDMSDCellFlux<IndexPolicy>::clear()
+{
+	if(EvtMap && !fEventBuffer)	EvtMap->clear();
+}
+
+template <class IndexPolicy>
+void VHDMSDCellFlux<IndexPolicy>::DrawAll()
+{;}
+
+template <class IndexPolicy>
+void VHDMSDCellFlux<IndexPolicy>::PrintAll()
+{
+	G4cout << "MultiFunctionalDet " << detector->GetName() << G4endl;
+	G4cout << "PrimitiveScorer " << GetName() << G4endl;
+	if(fEventBuffer || !EvtMap)	return;
+	G4cout << "Number of entries " << EvtMap->entries() << G4endl;
+	std::map<G4int,G4double*>::iterator itr = EvtMap->GetMap()->begin();
+	for(; itr != EvtMap->GetMap()->end(); itr++)
+	{
+		G4cout << " copy no.: " << itr->first << " cell flux: " << *(itr->second)/GetUnitValue() << " [" << GetUnit() << "]" << G4endl;
+	}
+}
+
+template <class IndexPolicy>
+void VHDMSDCellFlux<IndexPolicy>::SetUnit(const G4String& unit)
+{
+	CheckAndSetUnit(unit,"Per Unit Surface");
+}
+
+template <class IndexPolicy>
+void VHDMSDCellFlux<IndexPolicy>::DefineUnitAndCategory()
+{
+	//per unit surface
+	new G4UnitDefinition("percentimeter2","percm2","Per Unit Surface",(1./cm2));
+	new G4UnitDefinition("permillimeter2","permm2","Per Unit Surface",(1./mm2));
+	new G4UnitDefinition("permeter2","perm2","Per Unit Surface",(1./m2));
+}
+
+template <class IndexPolicy>
+G4double VHDMSDCellFlux<IndexPolicy>::ComputeVolume(G4Step* aStep, G4int idx)
+{
+	G4VPhysicalVolume* physVol = aStep->GetPreStepPoint()->GetPhysicalVolume();
+	G4VPVParameterisation* physParam = physVol->GetParameterisation();
+	G4VSolid* solid = 0;
+	if(physParam)
+	{  //for parameterised volume
+		if(idx < 0)
+		{
+			G4Exception("VHDMSDCellFlux","VHDMSDCellFlux::ComputeVolume",JustWarning,"Incorrect replica number");
+			G4cerr << " ------- GetReplicaNumber : " << idx << G4endl;
+		}
+		solid = physParam->ComputeSolid(idx,physVol);
+		solid->ComputeDimensions(physParam,idx,physVol);
+	}
+	else
+	{  //for ordinary volume
+		solid = physVol->GetLogicalVolume()->GetSolid();
+	}
+	return solid->GetCubicVolume();
+}
+
+#endif
@@ -2,20 +2,35 @@
 #define VHDMSDNofStep_h 1
 
 #include "G4PSNofStep.hh"
+#include "VHDVoxelIndex.hh"
 
-//G4PSEnergyDeposit is the derived class of G4VPrimitiveScorer
-
+//G4PSNofStep is the derived class of G4VPrimitiveScorer
+//IndexPolicy (VHDRegularIndex or VHDNestedIndex, see VHDVoxelIndex.hh) gives the voxel index of a step at compile time
+template <class IndexPolicy>
 class VHDMSDNofStep : public G4PSNofStep
 {
    public: // with description
-      VHDMSDNofStep(G4String name,G4int nx,G4int ny, G4int nz);
-      virtual ~VHDMSDNofStep();
+      VHDMSDNofStep(G4String name,G4int nx,G4int ny, G4int nz)
+	:G4PSNofStep(name),fIndex(nx,ny,nz)
+      {
+	SetUnit("");
+      }
+      virtual ~VHDMSDNofStep()
+      {
+	if(filter){  //'filter' is a private variable that is definied in G4VPrimitiveScorer
+		delete filter;  //delete it if it's defined
+	}
+	G4cout << "destroying VHDMSDNofStep..." << G4endl;
+      }
 
   protected: // with description
-      G4int GetIndex(G4Step*);
+      virtual G4int GetIndex(G4Step* aStep) {return fIndex(aStep->GetPreStepPoint()->GetTouchable());}
 
   private:
-      G4int fNx, fNy, fNz, fNxNy;
+      IndexPolicy fIndex;
 };
-#endif
 
+typedef VHDMSDNofStep<VHDRegularIndex> VHDMSDNofStep_RegParam;
+typedef VHDMSDNofStep<VHDNestedIndex> VHDMSDNofStep_NestedParam;
+
+#endif
@@ -48,6 +48,12 @@ class VHDMSDSteppingAction : public G4UserSteppingAction
     virtual ~VHDMSDSteppingAction();
     virtual void UserSteppingAction(const G4Step*);
     void SetMaterialOfInterest(G4String dirname);
+    void SetShardID(G4int id) {fShardID = id;}  //fork mode: shard run by this process, used to name the histogram files
+    void WriteHistograms();  //called by the destructor, or explicitly by a forked child before it exits
+    // MT: the histograms of the workers are added into one pair owned by the master (worker EndOfRunAction),
+    // which the master run action writes to hE_electron.root / hE_photon.root as in the sequential build
+    static void MergeWorkerHistograms();
+    static void WriteMergedHistograms(const char* dname);
 
   private:
     //G4String fdir;
@@ -59,6 +65,13 @@ class VHDMSDSteppingAction : public G4UserSteppingAction
     TH1F* hE_photon;
     std::vector<G4String> MaterialOfInterest;
     FILE *fpt;
+    G4int fThreadID;  //worker thread ID in MT mode (-1 otherwise): its histograms are merged, not written
+    G4int fShardID;   //shard ID of a forked child process (-1 otherwise)
+
+    static TH1F* NewHistogram(const char* name, const char* title);
+    static void WriteHistogram(TH1F* h, const char* fname);
+    static TH1F* fMergedElectron;  //MT: sum of the worker histograms, written by the master
+    static TH1F* fMergedPhoton;
     
     
 };
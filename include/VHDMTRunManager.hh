@@ -0,0 +1,52 @@
+#ifndef VHDMTRunManager_h
+#define VHDMTRunManager_h 1
+
+#ifdef G4MULTITHREADED
+
+#include "G4MTRunManager.hh"
+#include "globals.hh"
+#include <map>
+
+class VHDMTRunManagerMessenger;
+
+//Multi-threaded run manager dispatching the events to the workers in adaptive chunks
+// - the workers pull their next chunk of events from the master whenever they are idle,
+//   so a worker stuck on expensive (e.g. bone) decays simply pulls fewer chunks
+// - the chunk size is guided: remaining events / (chunkFactor * nworkers), never below minChunk,
+//   i.e. large chunks at the start of the run (few synchronisations) and small ones at the end (no idle tail)
+// - with /VHDMSDv1/sched/adaptive false the fixed /run/eventModulo of G4MTRunManager is used instead
+// - the number of chunks and events dispatched to each worker is printed at the end of the run
+class VHDMTRunManager : public G4MTRunManager
+{
+  public:
+    VHDMTRunManager();
+    virtual ~VHDMTRunManager();
+
+    virtual G4int SetUpNEvents(G4Event* evt, G4SeedsQueue* seedsQueue, G4bool reseedRequired=true);
+    // called by a worker thread when it has processed its previous chunk of events
+
+    virtual void RunTermination();
+
+    void SetAdaptive(G4bool val) {fAdaptive = val;}
+    void SetChunkFactor(G4double val) {fChunkFactor = val;}
+    void SetMinChunk(G4int val) {fMinChunk = val;}
+
+  protected:
+    virtual void InitializeEventLoop(G4int n_event, const char* macroFile=0, G4int n_select=-1);
+
+  private:
+    G4int NextChunkSize() const;
+    void PrintDispatchReport() const;
+
+  private:
+    VHDMTRunManagerMessenger* fMessenger;
+    G4bool fAdaptive;
+    G4double fChunkFactor;
+    G4int fMinChunk;
+    std::map<G4int,G4int> fChunksPerWorker;  //thread ID ==> number of chunks dispatched in this run
+    std::map<G4int,G4int> fEventsPerWorker;  //thread ID ==> number of events dispatched in this run
+};
+
+#endif
+
+#endif
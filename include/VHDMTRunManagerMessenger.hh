@@ -0,0 +1,35 @@
+#ifndef VHDMTRunManagerMessenger_h
+#define VHDMTRunManagerMessenger_h 1
+
+#ifdef G4MULTITHREADED
+
+#include "globals.hh"
+#include "G4UImessenger.hh"
+
+class VHDMTRunManager;
+class G4UIdirectory;
+class G4UIcmdWithABool;
+class G4UIcmdWithADouble;
+class G4UIcmdWithAnInteger;
+
+class VHDMTRunManagerMessenger: public G4UImessenger
+{
+  public:
+
+    VHDMTRunManagerMessenger(VHDMTRunManager* );
+   ~VHDMTRunManagerMessenger();
+
+    void SetNewValue(G4UIcommand*, G4String);
+
+  private:
+
+    VHDMTRunManager* pRunManager;
+    G4UIdirectory*        schedDir;
+    G4UIcmdWithABool*     adaptiveCmd;
+    G4UIcmdWithADouble*   chunkFactorCmd;
+    G4UIcmdWithAnInteger* minChunkCmd;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef VHDMaterialIndices_h
+#define VHDMaterialIndices_h 1
+
+#include "globals.hh"
+
+//Material index of every voxel in 1, 2 or 8 bytes (/VHDMSDv1/det/indexBytes)
+// - the width is chosen when the phantom is loaded: by default the smallest that holds the number of
+//   materials (1 byte up to 256 materials), so the array of a 100M-voxel phantom is 100 MB instead of 800 MB
+//   and a lookup touches 8x fewer cache lines
+// - Get branches on the width, a constant of the run: the branch is always predicted and the lookup stays
+//   inlined in the parameterisations, the voxel table and the writers
+// - owns its array, or wraps one it does not own (a mapped phantom file)
+// - 8 bytes gives the size_t array G4PhantomParameterisation::SetMaterialIndices expects (GetWide)
+class VHDMaterialIndices
+{
+  public:
+    VHDMaterialIndices(G4int nVoxels, G4int bytes);
+    // owned array of zeros
+    VHDMaterialIndices(void* data, G4int nVoxels, G4int bytes);
+    // wraps data, not owned
+    ~VHDMaterialIndices();
+
+    inline size_t Get(G4int copyNo) const;
+    inline void Set(G4int copyNo, size_t index);
+    void Fill(G4int first, G4int last, size_t index);
+    // voxels first .. last-1
+
+    G4int GetBytes() const {return fBytes;}
+    G4int GetNumberOfVoxels() const {return fNVoxels;}
+    const void* GetData() const {return fData;}
+    size_t* GetWide() const {return fBytes == static_cast<G4int>(sizeof(size_t)) ? static_cast<size_t*>(fData) : 0;}
+    // the array as size_t, 0 for the compact widths
+    G4double GetMemory() const {return static_cast<G4double>(fNVoxels)*fBytes;}
+
+    static G4int ChooseBytes(size_t nMaterials, G4int requested = 0);
+    // width for nMaterials: requested (1, 2 or 8) if it holds them, else the smallest that does
+    static G4bool IsValidWidth(G4int bytes) {return bytes == 1 || bytes == 2 || bytes == static_cast<G4int>(sizeof(size_t));}
+
+  private:
+    G4int fNVoxels;
+    G4int fBytes;
+    void* fData;
+    G4bool fOwned;
+};
+
+inline size_t VHDMaterialIndices::Get(G4int copyNo) const
+{
+  switch(fBytes){
+  case 1:
+	return static_cast<const unsigned char*>(fData)[copyNo];
+  case 2:
+	return static_cast<const unsigned short*>(fData)[copyNo];
+  default:
+	return static_cast<const size_t*>(fData)[copyNo];
+  }
+}
+
+inline void VHDMaterialIndices::Set(G4int copyNo, size_t index)
+{
+  switch(fBytes){
+  case 1:
+	static_cast<unsigned char*>(fData)[copyNo] = static_cast<unsigned char>(index);
+	break;
+  case 2:
+	static_cast<unsigned short*>(fData)[copyNo] = static_cast<unsigned short>(index);
+	break;
+  default:
+	static_cast<size_t*>(fData)[copyNo] = index;
+  }
+}
+
+#endif
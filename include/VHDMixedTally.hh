@@ -0,0 +1,74 @@
+#ifndef VHDMixedTally_h
+#define VHDMixedTally_h 1
+
+#include "VHDVTally.hh"
+#include "VHDVoxelLayout.hh"
+
+//Mixed-precision dense backend (/VHDMSDv1/tally/precision mixed) of the collections scored directly
+//(energy deposit, fused cell flux): same role as VHDDenseTally
+// - every voxel is a float sum and a float Neumaier compensation (8 bytes), renormalised at every add; a deposit
+//   is split into its float part and the float remainder, so the pair keeps ~48 bits (in a standalone test, not
+//   in this tree: 1e8 deposits of 1e-6 to 1e-3 add up within 5e-12 of the compensated double sum, where a plain
+//   float sum is 60 % low)
+// - memory: half of the double sum + double compensation of the ordered reduction; with the arrival reduction
+//   (default) the same 8 bytes as the plain double sum, compensated
+// - the reduction of the worker / shard partials is done in double (VHDTallyReducer), then stored back as a pair
+// - check (/VHDMSDv1/tally/precisionCheck): a compensated double shadow of every voxel is filled along, and the
+//   deviation of the float pairs from it is printed at the end of the run (worker tallies are checked at Merge)
+class VHDMixedTally : public VHDVTally
+{
+  public:
+    VHDMixedTally(const G4String& name, G4long nVoxels, G4bool ordered = true, G4bool check = false,
+		  const VHDVoxelLayout* layout = 0);
+    virtual ~VHDMixedTally();
+
+    virtual void Add(G4long copyNo, G4double val);
+    virtual G4double Get(G4long copyNo) const;
+    virtual void Merge(const VHDVTally& other);
+    virtual void GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& val) const;
+    virtual void GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& sum, std::vector<G4double>& comp) const;
+    virtual void SetEntries(const std::vector<G4long>& copyNo, const std::vector<G4double>& sum, const std::vector<G4double>& comp);
+    virtual void Reset();
+    virtual void FirstTouch();
+    virtual void Report() const;
+    virtual G4bool IsCompensated() const {return fOrdered;}
+    // the pairs are always compensated; false keeps them out of the ordered reduction (/VHDMSDv1/tally/reduction arrival)
+
+    void MergeCheck(const VHDVTally& worker);
+    // add the deviations of a worker tally from its shadow into the check of this (master) tally
+
+    static void SetMixed(G4bool val) {sMixed = val;}
+    static G4bool IsMixed() {return sMixed;}
+    static void SetCheck(G4bool val) {sCheck = val;}
+    static G4bool IsCheck() {return sCheck;}
+
+  private:
+    struct CheckStats
+    {
+      G4long nVoxel, nLow;
+      G4double maxRel, sumRel, lowMaxRel, totMixed, totDouble;
+      CheckStats() : nVoxel(0), nLow(0), maxRel(0.), sumRel(0.), lowMaxRel(0.), totMixed(0.), totDouble(0.) {;}
+    };
+    void Check(CheckStats& st) const;
+    // accumulate the deviations of the float pairs from the shadow of this tally
+    void AddPair(G4long k, G4double val);
+    // k: position in the arrays
+    void Allocate();
+    void Free();
+
+    G4long fSize;
+    VHDVoxelLayout fLayout;  //storage order of the arrays (linear or Morton)
+    G4float* fSum;
+    G4float* fComp;
+    G4double* fShadow;      //compensated double reference (check only), else NULL
+    G4double* fShadowComp;
+    G4long fNShadowAdd;     //adds into the shadow since the last reset
+    G4bool fOrdered;
+    G4bool fCheck;
+    CheckStats fMerged;     //checks of the merged worker tallies
+
+    static G4bool sMixed;   //precision of the dense tallies of the next runs
+    static G4bool sCheck;
+};
+
+#endif
@@ -5,40 +5,115 @@
 #include "G4Event.hh"
 
 #include "G4THitsMap.hh"
+#include "VHDVTally.hh"
 #include <vector>
+
+class G4Timer;
+class VHDTallyReducer;
+class VHDEventBuffer;
+class VHDPooledScorer;
+class VHDPerfCounter;
+class VHDLogTally;
+class VHDCacheTally;
 //
 class VHDMultiSDRun : public G4Run {
 
 public:
   // constructor and destructor.
   //  vector of multifunctionaldetector name has to given to constructor.
-  VHDMultiSDRun(const std::vector<G4String> mfdName);
+  //  backend: run store of the collections (see CreateTally), "replica" (default), "atomic", "atomicFloat" or "brick";
+  //  a worker run ignores it and takes the backend of the master run.
+  VHDMultiSDRun(const std::vector<G4String> mfdName, const G4String& backend="replica");
   virtual ~VHDMultiSDRun();
 
 public:
   // virtual method from G4Run. 
   // The method is overriden in this class for scoring.
   virtual void RecordEvent(const G4Event*);
+#ifdef G4MULTITHREADED
+  // Add the HitsMaps of a worker (thread-local) run into this master run.
+  virtual void Merge(const G4Run*);
+  // - Print the busy time, number of events and utilisation of each worker.
+  //   Called on the master run at the end of the run.
+  void PrintWorkerUtilisation();
+#endif
 
   // Access methods for scoring information.
-  // - Number of HitsMap for this RUN. 
+  // - Number of tallies (HitsMap) for this RUN. 
   //   This is equal to number of collections.
-  G4int GetNumberOfHitsMap() const {return theRunMap.size();}
-  // - Get HitsMap of this RUN.
+  G4int GetNumberOfHitsMap() const {return theRunTally.size();}
+  // - Get the tally of this RUN.
+  //   by sequential number and by collection name with full path.
+  VHDVTally* GetTally(G4int i) const {return theRunTally[i];}
+  VHDVTally* GetTally(const G4String& fullName) const;
+  // - Get HitsMap of this RUN (NULL unless the backend is "replica").
   //   by sequential number, by multifucntional name and collection name,
   //   and by collection name with full path.
-  G4THitsMap<G4double>* GetHitsMap(G4int i){return theRunMap[i];}
+  G4THitsMap<G4double>* GetHitsMap(G4int i) const;
   G4THitsMap<G4double>* GetHitsMap(const G4String& detName, 
-				  const G4String& colName);
-  G4THitsMap<G4double>* GetHitsMap(const G4String& fullName);
+				  const G4String& colName) const;
+  G4THitsMap<G4double>* GetHitsMap(const G4String& fullName) const;
   // - Dump All HitsMap of this RUN.
-  //   This method calls G4THisMap::PrintAll() for individual HitsMap.
+  //   This method prints the non-zero entries of the individual tallies.
   void DumpAllScorer();
+  // - Print the statistics of the tally backend (e.g. contention of the shared atomic tallies).
+  void ReportTallies() const;
+  // - Add up the partial tallies staged by Merge(..) / ReadShard(..) in the "ordered" reduction
+  //   (see VHDTallyReducer). Called on the master run before the output is written.
+  void ReduceTallies();
+
+  // - Save all HitsMaps of this RUN to a binary shard file, or add a shard file
+  //   into this RUN (fork mode: each child process runs a shard, see VHDForkRunner).
+  //   order: shard ID, the position of the shard in the ordered reduction.
+  G4bool WriteShard(const G4String& fname) const;
+  G4bool ReadShard(const G4String& fname, G4int order = 0);
 
 private:
   std::vector<G4String> theCollName;
   std::vector<G4int> theCollID;
-  std::vector<G4THitsMap<G4double>*> theRunMap;
+  std::vector<VHDVTally*> theRunTally;
+  std::vector<G4bool> theTallyOwned;  //false for the shared tallies of the master run used by a worker run
+  std::vector<VHDTallyReducer*> theReducer;  //staged partials of each tally ("ordered" reduction), else NULL
+  std::vector<G4bool> theDirect;  //true if the scorer adds straight into the run tally (VHDDirectScorer)
+  std::vector<VHDVTally*> theSlice;  //per energy bin views of the fused cell flux tally (VHDTallySlice)
+  std::vector<VHDPooledScorer*> thePooled;    //the scorer if it can fill an event buffer, else NULL
+  std::vector<VHDEventBuffer*> theEventBuffer; //reusable event store bound to the scorer, else NULL
+  std::vector<G4int> theDirty;        //collections whose event buffer was hit in the current event
+  std::vector<G4int> theHitsMapColl;  //collections scored into a G4THitsMap per event
+  std::vector<VHDLogTally*> theLog;   //run tallies fronted by a deposit log (told the end of each event)
+  std::vector<VHDCacheTally*> theCache; //write-combining caches of the run tallies (flushed at the end of each event)
+  G4bool fEventLoop;  //false for the master run of the MT build, which processes no event
+  G4String fBackend;  //run store of the collections (a worker run: the backend of the master run)
+
+  VHDVTally* CreateTally(const G4String& detName, const G4String& colName,
+			 G4int icol, const G4String& backend, const VHDMultiSDRun* masterRun,
+			 G4bool dense, G4int nBins = 1);
+  void EndOfEventTallies();
+  VHDVTally* CreateStore(const G4String& detName, const G4String& colName,
+			 const G4String& backend, const VHDMultiSDRun* masterRun,
+			 G4bool dense, G4int nVoxels, G4int nBins, G4bool grid);
+  VHDVTally* CreateFusedTally(const G4String& detName, const G4String& colName,
+			      G4int nBins, const G4String& backend, const VHDMultiSDRun* masterRun);
+
+  G4Timer* fTimer;  //wall time since the run was generated (stopped at Merge for a worker run)
+  std::vector<G4int> fWorkerID;       //(master run) thread ID of each merged worker run
+  std::vector<G4int> fWorkerNEvent;   //(master run) number of events processed by the worker
+  std::vector<G4double> fWorkerBusy;  //(master run) wall time [s] spent by the worker in its event loop
+
+  //--- allocation of the event hit containers (/VHDMSDv1/tally/eventPool), including the merged worker runs
+  G4long fNHitsMapAlloc;   //G4THitsMap allocated by the scorers, one per collection and event
+  G4long fNBuffer;         //event buffers of the merged worker runs
+  G4long fNBufferAlloc;    //their allocations
+  G4int fBufferPeak;       //largest number of entries of one event
+  G4long fNMerge;          //collections added into the run tally at the end of an event
+
+  //--- cache misses of the event loop (/VHDMSDv1/tally/countCacheMisses), including the merged worker runs
+  VHDPerfCounter* fPerf;   //counters of the thread that generated the run (NULL on the MT master)
+  G4long fCacheMiss;
+  G4long fCacheRef;
+
+  //--- write-combining caches (/VHDMSDv1/tally/writeCache) of the merged worker runs
+  G4long fWCAdd, fWCHit, fWCEvict, fWCWrite, fWCFlush;
 };
 
 //
@@ -7,6 +7,10 @@
 
 
 class G4Run;
+class VHDRandomMessenger;
+class VHDTallyMessenger;
+class VHDVoxelTable;
+class VHDVTally;
 
 class VHDMultiSDRunAction : public G4UserRunAction
 {
@@ -28,18 +32,38 @@ public:
   {  return (ix + iy*fNx + iz*fNxNy); }
   //void SetRunInfo(G4int count,char dname[],char rname[]);
   void SetRunInfo(char dname[]);
+  // fork mode (see VHDForkRunner): the child process running shard # id is seeded by the parent
+  // and saves its tallies to ShardFileName(id) instead of writing the output images
+  void SetShard(G4int id, G4long seed) {fShardID = id; fShardSeed = seed;}
+  G4String ShardFileName(G4int id) const;
+  // seed of the next runs (/VHDMSDv1/random/seed); 0 ==> NextSeed() mixes the clock and the process ID
+  void SetSeed(G4long seed) {fSeed = seed;}
+  G4long NextSeed() const;
+  // run store of the scored quantities (/VHDMSDv1/tally/backend), see VHDMultiSDRun::CreateTally
+  void SetTallyBackend(const G4String& backend) {fTallyBackend = backend;}
 
 private:
   // Data member 
   // - vector of MultiFunctionalDetecor names.
   std::vector<G4String> theSDName;  
 
+protected:
+  void WriteRoiFluence(const VHDVoxelTable* table, const std::vector<VHDVTally*>& pCellFlux);
+  // compact fluence output over the ROI voxels (/VHDMSDv1/tally/roiFluence)
+
 protected:
   // for conversion of sengment number to copyNo.
   G4int fNx, fNy, fNz,fNxNy,NEbin;
   //char runName[700];
   char dirName[700];
   //G4int rcount;
+  G4int fShardID;  //-1 unless this process runs a shard of a forked run
+  G4long fShardSeed;
+  G4long fSeed;
+  long fSeeds[3];  //zero-terminated seeds given to the engine (the engines keep a pointer to them)
+  VHDRandomMessenger* fRandomMessenger;
+  G4String fTallyBackend;
+  VHDTallyMessenger* fTallyMessenger;
 
 };
 
@@ -12,6 +12,8 @@ class G4VPhysicalVolume;
 class G4VTouchable; 
 class G4VSolid;
 class G4Material;
+class VHDRunLengthLabels;
+class VHDMaterialIndices;
 class G4VisAttributes;
 
 // CSG Entities which may be parameterised/replicated
@@ -48,7 +50,9 @@ class VHDNestedPhantomParameterisation : public G4VNestedParameterisation
     //unsigned int GetMaterialIndex( unsigned int nx, unsigned int ny, unsigned int nz) const;
     unsigned int GetMaterialIndex( unsigned int copyNo) const;
     //void SetMaterialIndices( unsigned int* matInd ) { fMaterialIndices = matInd; }
-    void SetMaterialIndices( size_t* matInd ) { fMaterialIndices = matInd; }
+    void SetMaterialIndices( const VHDMaterialIndices* matInd ) { fMaterialIndices = matInd; }
+    void SetRunLengthLabels( const VHDRunLengthLabels* runs ) { fRunLabels = runs; }
+    // look the material indices up in the runs of the RLE slices when there is no per-voxel array
     void SetNoVoxel( unsigned int nx, unsigned int ny, unsigned int nz );
     void ReadColourData();
     
@@ -94,7 +98,8 @@ class VHDNestedPhantomParameterisation : public G4VNestedParameterisation
     G4double fdX,fdY,fdZ;
     G4int fnX,fnY,fnZ;
     std::vector<G4Material*> fMaterials;
-    size_t* fMaterialIndices; // Index in materials corresponding to each voxel
+    const VHDMaterialIndices* fMaterialIndices; // Index in materials corresponding to each voxel (1, 2 or 8 bytes)
+    const VHDRunLengthLabels* fRunLabels; // used if fMaterialIndices is 0
     // unsigned int* fMaterialIndices; // Index in materials corresponding to each voxel
     std::map<G4String,G4VisAttributes*> fColours;
     //G4int isVis;
@@ -0,0 +1,30 @@
+#ifndef VHDNumaMessenger_h
+#define VHDNumaMessenger_h 1
+
+#include "globals.hh"
+#include "G4UImessenger.hh"
+
+class G4UIdirectory;
+class G4UIcmdWithAString;
+class G4UIcmdWithABool;
+class G4UIcmdWithoutParameter;
+
+class VHDNumaMessenger: public G4UImessenger
+{
+  public:
+
+    VHDNumaMessenger();
+   ~VHDNumaMessenger();
+
+    void SetNewValue(G4UIcommand*, G4String);
+
+  private:
+
+    G4UIdirectory*           numaDir;
+    G4UIcmdWithAString*      pinCmd;
+    G4UIcmdWithABool*        hugePagesCmd;
+    G4UIcmdWithABool*        firstTouchCmd;
+    G4UIcmdWithoutParameter* reportCmd;
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef VHDNumaUtil_h
+#define VHDNumaUtil_h 1
+
+#include "globals.hh"
+#include <vector>
+
+//NUMA helpers for the large voxel arrays and the worker threads (Linux, no libnuma needed)
+// - Allocate/Free: anonymous mmap, optionally backed by transparent huge pages (/VHDMSDv1/numa/hugePages);
+//   the pages are zero and untouched, so each one lands on the NUMA node of the first thread writing into it
+//   (first touch by the workers, not by the master)
+// - PinThisThread: bind a worker thread to the CPUs of one node (/VHDMSDv1/numa/pin compact|spread)
+// - FirstTouch: write every page of a buffer from the calling thread (/VHDMSDv1/numa/firstTouch), so that the
+//   whole buffer is placed on the node of that thread at once and its placement can be reported at start-up
+// - PrintPageNodes: sample the pages of a buffer and print on which node they live
+class VHDNumaUtil
+{
+  public:
+    static G4int GetNumberOfNodes();
+    static std::vector<G4int> GetNodeCPUs(G4int node);
+    static void PrintTopology();
+
+    static void SetPinPolicy(const G4String& policy) {sPinPolicy = policy;}
+    static const G4String& GetPinPolicy() {return sPinPolicy;}
+    static void PinThisThread(G4int workerID);
+    // bind the calling thread to the CPUs of the node chosen for workerID by the pin policy
+
+    static void SetHugePages(G4bool val) {sHugePages = val;}
+    static void* Allocate(size_t bytes);
+    static void Free(void* ptr, size_t bytes);
+
+    static void SetFirstTouch(G4bool val) {sFirstTouch = val;}
+    static G4bool IsFirstTouch() {return sFirstTouch;}
+    static void FirstTouch(void* ptr, size_t bytes);
+
+    static void PrintPageNodes(const G4String& name, const void* ptr, size_t bytes);
+
+  private:
+    static std::vector<G4int> ParseCPUList(const G4String& fname);
+    static G4String sPinPolicy;  //none (default), compact or spread
+    static G4bool sHugePages;
+    static G4bool sFirstTouch;  //false (default): the pages are placed as the scorers hit them
+};
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef VHDPSEnergyDeposit_h
+#define VHDPSEnergyDeposit_h 1
+
+#include "G4VPrimitiveScorer.hh"
+#include "G4THitsMap.hh"
+#include "VHDDirectScorer.hh"
+#include "VHDVoxelIndex.hh"
+
+//same scoring as G4PSEnergyDeposit, but derived from G4VPrimitiveScorer so that the EvtMap (a private variable of
+//G4PSEnergyDeposit) is ours: it stays 0 while the scorer is direct or pooled, and clear/PrintAll check it
+//the deposits go straight into the dense run tally bound by VHDMultiSDRun (see VHDDirectScorer),
+//else into the pooled event buffer of the run (shared backends); no HitsMap is allocated per event then
+//IndexPolicy (VHDRegularIndex or VHDNestedIndex, see VHDVoxelIndex.hh) gives the voxel index of a step at compile time
+template <class IndexPolicy>
+class VHDPSEnergyDeposit : public G4VPrimitiveScorer, public VHDDirectScorer
+{
+   public: // with description
+      VHDPSEnergyDeposit(G4String name,G4int nx,G4int ny, G4int nz,G4int depth=0)
+	:G4VPrimitiveScorer(name,depth),HCID(-1),EvtMap(0),fIndex(nx,ny,nz)
+      {
+	SetUnit("MeV");
+      }
+      virtual ~VHDPSEnergyDeposit()
+      {
+	if(filter){  //'filter' is a private variable that is definied in G4VPrimitiveScorer
+		delete filter;  //delete it if it's defined
+	}
+	G4cout << "destroying VHDPSEnergyDeposit..." << G4endl;
+      }
+
+      virtual void Initialize(G4HCofThisEvent* HCE)
+      {
+	if(fRunTally || fEventBuffer) return;  //the run tally or the run buffer takes the deposits
+	EvtMap = new G4THitsMap<G4double>(detector->GetName(),GetName());
+	if(HCID < 0) HCID = GetCollectionID(0);
+	HCE->AddHitsCollection(HCID,EvtMap);
+      }
+      virtual void EndOfEvent(G4HCofThisEvent*) {;}
+      virtual void clear()
+      {
+	if(EvtMap && !fRunTally && !fEventBuffer) EvtMap->clear();
+      }
+      virtual void DrawAll() {;}
+      virtual void PrintAll()
+      {
+	G4cout << " MultiFunctionalDet  " << detector->GetName() << G4endl;
+	G4cout << " PrimitiveScorer " << GetName() << G4endl;
+	if(fRunTally || fEventBuffer || !EvtMap) return;
+	G4cout << " Number of entries " << EvtMap->entries() << G4endl;
+	std::map<G4int,G4double*>::iterator itr = EvtMap->GetMap()->begin();
+	for(; itr != EvtMap->GetMap()->end(); itr++)
+	{
+		G4cout << "  copy no.: " << itr->first << "  energy deposit: " << *(itr->second)/GetUnitValue() << " [" << GetUnit() << "]" << G4endl;
+	}
+      }
+
+      virtual void SetUnit(const G4String& unit) {CheckAndSetUnit(unit,"Energy");}
+
+  protected: // with description
+      virtual G4int GetIndex(G4Step* aStep) {return fIndex(aStep->GetPreStepPoint()->GetTouchable());}
+      virtual G4bool ProcessHits(G4Step* aStep,G4TouchableHistory*)
+      {
+	G4double edep = aStep->GetTotalEnergyDeposit();
+	if ( edep == 0. ) return FALSE;
+	G4StepPoint* preStep = aStep->GetPreStepPoint();
+	edep *= preStep->GetWeight(); // (Particle Weight)
+	if(fRunTally)		fRunTally->Add(fIndex(preStep->GetTouchable()),edep);
+	else if(fEventBuffer)	fEventBuffer->Add(fIndex(preStep->GetTouchable()),edep);
+	else			EvtMap->add(fIndex(preStep->GetTouchable()),edep);
+	return TRUE;
+      }
+
+  private:
+      G4int HCID;
+      G4THitsMap<G4double>* EvtMap;
+      IndexPolicy fIndex;
+};
+
+typedef VHDPSEnergyDeposit<VHDRegularIndex> VHDPSEnergyDeposit_RegParam;
+typedef VHDPSEnergyDeposit<VHDNestedIndex> VHDPSEnergyDeposit_NestedParam;
+
+#endif
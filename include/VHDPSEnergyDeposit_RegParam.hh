@@ -1,18 +0,0 @@
-#ifndef VHDPSEnergyDeposit_RegParam_h
-#define VHDPSEnergyDeposit_RegParam_h 1
-
-#include "G4PSEnergyDeposit.hh"
-
-//G4PSEnergyDeposit is the derived class of G4VPrimitiveScorer
-
-class VHDPSEnergyDeposit_RegParam : public G4PSEnergyDeposit
-{
-   public: // with description
-      VHDPSEnergyDeposit_RegParam(G4String name,G4int nx,G4int ny, G4int nz);
-      virtual ~VHDPSEnergyDeposit_RegParam();
-
-  private:
-      G4int fNx, fNy, fNz, fNxNy;
-};
-#endif
-
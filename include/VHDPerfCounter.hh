@@ -0,0 +1,34 @@
+#ifndef VHDPerfCounter_h
+#define VHDPerfCounter_h 1
+
+#include "globals.hh"
+
+//Hardware cache counters of the calling thread (Linux perf_event_open, no library needed)
+// - opened and started in the constructor, e.g. by the run of a worker thread; read from any thread
+// - counts the last-level cache references and misses of the thread in user space
+// - enabled with /VHDMSDv1/tally/countCacheMisses (to compare the tally layouts); when the counters are
+//   not available (other OS, perf_event_paranoid) IsValid() is false and the counts are 0
+class VHDPerfCounter
+{
+  public:
+    VHDPerfCounter();
+    ~VHDPerfCounter();
+
+    G4bool IsValid() const {return fMissFD >= 0;}
+    G4long GetCacheMisses() const;
+    G4long GetCacheReferences() const;
+
+    static void SetEnabled(G4bool val) {sEnabled = val;}
+    static G4bool IsEnabled() {return sEnabled;}
+
+  private:
+    static G4int Open(G4int config);
+    static G4long Read(G4int fd);
+
+    G4int fMissFD;
+    G4int fRefFD;
+
+    static G4bool sEnabled;
+};
+
+#endif
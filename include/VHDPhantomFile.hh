@@ -0,0 +1,58 @@
+#ifndef VHDPhantomFile_h
+#define VHDPhantomFile_h 1
+
+#include "globals.hh"
+#include <map>
+
+class VHDPhantomZSliceHeader;
+class VHDMaterialIndices;
+
+//Binary single-file phantom (/VHDMSDv1/det/phantomFile), memory-mapped read-only
+// - a header page (dimensions, extent, organ tag -> material index table of the material files it was
+//   written with) followed by the material index of every voxel, page aligned, in copy number order
+// - the indices are stored with the width of the phantom written (1, 2 or 8 bytes, VHDMaterialIndices), so the
+//   mapped array is handed as is to the parameterisations: nothing is parsed or copied, the pages are read on
+//   first use and the page cache is shared by all the jobs running on the same phantom
+// - written from the Data.dat + .g4m set by /VHDMSDv1/det/writePhantomFile (see VHDDetectorConstruction)
+class VHDPhantomFile
+{
+  public:
+    VHDPhantomFile(const G4String& fname);
+    // map the file, fatal if it is not a phantom file of this build
+    ~VHDPhantomFile();
+
+    G4int GetNoVoxelX() const {return fHeader->nx;}
+    G4int GetNoVoxelY() const {return fHeader->ny;}
+    G4int GetNoVoxelZ() const {return fHeader->nz;}
+    VHDPhantomZSliceHeader* CreateSliceHeader() const;
+    // dimensions and extent of the whole phantom, as merged from the slice headers
+    VHDMaterialIndices* CreateMaterialIndices() const;
+    // wraps the mapped array (read-only: the parameterisations only read it)
+    G4bool CheckOrganTags(const std::map<unsigned int,unsigned int>& organtag2MatIndx) const;
+    // same organ tag -> material index table as when the file was written
+
+    static void Write(const G4String& fname, const VHDPhantomZSliceHeader& header,
+		      const std::map<unsigned int,unsigned int>& organtag2MatIndx, const VHDMaterialIndices& mateIDs);
+
+  private:
+    struct Header {
+      char magic[8];            //"VHDPHAN"
+      unsigned int version;
+      unsigned int byteOrder;   //0x01020304 as written
+      unsigned int indexBytes;  //1, 2 or sizeof(size_t) of the writer
+      unsigned int nTags;       //organ tag table following the header
+      G4int nx, ny, nz, pad;
+      G4double minX, maxX, minY, maxY, minZ, maxZ;
+      unsigned long long dataOffset;  //of the material indices, a multiple of the page size
+      unsigned long long nVoxels;
+    };
+    enum { Version = 1, PageBytes = 4096 };
+
+    const Header* fHeader;
+    const unsigned int* fTags;  //pairs (organ tag, material index)
+    void* fMateIDs;
+    void* fBase;
+    size_t fSize;
+};
+
+#endif
@@ -17,6 +17,11 @@ public:
 
   VHDPhantomZSliceHeader( std::ifstream& fin );
   // build object reading data from a file
+  VHDPhantomZSliceHeader( G4int nx, G4int ny, G4int nz, G4double minX, G4double maxX,
+			  G4double minY, G4double maxY, G4double minZ, G4double maxZ );
+  // build object from the dimensions and extent (binary phantom file, no material names)
+  void Write( std::ostream& fout ) const;
+  // write the header in the format read by VHDPhantomZSliceHeader( std::ifstream& fin )
 
   ~VHDPhantomZSliceHeader(){};
 
@@ -41,7 +46,7 @@ public:
   //G4double GetVoxelHalfY() const { return (fMaxY-fMinY)/(fNoVoxelY-1)/2.; };
   //G4double GetVoxelHalfZ() const { return (fMaxZ-fMinZ)/fNoVoxelZ/2.; };
 
-  std::vector<G4String> GetMaterialNames() const { return fMaterialNames; };
+  const std::vector<G4String>& GetMaterialNames() const { return fMaterialNames; };
  
 
   void SetNoVoxelX(const G4int val) { fNoVoxelX = val; }
@@ -61,10 +66,15 @@ public:
   void operator+=( const VHDPhantomZSliceHeader& rhs );
   VHDPhantomZSliceHeader operator+( const VHDPhantomZSliceHeader& rhs );
   // add two slices that have the same dimensions, merging them in Z 
-
-private:
-  G4bool CheckMaterialExists( const G4String& mateName );
-  // check that material read exists as a G4Material
+  static VHDPhantomZSliceHeader* Merge( const std::vector<VHDPhantomZSliceHeader*>& slices );
+  // merge all the slices in one pass (one copy of the material names), fatal if they do not fit together
+  void CheckSameGrid( const VHDPhantomZSliceHeader& rhs ) const;
+  // same number of voxels and extent in X and Y, same materials (fatal otherwise)
+  void CheckContiguous( const VHDPhantomZSliceHeader& rhs ) const;
+  // rhs is next to this slice in Z (fatal otherwise)
+  G4bool CheckMaterialNames( const std::vector<G4String>& known ) const;
+  // every material name of the header is one of known (the organ names of the material files: the
+  // organ G4Materials are only built after the phantom is read, some merged or not at all)
 
 private:
   G4int fNoVoxelX, fNoVoxelY, fNoVoxelZ;  // number of voxels in each dimensions
@@ -0,0 +1,57 @@
+#ifndef VHDPhiloxEngine_h
+#define VHDPhiloxEngine_h 1
+
+#include "globals.hh"
+#include "CLHEP/Random/RandomEngine.h"
+#include <stdint.h>
+
+//Counter-based random engine (Philox4x32-10, Salmon et al. SC'11)
+// - the random numbers are a pure function of a key (the run seed) and a counter; the counter holds
+//   the stream (event) number and the position in the stream, so there is no state to carry from event to event
+// - SetEventStream(eventID) is called at the beginning of every event (VHDPrimaryGeneratorAction::GeneratePrimaries):
+//   event i of a run always uses the stream (run seed, first event + i), whatever the thread or forked process
+//   that processes it ==> any event can be regenerated alone and the threads/shards never share a stream
+// - selected with /VHDMSDv1/random/engine philox (the default engine is RanecuEngine)
+class VHDPhiloxEngine : public CLHEP::HepRandomEngine
+{
+  public:
+    VHDPhiloxEngine();
+    VHDPhiloxEngine(long seed);
+    virtual ~VHDPhiloxEngine();
+
+    virtual double flat();
+    virtual void flatArray(const int size, double* vect);
+    virtual void setSeed(long seed, int dum=0);
+    virtual void setSeeds(const long* seeds, int dum=0);
+    virtual void saveStatus(const char filename[] = "Philox.conf") const;
+    virtual void restoreStatus(const char filename[] = "Philox.conf");
+    virtual void showStatus() const;
+    virtual std::string name() const {return "VHDPhiloxEngine";}
+
+    void SetStream(G4long stream);
+    // restart at the beginning of the stream # stream of the current key
+
+    // the run seed and the stream of the first event are shared by the engines of all the threads
+    static void SetRunSeed(G4long seed);
+    static void SetEventOffset(G4long offset) {sEventOffset = offset;}
+    static G4long GetEventOffset() {return sEventOffset;}
+    static G4bool IsActive();
+    // true if the engine of this thread is a VHDPhiloxEngine
+    static void SetEventStream(G4int eventID);
+    // key the engine of this thread (if it is a VHDPhiloxEngine) with (run seed, first event + eventID)
+
+  private:
+    void NextBlock();
+    // encrypt the counter with the key ==> 4x32 random bits = 2 doubles, then increment the counter
+
+  private:
+    uint32_t fKey[2];
+    uint32_t fCtr[4];   //[0],[1]: block number in the stream; [2],[3]: stream number
+    double fBuffer[2];
+    G4int fNext;        //next unused entry of fBuffer
+
+    static uint32_t sRunKey[2];
+    static G4long sEventOffset;
+};
+
+#endif
@@ -19,6 +19,8 @@ public:
   void SetDefaultCutValue(G4double cut) {defaultCutValue = cut;};
   void SetCuts();
   void AddPhysicsList(const G4String& name);
+  virtual void BuildPhysicsTable();
+  // builds the tables of all the material-cuts couples and prints the time and the memory it took (master)
   
 private:
    VHDPhysicsListMessenger* pMessenger;
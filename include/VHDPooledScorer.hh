@@ -0,0 +1,23 @@
+#ifndef VHDPooledScorer_h
+#define VHDPooledScorer_h 1
+
+#include "VHDEventBuffer.hh"
+
+//Mix-in of the primitive scorers that fill a reusable event store instead of a new G4THitsMap per event
+// - VHDMultiSDRun binds a VHDEventBuffer of its own at the creation of the run (SetEventBuffer), adds it
+//   into the run tally in RecordEvent and resets it; it unbinds it when the run is deleted
+// - with no buffer bound the scorer allocates and fills its event HitsMap as usual
+class VHDPooledScorer
+{
+  public:
+    VHDPooledScorer() : fEventBuffer(0) {;}
+    virtual ~VHDPooledScorer() {;}
+
+    void SetEventBuffer(VHDEventBuffer* buffer) {fEventBuffer = buffer;}
+    G4bool IsPooled() const {return fEventBuffer != 0;}
+
+  protected:
+    VHDEventBuffer* fEventBuffer;
+};
+
+#endif
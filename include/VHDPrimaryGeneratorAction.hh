@@ -13,6 +13,7 @@ class VHDPrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction
 {
   public:
     VHDPrimaryGeneratorAction(const G4String& dname, const G4int isSparse);
+    VHDPrimaryGeneratorAction(const VHDPrimaryGeneratorAction* master);  //share the source map already read by the master (MT workers)
     ~VHDPrimaryGeneratorAction();
 
   public:
@@ -34,6 +35,7 @@ class VHDPrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction
     G4int fNoFiles; // number of DoseMap files
     G4int nfile;
     std::map<G4double,G4int> theProbAccum, probAccum;
+    const std::map<G4double,G4int>* fProbAccum;  //points to theProbAccum or to the master's copy of it
     G4double theProbSum;
 
     G4int NVoxelX;
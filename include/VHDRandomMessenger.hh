@@ -0,0 +1,30 @@
+#ifndef VHDRandomMessenger_h
+#define VHDRandomMessenger_h 1
+
+#include "globals.hh"
+#include "G4UImessenger.hh"
+
+class VHDMultiSDRunAction;
+class G4UIdirectory;
+class G4UIcmdWithAString;
+class G4UIcmdWithAnInteger;
+
+class VHDRandomMessenger: public G4UImessenger
+{
+  public:
+
+    VHDRandomMessenger(VHDMultiSDRunAction* );
+   ~VHDRandomMessenger();
+
+    void SetNewValue(G4UIcommand*, G4String);
+
+  private:
+
+    VHDMultiSDRunAction* pRunAction;
+    G4UIdirectory*        randomDir;
+    G4UIcmdWithAString*   engineCmd;
+    G4UIcmdWithAString*   seedCmd;
+    G4UIcmdWithAnInteger* firstEventCmd;
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef VHDRoiTally_h
+#define VHDRoiTally_h 1
+
+#include "VHDVTally.hh"
+#include "VHDVoxelTable.hh"
+
+//ROI view of a [voxel][bin] fluence tally (/VHDMSDv1/tally/roiFluence)
+// - the cell flux is only scored in the voxels of an organ of interest: the data tally (any backend) is
+//   sized nRoi*nBins and indexed by the compact ROI index of the voxel table, not by the voxel
+// - the interface stays in voxel copy numbers (copyNo = voxel*nBins + bin), so the scorers and the output
+//   code see the usual tally; a voxel outside the ROI reads 0 and a hit in it is dropped (none is expected:
+//   the cell flux scorers test the voxel first)
+// - owns the data tally; shared, compensated and reduced as the data tally is
+class VHDRoiTally : public VHDVTally
+{
+  public:
+    VHDRoiTally(const G4String& name, VHDVTally* data, const VHDVoxelTable* table, G4int nBins = 1);
+    virtual ~VHDRoiTally();
+
+    virtual void Add(G4long copyNo, G4double val);
+    virtual void Add(const VHDEventBuffer& evtBuf);
+    virtual G4double Get(G4long copyNo) const;
+    virtual void Merge(const VHDVTally& other);
+    virtual void GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& val) const;
+    virtual void GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& sum, std::vector<G4double>& comp) const;
+    virtual void SetEntries(const std::vector<G4long>& copyNo, const std::vector<G4double>& sum, const std::vector<G4double>& comp);
+    virtual void Reset();
+    virtual void Report() const;
+    virtual void Describe() const;
+    virtual void FirstTouch();
+    virtual G4bool IsShared() const {return fData->IsShared();}
+    virtual G4bool IsCompensated() const {return fData->IsCompensated();}
+
+    static void SetEnabled(G4bool val) {sEnabled = val;}
+    static G4bool IsEnabled() {return sEnabled;}
+    // fluence tallies of the next runs sized by the ROI
+
+  private:
+    inline G4long ToRoi(G4long copyNo) const;
+    // copy number in the data tally, -1 outside the ROI
+    void ToVoxel(std::vector<G4long>& copyNo) const;
+
+    VHDVTally* fData;
+    const VHDVoxelTable* fTable;
+    G4int fNBins;
+    G4int fNVoxels;
+
+    static G4bool sEnabled;
+};
+
+inline G4long VHDRoiTally::ToRoi(G4long copyNo) const
+{
+  if(copyNo < 0 || copyNo >= static_cast<G4long>(fNVoxels)*fNBins) return -1;
+  G4int voxel = static_cast<G4int>(copyNo/fNBins);
+  G4int bin = static_cast<G4int>(copyNo - static_cast<G4long>(voxel)*fNBins);
+  G4int roi = fTable->GetRoiIndex(voxel);
+  return roi < 0 ? -1 : static_cast<G4long>(roi)*fNBins + bin;
+}
+
+#endif
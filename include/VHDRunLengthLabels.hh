@@ -0,0 +1,56 @@
+#ifndef VHDRunLengthLabels_h
+#define VHDRunLengthLabels_h 1
+
+#include "globals.hh"
+#include <vector>
+#include <algorithm>
+
+class VHDMaterialIndices;
+
+//Material indices of the phantom as runs of identical voxels (RLE slices, compression 1 in Data.dat)
+// - a run is its first copy number and its material index; runs continue across rows and slices and two
+//   consecutive runs of the same material are joined
+// - Expand: the full per-voxel array, the runs cut in one chunk per thread and written in parallel (MT builds)
+// - GetMaterialIndex: run-aware lookup without the array (/VHDMSDv1/det/runLookup, nested geometry):
+//   the runs overlapping the row of the voxel are found from a per-row table and searched by bisection
+class VHDRunLengthLabels
+{
+  public:
+    VHDRunLengthLabels() : fNVoxels(0), fNx(1) {;}
+    ~VHDRunLengthLabels() {;}
+
+    void AddRun(unsigned int index, G4int length);
+    // append length voxels of material index
+    void Finish(G4int nx);
+    // after the last run: builds the row table (nx voxels per row)
+    void Expand(VHDMaterialIndices* mateIDs, G4int nThreads = 0) const;
+    // fill the per-voxel array of the GetNumberOfVoxels() voxels (0 threads: one per core; serial without G4MULTITHREADED)
+    inline unsigned int GetMaterialIndex(G4int copyNo) const;
+
+    G4int GetNumberOfVoxels() const {return fNVoxels;}
+    G4int GetNumberOfRuns() const {return fIndex.size();}
+    unsigned int GetRunIndex(G4int ir) const {return fIndex[ir];}
+    // material index of run ir
+    G4double GetMemory() const;
+    // bytes of the runs and the row table
+
+  private:
+    void ExpandRuns(G4int first, G4int last, VHDMaterialIndices* mateIDs) const;
+
+    G4int fNVoxels;
+    G4int fNx;
+    std::vector<G4int> fStart;         //first copy number of each run, then fNVoxels
+    std::vector<unsigned int> fIndex;  //material index of each run
+    std::vector<G4int> fRowRun;        //run holding the first voxel of each row, then the last run
+};
+
+inline unsigned int VHDRunLengthLabels::GetMaterialIndex(G4int copyNo) const
+{
+  G4int row = copyNo/fNx;
+  //runs fRowRun[row] .. fRowRun[row+1] cover the row: the last one starting at or before copyNo
+  std::vector<G4int>::const_iterator first = fStart.begin() + fRowRun[row];
+  std::vector<G4int>::const_iterator last = fStart.begin() + fRowRun[row+1] + 1;
+  return fIndex[std::upper_bound(first,last,copyNo) - fStart.begin() - 1];
+}
+
+#endif
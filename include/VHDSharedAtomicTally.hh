@@ -0,0 +1,67 @@
+#ifndef VHDSharedAtomicTally_h
+#define VHDSharedAtomicTally_h 1
+
+#ifdef G4MULTITHREADED
+
+#include "VHDVTally.hh"
+#include "VHDVoxelLayout.hh"
+#include "G4Threading.hh"
+#include <atomic>
+
+//Shared dense backend ("atomic": double, "atomicFloat": float), multi-threaded mode only
+// - one grid of nVoxels values owned by the master run; every worker adds into it with atomic
+//   compare-and-swap, so the memory does not grow with the number of threads and there is nothing to merge
+// - a failed compare-and-swap means that another thread updated the same voxel at the same time:
+//   the retries are counted per block of BlockSize copy numbers and the hottest blocks are reported at the end of the run
+// - the adds and retries are counted per thread, in a cache line of its own, and summed in Report: the direct
+//   scorers add step by step and must not all update one shared counter
+// - the grid comes from VHDNumaUtil::Allocate (first touch by the workers, optional huge pages)
+// - the grid is in the order of the layout (linear or Morton, see VHDVoxelLayout), the blocks in copy numbers
+template <class T>
+class VHDSharedAtomicTally : public VHDVTally
+{
+  public:
+    VHDSharedAtomicTally(const G4String& name, G4long nVoxels, const VHDVoxelLayout* layout = 0);
+    virtual ~VHDSharedAtomicTally();
+
+    virtual void Add(G4long copyNo, G4double val);
+    virtual void Add(const G4THitsMap<G4double>& evtMap);
+    virtual void Add(const VHDEventBuffer& evtBuf);
+    virtual G4double Get(G4long copyNo) const;
+    virtual void Merge(const VHDVTally& other);
+    virtual void GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& val) const;
+    virtual void Reset();
+    virtual void Report() const;
+    virtual void Describe() const;
+    virtual G4bool IsShared() const {return true;}
+
+  private:
+    G4int AtomicAdd(G4long copyNo, T val);
+    // returns the number of compare-and-swap retries
+    inline void Count(unsigned long nadd, unsigned long nretry);
+    // add to the counters of the calling thread
+
+  private:
+    enum { BlockSize = 4096 };
+    G4long fSize;
+    VHDVoxelLayout fLayout;
+    std::atomic<T>* fData;
+    G4int fNBlock;
+    std::atomic<unsigned long>* fBlockRetry;  //retries per block of copy numbers
+    struct Counter { unsigned long nadd, nretry; char pad[64 - 2*sizeof(unsigned long)]; };
+    G4int fNCounter;
+    Counter* fCounter;  //per thread: [0] the master (Merge), [1 + thread ID] the workers
+};
+
+template <class T>
+inline void VHDSharedAtomicTally<T>::Count(unsigned long nadd, unsigned long nretry)
+{
+  G4int i = G4Threading::G4GetThreadId() + 1;
+  if(i < 0 || i >= fNCounter) i = 0;  //(not a worker of the run that created the tally)
+  fCounter[i].nadd += nadd;
+  fCounter[i].nretry += nretry;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef VHDTallyMessenger_h
+#define VHDTallyMessenger_h 1
+
+#include "globals.hh"
+#include "G4UImessenger.hh"
+
+class VHDMultiSDRunAction;
+class G4UIdirectory;
+class G4UIcmdWithAString;
+class G4UIcmdWithAnInteger;
+class G4UIcmdWithABool;
+
+class VHDTallyMessenger: public G4UImessenger
+{
+  public:
+
+    VHDTallyMessenger(VHDMultiSDRunAction* );
+   ~VHDTallyMessenger();
+
+    void SetNewValue(G4UIcommand*, G4String);
+
+  private:
+
+    VHDMultiSDRunAction* pRunAction;
+    G4UIdirectory*        tallyDir;
+    G4UIcmdWithAString*   backendCmd;
+    G4UIcmdWithAString*   reductionCmd;
+    G4UIcmdWithAnInteger* reductionBlockCmd;
+    G4UIcmdWithABool*     eventPoolCmd;
+    G4UIcmdWithAString*   precisionCmd;
+    G4UIcmdWithABool*     precisionCheckCmd;
+    G4UIcmdWithAString*   layoutCmd;
+    G4UIcmdWithABool*     cacheMissCmd;
+    G4UIcmdWithAString*   hashCmd;
+    G4UIcmdWithAnInteger* denseLimitCmd;
+    G4UIcmdWithABool*     roiCmd;
+    G4UIcmdWithABool*     depositLogCmd;
+    G4UIcmdWithAnInteger* logBatchCmd;
+    G4UIcmdWithAnInteger* writeCacheCmd;
+};
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef VHDTallyReducer_h
+#define VHDTallyReducer_h 1
+
+#include "globals.hh"
+#include <vector>
+
+//Deterministic reduction of the partial tallies of one scored quantity ("ordered" reduction, /VHDMSDv1/tally/reduction)
+// - the partials (one per worker thread or forked shard) are staged with their thread/shard ID and only
+//   added up at the end of the run, in a fixed pairwise tree ordered by that ID
+// - every compensated tally accumulates with Add: value = sum + comp, where sum holds multiples of 2^-8 and
+//   comp multiples of 2^-60 below 2^-9 (binned summation with two fixed bins); a value is rounded once, to
+//   2^-60, when it is split, and then every addition is exact, i.e. associative: the result only depends on
+//   the values added, not on their order nor on how they are split among threads and partials
+// - with events seeded one by one (Philox streams, or the per-event seeds of the MT run manager) the event
+//   sums do not depend on the worker either, so Edep%03d.raw is bit-identical for any number of worker
+//   threads; exact as long as a voxel total stays below 2^43 (~9e12 in internal units, e.g. MeV)
+// - the voxel range is cut in blocks of GetBlockSize() copy numbers; only the blocks hit by some partial
+//   are reduced, in parallel (MT build)
+class VHDTallyReducer
+{
+  public:
+    VHDTallyReducer();
+    ~VHDTallyReducer();
+
+    void AddPartial(G4int order, std::vector<G4long>& copyNo, std::vector<G4double>& sum, std::vector<G4double>& comp);
+    // stage the partial of thread/shard # order (the vectors are swapped in, in increasing copy number)
+    G4int GetNumberOfPartials() const {return fPartials.size();}
+    void Reduce(std::vector<G4long>& copyNo, std::vector<G4double>& sum, std::vector<G4double>& comp, G4int nThreads = 1);
+    // add up all the staged partials and clear them
+    void Clear();
+
+    static void SetOrdered(G4bool val) {sOrdered = val;}
+    static G4bool IsOrdered() {return sOrdered;}
+    static void SetBlockSize(G4int n) {if(n > 0) sBlockSize = n;}
+    static G4int GetBlockSize() {return sBlockSize;}
+
+    static inline void Add(G4double& s, G4double& c, G4double v);
+    // exact step of the two-bin sum: s + c += v (v rounded to a multiple of 2^-60)
+
+  private:
+    struct Partial
+    {
+      G4int order;
+      std::vector<G4long> copyNo;
+      std::vector<G4double> sum;
+      std::vector<G4double> comp;
+    };
+    struct Block
+    {
+      std::vector<G4long> copyNo;
+      std::vector<G4double> sum;
+      std::vector<G4double> comp;
+    };
+    static G4bool LessOrder(const Partial* a, const Partial* b) {return a->order < b->order;}
+
+    void ReduceBlocks(G4int ithread, G4int nThreads, const std::vector<G4long>* blocks, std::vector<Block>* out) const;
+
+    std::vector<Partial*> fPartials;
+    static G4bool sOrdered;   //true: stage and reduce in a fixed tree; false (default): add in order of arrival
+    static G4int sBlockSize;  //copy numbers per reduction block
+};
+
+//  x + 1.5*2^44 - 1.5*2^44 rounds x to a multiple of 2^-8 (the ulp of 1.5*2^44), x + 1.5*2^-8 - 1.5*2^-8
+//  to a multiple of 2^-60. v - hi is exact (Sterbenz), and so are the sums on each grid.
+//  (IEEE double arithmetic: no -ffast-math, no x87 extended precision)
+inline void VHDTallyReducer::Add(G4double& s, G4double& c, G4double v)
+{
+  const G4double splitSum = 1.5*17592186044416.;  //1.5*2^44
+  const G4double splitComp = 1.5/256.;            //1.5*2^-8
+  G4double hi = (v + splitSum) - splitSum;
+  G4double lo = ((v - hi) + splitComp) - splitComp;
+  s += hi;
+  c += lo;
+  G4double carry = (c + splitSum) - splitSum;  //keeps |c| <= 2^-9
+  s += carry;
+  c -= carry;
+}
+
+#endif
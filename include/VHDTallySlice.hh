@@ -0,0 +1,43 @@
+#ifndef VHDTallySlice_h
+#define VHDTallySlice_h 1
+
+#include "VHDVTally.hh"
+
+//Read/write view of one bin of a [voxel][bin] tally: copy number c of the slice is c*nBins + bin of the parent
+// - lets the output code look up the fused cell flux tensor (VHDVoxelSD) bin by bin, under the collection
+//   names of the legacy scorers (PhantomSD/PhotonCellFlux%02d)
+// - the parent owns the data: Merge and Reset are left to it
+class VHDTallySlice : public VHDVTally
+{
+  public:
+    VHDTallySlice(const G4String& name, VHDVTally* parent, G4int bin, G4int nBins)
+      : VHDVTally(name), fParent(parent), fBin(bin), fNBins(nBins) {;}
+    virtual ~VHDTallySlice() {;}
+
+    virtual void Add(G4long copyNo, G4double val) {fParent->Add(copyNo*fNBins + fBin,val);}
+    virtual G4double Get(G4long copyNo) const {return fParent->Get(copyNo*fNBins + fBin);}
+    virtual void Merge(const VHDVTally&) {;}
+    virtual void GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& val) const
+    {
+      std::vector<G4long> c;
+      std::vector<G4double> v;
+      fParent->GetEntries(c,v);
+      copyNo.clear();
+      val.clear();
+      for(size_t i = 0; i < c.size(); i++)
+      {
+	if(c[i] % fNBins != fBin) continue;
+	copyNo.push_back(c[i]/fNBins);
+	val.push_back(v[i]);
+      }
+    }
+    virtual void Reset() {;}
+    virtual void FillZSlice(G4int iz, G4int nxny, G4double* img, G4int bin = 0, G4int nBins = 1) const
+    { fParent->FillZSlice(iz,nxny,img,bin*fNBins + fBin,nBins*fNBins); }
+
+  private:
+    VHDVTally* fParent;
+    G4int fBin, fNBins;
+};
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef VHDVTally_h
+#define VHDVTally_h 1
+
+#include "globals.hh"
+#include "G4THitsMap.hh"
+#include "VHDEventBuffer.hh"
+#include <vector>
+
+//Run-level store of one scored quantity (one primitive scorer collection of the MFD), indexed by copy number
+// - VHDMultiSDRun keeps one VHDVTally per collection and adds the G4THitsMap of every event into it
+// - the backend is chosen per run with /VHDMSDv1/tally/backend (see VHDMultiSDRun::CreateTally)
+// - copy numbers are G4long: voxel*nBins + bin of a fused tally exceeds a G4int on large phantoms
+class VHDVTally
+{
+  public:
+    VHDVTally(const G4String& name) : fName(name) {;}
+    virtual ~VHDVTally() {;}
+
+    virtual void Add(G4long copyNo, G4double val) = 0;
+    virtual void Add(const G4THitsMap<G4double>& evtMap);
+    // add the HitsMap of one event (default: one Add per entry)
+    virtual void Add(const VHDEventBuffer& evtBuf);
+    // add the pooled event store of a scorer (see VHDPooledScorer)
+    virtual G4double Get(G4long copyNo) const = 0;
+    // 0 if nothing was scored in copyNo
+    virtual void Merge(const VHDVTally& other) = 0;
+    // add the tally of a worker run into this one (nothing to do if both are the same shared tally)
+    virtual void GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& val) const = 0;
+    // copy numbers and values of the non-zero entries, in increasing copy number
+    virtual void Reset() = 0;
+    virtual void Report() const {;}
+    // print the backend statistics at the end of the run
+    virtual void Describe() const {;}
+    // print the backend and its size (once, when the master run creates the tally)
+    virtual void FirstTouch() {;}
+    // touch the thread-private storage from the calling (worker) thread and print the NUMA node of its pages
+    virtual G4bool IsShared() const {return false;}
+    // true if all the threads add into this very object
+    virtual G4bool IsCompensated() const {return false;}
+    // true if every entry keeps the compensation of its sum (see VHDTallyReducer)
+    virtual void GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& sum, std::vector<G4double>& comp) const;
+    // sums and compensation terms apart (default: no compensation)
+    virtual void SetEntries(const std::vector<G4long>& copyNo, const std::vector<G4double>& sum, const std::vector<G4double>& comp);
+    // replace the content, e.g. by the result of VHDTallyReducer::Reduce
+    virtual void FillZSlice(G4int iz, G4int nxny, G4double* img, G4int bin = 0, G4int nBins = 1) const;
+    // img[ix + iy*nx] = value of voxel (ix,iy,iz), bin of nBins per voxel (output writers)
+
+    const G4String& GetName() const {return fName;}
+
+  protected:
+    G4String fName;  //<MFD name>/<primitive scorer name>
+};
+
+inline void VHDVTally::Add(const G4THitsMap<G4double>& evtMap)
+{
+  std::map<G4int,G4double*>::iterator itr = evtMap.GetMap()->begin();
+  for(; itr != evtMap.GetMap()->end(); itr++) Add(itr->first,*(itr->second));
+}
+
+inline void VHDVTally::Add(const VHDEventBuffer& evtBuf)
+{
+  G4int n = evtBuf.GetNumberOfEntries();
+  for(G4int i = 0; i < n; i++) Add(evtBuf.GetCopyNo(i),evtBuf.GetValue(i));
+}
+
+inline void VHDVTally::GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& sum, std::vector<G4double>& comp) const
+{
+  GetEntries(copyNo,sum);
+  comp.assign(sum.size(),0.);
+}
+
+inline void VHDVTally::SetEntries(const std::vector<G4long>& copyNo, const std::vector<G4double>& sum, const std::vector<G4double>& comp)
+{
+  Reset();
+  for(size_t i = 0; i < copyNo.size(); i++) Add(copyNo[i],sum[i] + comp[i]);
+}
+
+inline void VHDVTally::FillZSlice(G4int iz, G4int nxny, G4double* img, G4int bin, G4int nBins) const
+{
+  G4long c0 = static_cast<G4long>(iz)*nxny;
+  for(G4int i = 0; i < nxny; i++) img[i] = Get((c0 + i)*nBins + bin);
+}
+
+#endif
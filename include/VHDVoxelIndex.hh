@@ -0,0 +1,43 @@
+#ifndef VHDVoxelIndex_h
+#define VHDVoxelIndex_h 1
+
+#include "globals.hh"
+#include "G4VTouchable.hh"
+#include "G4NavigationHistory.hh"
+
+//Voxel index policies of the templated scorers (VHDMSDCellFlux, VHDPSEnergyDeposit, VHDMSDNofStep)
+//and of VHDVoxelSD: map the touchable of the pre-step point to ix + iy*nx + iz*nx*ny.
+//The replica numbers are read from the navigation history of the touchable (one virtual call)
+//instead of one virtual GetReplicaNumber(depth) call per level; the index math is inlined.
+
+//RegularVHDDetectorConstruction: one parameterised volume over all the voxels, the copy number is the index
+class VHDRegularIndex
+{
+  public:
+    VHDRegularIndex(G4int =0, G4int =0, G4int =0) {;}
+
+    inline G4int operator()(const G4VTouchable* touchable) const
+    {
+      const G4NavigationHistory* history = touchable->GetHistory();
+      return history->GetReplicaNo(history->GetDepth());
+    }
+};
+
+//NestedParamVHDDetectorConstruction: replicas along y (depth 2) and x (depth 1), parameterised along z (depth 0)
+class VHDNestedIndex
+{
+  public:
+    VHDNestedIndex(G4int nx =0, G4int ny =0, G4int =0) : fNx(nx), fNxNy(nx*ny) {;}
+
+    inline G4int operator()(const G4VTouchable* touchable) const
+    {
+      const G4NavigationHistory* history = touchable->GetHistory();
+      G4int depth = history->GetDepth();
+      return history->GetReplicaNo(depth-1) + history->GetReplicaNo(depth-2)*fNx + history->GetReplicaNo(depth)*fNxNy;
+    }
+
+  private:
+    G4int fNx, fNxNy;
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef VHDVoxelLayout_h
+#define VHDVoxelLayout_h 1
+
+#include "globals.hh"
+#include <vector>
+
+//Storage order of the dense tallies (VHDDenseTally, VHDMixedTally, VHDSharedAtomicTally), /VHDMSDv1/tally/layout
+// - linear: the copy number ix + iy*nx + iz*nx*ny (times nBins plus the bin for the fused cell flux)
+// - morton: Z-order of (ix,iy,iz), so that the neighbours of a voxel in y and z are close in memory
+//   (the bins of a voxel stay contiguous); each axis is padded to a power of two, the padding is
+//   never touched and costs no memory (zero pages of VHDNumaUtil::Allocate)
+// - the tallies keep their copy number interface: the output is read in linear order with Get(copyNo)
+// - one table per axis spreads the bits of a coordinate, so a copy number is converted with two
+//   divisions and three lookups in tables of nx+ny+nz entries
+class VHDVoxelLayout
+{
+  public:
+    VHDVoxelLayout(G4long nVoxels = 0);
+    // linear layout of nVoxels copy numbers
+    VHDVoxelLayout(G4int nx, G4int ny, G4int nz, G4int nBins, G4bool morton);
+
+    inline G4long ToStorage(G4long copyNo) const;
+    // position of copy number copyNo in the storage array
+    G4long GetStorageSize() const {return fStorage;}
+    G4bool IsMorton() const {return fMorton;}
+    void Print() const;
+    // print the padded grid of a morton layout
+
+    static void SetMorton(G4bool val) {sMorton = val;}
+    static G4bool IsMortonDefault() {return sMorton;}
+    // layout of the dense tallies of the next runs
+
+  private:
+    G4bool fMorton;
+    G4int fNx, fNy, fNz, fNBins;
+    G4int fPad[3];  //grid padded to powers of two (morton only)
+    G4long fStorage;
+    std::vector<G4long> fX, fY, fZ;  //spread bits of each coordinate (morton only)
+
+    static G4bool sMorton;
+};
+
+inline G4long VHDVoxelLayout::ToStorage(G4long copyNo) const
+{
+  if(!fMorton) return copyNo;
+  //the voxel index fits a G4int (geometry copy number), the fused copy number may not
+  G4int voxel = static_cast<G4int>(copyNo), bin = 0;
+  if(fNBins > 1){
+	voxel = static_cast<G4int>(copyNo/fNBins);
+	bin = static_cast<G4int>(copyNo - static_cast<G4long>(voxel)*fNBins);
+  }
+  G4int r = voxel/fNx;
+  G4int ix = voxel - r*fNx;
+  G4int iz = r/fNy;
+  G4int iy = r - iz*fNy;
+  return (fX[ix] | fY[iy] | fZ[iz])*fNBins + bin;
+}
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef VHDVoxelSD_h
+#define VHDVoxelSD_h 1
+
+#include "G4VSensitiveDetector.hh"
+#include "VHDVTally.hh"
+#include "VHDVoxelIndex.hh"
+#include <vector>
+
+class G4ParticleDefinition;
+class VHDVoxelTable;
+
+//Fused voxel sensitive detector ("fused" scoring, the default; see /VHDMSDv1/det/scoring)
+// - replaces the G4MultiFunctionalDetector with one totalEDep scorer and one cell flux scorer + energy filter
+//   per energy bin: the voxel index, the organ test and the particle test are done once per step and the
+//   energy bin is found by binary search over the Energybin1/2.txt edges
+// - same quantities as the legacy scorers: energy deposit x weight per voxel, and step length / voxel volume
+//   of e- / gamma (per SetParticleFlag) in the organs of interest, in bin i if E_(i-1) <= Ekin < E_i
+//   (pre-step kinetic energy, E_-1 = 0)
+// - no hits collection: VHDMultiSDRun binds a run tally for the energy deposit (nVoxels) and one for the
+//   [voxel][bin] cell flux tensor (copy number = voxel*nBins + bin) with SetRunTallies(..)
+class VHDVoxelSD : public G4VSensitiveDetector
+{
+  public:
+    VHDVoxelSD(const G4String& name, G4int nx, G4int ny, G4int nz, G4bool nested);
+    virtual ~VHDVoxelSD();
+
+    void SetVoxelTable(const VHDVoxelTable* table) {fTable = table;}
+    // voxel volume and organs of interest
+    void SetEnergyBins(const std::vector<G4double>& upperEdges) {fEdges = upperEdges;}
+    // upper edges of the energy bins (with units)
+    void SetParticles(G4bool electron, G4bool photon);
+
+    G4int GetNumberOfVoxels() const {return fNx*fNy*fNz;}
+    G4int GetNumberOfBins() const {return fEdges.size();}
+    void SetRunTallies(VHDVTally* edep, VHDVTally* flux) {fEdepTally = edep; fFluxTally = flux;}
+
+  protected:
+    virtual G4bool ProcessHits(G4Step*,G4TouchableHistory*);
+
+  private:
+    inline G4int GetIndex(G4Step*) const;
+
+    G4int fNx, fNy, fNz;
+    G4bool fNested;  //voxel index from the replica numbers of the nested parameterisation (else the copy number)
+    VHDRegularIndex fRegularIndex;
+    VHDNestedIndex fNestedIndex;
+    const VHDVoxelTable* fTable;
+    std::vector<G4double> fEdges;
+    const G4ParticleDefinition* fElectron;  //NULL if not scored
+    const G4ParticleDefinition* fPhoton;
+    VHDVTally* fEdepTally;
+    VHDVTally* fFluxTally;
+};
+
+#endif
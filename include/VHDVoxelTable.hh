@@ -0,0 +1,73 @@
+#ifndef VHDVoxelTable_h
+#define VHDVoxelTable_h 1
+
+#include "globals.hh"
+#include <vector>
+#include <map>
+#include "VHDRunLengthLabels.hh"
+#include "VHDMaterialIndices.hh"
+
+class G4Material;
+class VHDVTally;
+
+//Per-voxel scoring metadata, built once by VHDDetectorConstruction after the phantom is read
+// - all the voxels are the same box: one voxel volume for the cell flux
+// - per organ label (the index stored in the voxels, see Organtag2MatIndx): density, voxel mass and organ tag,
+//   so a voxel needs only its label; organs of the same composition share one G4Material but keep their label
+// - organs of interest (the only ones where the cell flux is scored): one flag per organ label, so
+//   IsOfInterest is the label lookup of the voxel plus one flag
+// - ROI: the voxels of an organ of interest numbered 0..nRoi-1 in increasing copy number, so the fluence
+//   tallies can be sized by the ROI (VHDRoiTally); only built by BuildRoi() for /VHDMSDv1/tally/roiFluence
+// - without a per-voxel label array (/VHDMSDv1/det/runLookup) the label is looked up in the runs
+// - read-only after construction: shared by the scorers of every worker thread
+class VHDVoxelTable
+{
+  public:
+    VHDVoxelTable(G4int nx, G4int ny, G4int nz, G4double voxelVolume, const VHDMaterialIndices* mateIDs,
+		  const std::vector<G4Material*>& materials, const std::map<unsigned int,unsigned int>& organtag2MatIndx,
+		  const std::vector<unsigned int>& labelsOfInterest, const VHDRunLengthLabels* runs = 0);
+    ~VHDVoxelTable();
+
+    G4int GetNumberOfVoxels() const {return fNVoxels;}
+    G4double GetVoxelVolume() const {return fVoxelVolume;}
+    inline G4int GetLabel(G4int copyNo) const;
+    // organ label of voxel copyNo
+    G4double GetDensity(G4int copyNo) const {return fDensity[GetLabel(copyNo)];}
+    G4double GetMass(G4int copyNo) const {return fMass[GetLabel(copyNo)];}
+    G4int GetOrganID(G4int copyNo) const {return fOrganID[GetLabel(copyNo)];}
+    G4bool IsOfInterest(G4int copyNo) const {return fOfInterest[GetLabel(copyNo)] != 0;}
+    // voxel copyNo is in an organ of interest
+    void BuildRoi() const;
+    // number the ROI voxels (once; by the master before the workers start the run)
+    G4int GetNumberOfRoiVoxels() const {return fRoiVoxel.size();}
+    // 0 until BuildRoi()
+    G4int GetRoiIndex(G4int copyNo) const {return fRoiIndex[copyNo];}
+    // compact index of voxel copyNo in the ROI, -1 outside
+    G4int GetRoiVoxel(G4int roi) const {return fRoiVoxel[roi];}
+    // copy number of ROI voxel # roi
+    G4double ToDose(G4int copyNo, G4double edep) const {return edep/GetMass(copyNo);}
+    // absorbed dose of voxel copyNo for the energy edep deposited in it
+
+    void PrintOrganDose(const VHDVTally* edep, G4int nEvent) const;
+    // in-run dose conversion: dose and dose per event of every organ hit (energy / organ mass)
+
+  private:
+    G4int fNVoxels;
+    G4double fVoxelVolume;
+    const VHDMaterialIndices* fMateIDs;  //organ label of each voxel (owned by the detector), 0 with the runs only
+    const VHDRunLengthLabels* fRuns;
+    std::vector<G4double> fDensity;  //per organ label
+    std::vector<G4double> fMass;     //per organ label: density x voxel volume
+    std::vector<G4int> fOrganID;     //per organ label
+    std::vector<G4double> fLabelMass; //per organ label: mass of all its voxels
+    std::vector<char> fOfInterest;   //per organ label
+    mutable std::vector<G4int> fRoiIndex;  //per voxel, empty until BuildRoi()
+    mutable std::vector<G4int> fRoiVoxel;  //per ROI voxel
+};
+
+inline G4int VHDVoxelTable::GetLabel(G4int copyNo) const
+{
+  return fMateIDs ? fMateIDs->Get(copyNo) : fRuns->GetMaterialIndex(copyNo);
+}
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef VHDWorkerInitialization_h
+#define VHDWorkerInitialization_h 1
+
+#ifdef G4MULTITHREADED
+
+#include "G4UserWorkerInitialization.hh"
+#include "globals.hh"
+
+//Per-worker hooks (multi-threaded mode only)
+// - WorkerInitialize: bind the worker thread to a NUMA node (/VHDMSDv1/numa/pin) before it builds
+//   its scorers and tallies, so that its thread-local memory is first touched on that node
+class VHDWorkerInitialization : public G4UserWorkerInitialization
+{
+  public:
+    VHDWorkerInitialization();
+    virtual ~VHDWorkerInitialization();
+
+    virtual void WorkerInitialize() const;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef VHDWorkerThreadInitialization_h
+#define VHDWorkerThreadInitialization_h 1
+
+#ifdef G4MULTITHREADED
+
+#include "G4UserWorkerThreadInitialization.hh"
+#include "globals.hh"
+
+//Worker thread initialization (multi-threaded mode only)
+// - Geant4 only knows how to create a worker engine of the same type as the master engine for its own
+//   engines; a VHDPhiloxEngine on the master gets a VHDPhiloxEngine on every worker here
+class VHDWorkerThreadInitialization : public G4UserWorkerThreadInitialization
+{
+  public:
+    VHDWorkerThreadInitialization();
+    virtual ~VHDWorkerThreadInitialization();
+
+    virtual void SetupRNGEngine(const CLHEP::HepRandomEngine* aRNGEngine) const;
+};
+
+#endif
+
+#endif
@@ -25,6 +25,8 @@ macfile=$RUNdir/macro/I131_Emphysics2.mac
 isElectron=1
 isPhoton=1
 isroot=1
+ebin=1  #0: 25 energy bins (Energybin1.txt), 1: 28 energy bins (Energybin2.txt)
+nThreads=0  #number of worker threads for a multi-threaded build (0: Geant4 default)
 
 #make the appropriate directories for the simulation
 dirtag="pCellFlux"
@@ -58,7 +60,7 @@ do
 			mkdir -p $dirname
 		done
 	fi
- 	$runname $isReg $GEOdir $GEOname $SRCMPdir $SRCMPname $isSRCMPsparse $datadirname $isElectron $isPhoton $isroot $macfile > $datadirname/log.txt
+ 	$runname $isReg $GEOdir $GEOname $SRCMPdir $SRCMPname $isSRCMPsparse $datadirname $isElectron $isPhoton $isroot $ebin $macfile $nThreads > $datadirname/log.txt
 	echo "Finish VHDMSDv1 run #$n [$ORGANname]! good job bucko!"
 
 	#if [ "$n" -ne "$run2" ]
@@ -93,6 +93,15 @@ void NestedParamVHDDetectorConstruction::ConstructPhantom()
 			param);       // Parameterisation.
   
   param->SetMaterialIndices( fMateIDs );
+  param->SetRunLengthLabels( fRunLabels );
   param->SetNoVoxel( nVoxelX, nVoxelY, nVoxelZ );
-  SetMultiSensDet_NestedParam(logicVoxel);
+
+  //the scorers are attached in ConstructMultiSensDet()
+  fVoxelLogic = logicVoxel;
+}
+
+//-------------------------------------------------------------
+void NestedParamVHDDetectorConstruction::ConstructMultiSensDet()
+{
+  SetMultiSensDet_NestedParam(fVoxelLogic);
 }
@@ -45,6 +45,7 @@
 
 #include "RegularVHDDetectorConstruction.hh"
 #include "VHDPhantomParameterisationColour.hh"
+#include "VHDMaterialIndices.hh"
 
 RegularVHDDetectorConstruction::RegularVHDDetectorConstruction() : VHDDetectorConstruction()
 {
@@ -80,7 +81,8 @@ void RegularVHDDetectorConstruction::ConstructPhantom()
 
 
   //----- Set list of material indices: for each voxel it is a number that correspond to the index of its material in the vector of materials defined above
-  param->SetMaterialIndices( fMateIDs );
+  //    (always size_t here: G4PhantomParameterisation and G4RegularNavigation read this array directly, see ChooseIndexBytes)
+  param->SetMaterialIndices( fMateIDs->GetWide() );
 
   //----- Define voxel logical volume
   G4Box* voxel_solid = new G4Box( "Voxel", voxelHalfDimX, voxelHalfDimY, voxelHalfDimZ);
@@ -103,9 +105,16 @@ void RegularVHDDetectorConstruction::ConstructPhantom()
   //----- Set this physical volume as having a regular structure of type 1, so that G4RegularNavigation is used
   phantom_phys->SetRegularStructureId(1); // if not set, G4VoxelNavigation will be used instead 
 
-  SetMultiSensDet_RegParam(voxel_logic);
+  //the scorers are attached in ConstructMultiSensDet()
+  fVoxelLogic = voxel_logic;
 
 }
 
+//-------------------------------------------------------------
+void RegularVHDDetectorConstruction::ConstructMultiSensDet()
+{
+  SetMultiSensDet_RegParam(fVoxelLogic);
+}
+
 
 
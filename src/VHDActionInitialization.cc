@@ -0,0 +1,85 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+/**
+ * @file   VHDActionInitialization.cc
+ * @brief  build the user actions for the master and worker threads in multi-threaded mode
+ *
+ * @name   Geant4.10.x (G4MULTITHREADED)
+ */
+
+#ifdef G4MULTITHREADED
+
+#include "VHDActionInitialization.hh"
+#include "VHDPrimaryGeneratorAction.hh"
+#include "VHDMultiSDEventAction.hh"
+#include "VHDMultiSDRunAction.hh"
+#include "VHDMultiSDRunActionROOT.hh"
+#include "VHDMSDSteppingAction.hh"
+#include <string.h>
+
+VHDActionInitialization::VHDActionInitialization(const G4String& srcmpdirname, G4int isSparse, char dname[], G4int isroot)
+  : G4VUserActionInitialization(), fIsRoot(isroot)
+{
+  strcpy(datadir,dname);
+
+  //read the source probability map once on the master; the workers only keep a pointer to it
+  fMasterGen = new VHDPrimaryGeneratorAction(srcmpdirname,isSparse);
+}
+
+VHDActionInitialization::~VHDActionInitialization()
+{
+  delete fMasterGen;
+  G4cout << "destroying VHDActionInitialization..." << G4endl;
+}
+
+void VHDActionInitialization::BuildForMaster() const
+{
+  //only the master writes the Edep_MultiSD/pCellFlux (or RootData) output of the merged run
+  VHDMultiSDRunAction* run = 0;
+  if(fIsRoot == 1)
+	run = new VHDMultiSDRunActionROOT();
+  else
+	run = new VHDMultiSDRunAction();
+  run->SetRunInfo(const_cast<char*>(datadir));
+  SetUserAction(run);
+}
+
+void VHDActionInitialization::Build() const
+{
+  SetUserAction(new VHDPrimaryGeneratorAction(fMasterGen));
+  SetUserAction(new VHDMSDSteppingAction(const_cast<char*>(datadir)));
+  SetUserAction(new VHDMultiSDEventAction);
+
+  //the worker run action only generates the thread-local VHDMultiSDRun; its tallies are merged into the master run
+  VHDMultiSDRunAction* run = 0;
+  if(fIsRoot == 1)
+	run = new VHDMultiSDRunActionROOT();
+  else
+	run = new VHDMultiSDRunAction();
+  run->SetRunInfo(const_cast<char*>(datadir));
+  SetUserAction(run);
+}
+
+#endif
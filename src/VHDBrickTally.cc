@@ -0,0 +1,241 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+
+/**
+ * @file   VHDBrickTally.cc
+ * @brief  bricked run tally: 8x8x8 dense voxel blocks allocated on first touch
+ *
+ * @name   Geant4.9.6-p02
+ */
+
+#include "VHDBrickTally.hh"
+#include <cstring>
+#include <algorithm>
+
+VHDBrickTally::VHDBrickTally(const G4String& name, G4int nx, G4int ny, G4int nz, G4int nBins, G4bool compensated)
+  : VHDVTally(name), fNx(nx), fNy(ny), fNz(nz), fNBins(nBins > 0 ? nBins : 1), fCompensated(compensated), fNAllocated(0)
+{
+  fSize = static_cast<G4long>(fNx)*fNy*fNz*fNBins;
+  fNbx = (fNx + BrickDim - 1)/BrickDim;
+  fNby = (fNy + BrickDim - 1)/BrickDim;
+  fNbz = (fNz + BrickDim - 1)/BrickDim;
+  fBrick.assign(fNbx*fNby*fNbz,static_cast<G4double*>(0));
+}
+
+VHDBrickTally::~VHDBrickTally()
+{
+  Reset();
+}
+
+//  Zeroed sums (and compensations right after them).
+G4double* VHDBrickTally::NewBrick(G4int ib)
+{
+  G4int n = fCompensated ? 2*BrickValues() : BrickValues();
+  G4double* brick = new G4double[n];
+  std::memset(brick,0,n*sizeof(G4double));
+  fBrick[ib] = brick;
+  fNAllocated++;
+  return brick;
+}
+
+void VHDBrickTally::GetBrickOrigin(G4int ib, G4int& ix0, G4int& iy0, G4int& iz0) const
+{
+  G4int r = ib/fNbx;
+  ix0 = (ib - r*fNbx)*BrickDim;
+  iy0 = (r%fNby)*BrickDim;
+  iz0 = (r/fNby)*BrickDim;
+}
+
+void VHDBrickTally::Add(G4long copyNo, G4double val)
+{
+  if(copyNo < 0 || copyNo >= fSize)
+	G4Exception("VHDBrickTally::Add(G4long,G4double)","",FatalException,"copy number out of the tally range!");
+  G4int k;
+  G4int ib = Locate(copyNo,k);
+  G4double* brick = fBrick[ib];
+  if(!brick) brick = NewBrick(ib);
+  if(fCompensated)
+	VHDTallyReducer::Add(brick[k],brick[k + BrickValues()],val);
+  else
+	brick[k] += val;
+}
+
+G4double VHDBrickTally::Get(G4long copyNo) const
+{
+  if(copyNo < 0 || copyNo >= fSize) return 0.;
+  G4int k;
+  const G4double* brick = fBrick[Locate(copyNo,k)];
+  if(!brick) return 0.;
+  return fCompensated ? brick[k] + brick[k + BrickValues()] : brick[k];
+}
+
+//  Brick by brick from another brick tally of the same grid.
+void VHDBrickTally::Merge(const VHDVTally& other)
+{
+  if(&other == this) return;
+  const VHDBrickTally* bricks = dynamic_cast<const VHDBrickTally*>(&other);
+  if(bricks && bricks->fBrick.size() == fBrick.size() && bricks->fNBins == fNBins && bricks->fNx == fNx && bricks->fNy == fNy)
+  {
+	G4int n = BrickValues();
+	for(size_t ib = 0; ib < fBrick.size(); ib++)
+	{
+		const G4double* src = bricks->fBrick[ib];
+		if(!src) continue;
+		G4double* dst = fBrick[ib];
+		if(!dst) dst = NewBrick(ib);
+		for(G4int k = 0; k < n; k++)
+		{
+			G4double comp = bricks->fCompensated ? src[k + n] : 0.;
+			if(fCompensated){
+				VHDTallyReducer::Add(dst[k],dst[k + n],src[k]);
+				if(comp != 0.) VHDTallyReducer::Add(dst[k],dst[k + n],comp);
+			}else{
+				dst[k] += src[k] + comp;
+			}
+		}
+	}
+	return;
+  }
+  std::vector<G4long> copyNo;
+  std::vector<G4double> sum, comp;
+  other.GetEntries(copyNo,sum,comp);
+  for(size_t i = 0; i < copyNo.size(); i++)
+  {
+	Add(copyNo[i],sum[i]);
+	if(comp[i] != 0.) Add(copyNo[i],comp[i]);
+  }
+}
+
+//  Row by row (increasing copy number), skipping the bricks never hit.
+void VHDBrickTally::GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& sum, std::vector<G4double>& comp) const
+{
+  copyNo.clear();
+  sum.clear();
+  comp.clear();
+  G4int n = BrickValues();
+  for(G4int iz = 0; iz < fNz; iz++)
+  for(G4int iy = 0; iy < fNy; iy++)
+  {
+	G4int row = (iy >> 3) + (iz >> 3)*fNby;
+	G4int k0 = ((iy & 7) + (iz & 7)*BrickDim)*BrickDim;
+	for(G4int bx = 0; bx < fNbx; bx++)
+	{
+		const G4double* brick = fBrick[bx + row*fNbx];
+		if(!brick) continue;
+		G4int ixEnd = std::min((bx + 1)*(G4int)BrickDim,fNx);
+		for(G4int ix = bx*BrickDim; ix < ixEnd; ix++)
+		{
+			G4int k = (k0 + (ix & 7))*fNBins;
+			G4long c = (ix + (iy + static_cast<G4long>(iz)*fNy)*fNx)*fNBins;
+			for(G4int b = 0; b < fNBins; b++)
+			{
+				if(brick[k + b] == 0. && (!fCompensated || brick[k + b + n] == 0.)) continue;
+				copyNo.push_back(c + b);
+				sum.push_back(brick[k + b]);
+				comp.push_back(fCompensated ? brick[k + b + n] : 0.);
+			}
+		}
+	}
+  }
+}
+
+void VHDBrickTally::GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& val) const
+{
+  std::vector<G4double> comp;
+  GetEntries(copyNo,val,comp);
+  for(size_t i = 0; i < val.size(); i++) val[i] += comp[i];
+}
+
+void VHDBrickTally::SetEntries(const std::vector<G4long>& copyNo, const std::vector<G4double>& sum, const std::vector<G4double>& comp)
+{
+  Reset();
+  for(size_t i = 0; i < copyNo.size(); i++)
+  {
+	if(copyNo[i] < 0 || copyNo[i] >= fSize) continue;
+	G4int k;
+	G4int ib = Locate(copyNo[i],k);
+	G4double* brick = fBrick[ib];
+	if(!brick) brick = NewBrick(ib);
+	if(fCompensated){
+		brick[k] = sum[i];
+		brick[k + BrickValues()] = comp[i];
+	}else{
+		brick[k] = sum[i] + comp[i];
+	}
+  }
+}
+
+void VHDBrickTally::Reset()
+{
+  for(size_t ib = 0; ib < fBrick.size(); ib++)
+  {
+	delete [] fBrick[ib];
+	fBrick[ib] = 0;
+  }
+  fNAllocated = 0;
+}
+
+//  Only the bricks of the slab of iz are visited; img is zero elsewhere.
+void VHDBrickTally::FillZSlice(G4int iz, G4int nxny, G4double* img, G4int bin, G4int nBins) const
+{
+  if(nBins != fNBins || nxny != fNx*fNy || iz < 0 || iz >= fNz){
+	VHDVTally::FillZSlice(iz,nxny,img,bin,nBins);
+	return;
+  }
+  std::memset(img,0,nxny*sizeof(G4double));
+  G4int n = BrickValues();
+  G4int slab = (iz >> 3)*fNby*fNbx;
+  for(G4int ib = slab; ib < slab + fNby*fNbx; ib++)
+  {
+	const G4double* brick = fBrick[ib];
+	if(!brick) continue;
+	G4int ix0, iy0, iz0;
+	GetBrickOrigin(ib,ix0,iy0,iz0);
+	G4int ixEnd = std::min(ix0 + (G4int)BrickDim,fNx);
+	G4int iyEnd = std::min(iy0 + (G4int)BrickDim,fNy);
+	for(G4int iy = iy0; iy < iyEnd; iy++)
+		for(G4int ix = ix0; ix < ixEnd; ix++)
+		{
+			G4int k = ((ix - ix0) + ((iy - iy0) + (iz - iz0)*BrickDim)*BrickDim)*fNBins + bin;
+			img[ix + iy*fNx] = fCompensated ? brick[k] + brick[k + n] : brick[k];
+		}
+  }
+}
+
+void VHDBrickTally::Describe() const
+{
+  G4cout << "++ " << fName << ": brick tally of " << fNbx << " x " << fNby << " x " << fNbz << " bricks ("
+	 << BrickDim << "^3 voxels, " << fNBins << " bins per voxel)" << G4endl;
+}
+
+void VHDBrickTally::Report() const
+{
+  G4int nBrick = fBrick.size();
+  G4double brickMB = (fCompensated ? 2. : 1.)*BrickValues()*sizeof(G4double)/1048576.;
+  G4cout << "  " << fName << ": " << fNAllocated << " of " << nBrick << " bricks allocated";
+  if(nBrick > 0) G4cout << " (" << 100.*fNAllocated/nBrick << " %)";
+  G4cout << ", " << fNAllocated*brickMB + nBrick*sizeof(G4double*)/1048576. << " MB (dense grid: "
+	 << nBrick*brickMB << " MB)" << G4endl;
+}
@@ -0,0 +1,135 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+
+/**
+ * @file   VHDCacheTally.cc
+ * @brief  per-thread direct-mapped write-combining cache in front of a run tally
+ *
+ * @name   Geant4.9.6-p02
+ */
+
+#include "VHDCacheTally.hh"
+
+G4int VHDCacheTally::sSize = 0;
+
+VHDCacheTally::VHDCacheTally(const G4String& name, VHDVTally* data, G4bool ownsData, G4int nSlots)
+  : VHDVTally(name), fData(data), fOwnsData(ownsData), fNAdd(0), fNHit(0), fNEvict(0), fNWrite(0), fNFlush(0)
+{
+  fBits = 1;
+  while((1 << fBits) < nSlots) fBits++;
+  fKey.assign(1 << fBits,-1);
+  fVal.assign(1 << fBits,0.);
+  fUsed.reserve(1 << fBits);
+}
+
+VHDCacheTally::~VHDCacheTally()
+{
+  if(fOwnsData) delete fData;
+}
+
+//  In the order the slots were filled.
+void VHDCacheTally::Flush() const
+{
+  if(fUsed.empty()) return;
+  for(size_t i = 0; i < fUsed.size(); i++)
+  {
+	G4int slot = fUsed[i];
+	fData->Add(fKey[slot],fVal[slot]);
+	fKey[slot] = -1;
+	fVal[slot] = 0.;
+  }
+  fNWrite += fUsed.size();
+  fNFlush++;
+  fUsed.clear();
+}
+
+G4double VHDCacheTally::Get(G4long copyNo) const
+{
+  Flush();
+  return fData->Get(copyNo);
+}
+
+void VHDCacheTally::Merge(const VHDVTally& other)
+{
+  Flush();
+  const VHDCacheTally* cache = dynamic_cast<const VHDCacheTally*>(&other);
+  if(cache){
+	cache->Flush();
+	fData->Merge(*(cache->fData));
+  }else{
+	fData->Merge(other);
+  }
+}
+
+void VHDCacheTally::GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& val) const
+{
+  Flush();
+  fData->GetEntries(copyNo,val);
+}
+
+void VHDCacheTally::GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& sum, std::vector<G4double>& comp) const
+{
+  Flush();
+  fData->GetEntries(copyNo,sum,comp);
+}
+
+void VHDCacheTally::SetEntries(const std::vector<G4long>& copyNo, const std::vector<G4double>& sum, const std::vector<G4double>& comp)
+{
+  Flush();
+  fData->SetEntries(copyNo,sum,comp);
+}
+
+void VHDCacheTally::Reset()
+{
+  for(size_t i = 0; i < fUsed.size(); i++)
+  {
+	fKey[fUsed[i]] = -1;
+	fVal[fUsed[i]] = 0.;
+  }
+  fUsed.clear();
+  if(fOwnsData) fData->Reset();  //a shared tally is reset by its owner
+}
+
+void VHDCacheTally::Report() const
+{
+  Flush();
+  if(fOwnsData) fData->Report();
+}
+
+void VHDCacheTally::FirstTouch()
+{
+  if(fOwnsData) fData->FirstTouch();
+}
+
+void VHDCacheTally::Describe() const
+{
+  if(fOwnsData) fData->Describe();
+}
+
+void VHDCacheTally::FillZSlice(G4int iz, G4int nxny, G4double* img, G4int bin, G4int nBins) const
+{
+  Flush();
+  fData->FillZSlice(iz,nxny,img,bin,nBins);
+}
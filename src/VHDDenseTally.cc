@@ -0,0 +1,157 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+
+/**
+ * @file   VHDDenseTally.cc
+ * @brief  thread-private dense per-voxel tally (flat array indexed by copy number)
+ *
+ * @name   Geant4.9.6-p02
+ */
+
+#include "VHDDenseTally.hh"
+#include "VHDTallyReducer.hh"
+#include "VHDNumaUtil.hh"
+
+G4int VHDDenseTally::sMemoryLimit = 4096;
+
+VHDDenseTally::VHDDenseTally(const G4String& name, G4long nVoxels, G4bool compensated, const VHDVoxelLayout* layout)
+  : VHDVTally(name), fSize(nVoxels), fLayout(layout ? *layout : VHDVoxelLayout(nVoxels)), fSum(0), fComp(0), fCompensated(compensated)
+{
+  Allocate();
+}
+
+VHDDenseTally::~VHDDenseTally()
+{
+  Free();
+}
+
+void VHDDenseTally::Allocate()
+{
+  fSum = static_cast<G4double*>(VHDNumaUtil::Allocate(fLayout.GetStorageSize()*sizeof(G4double)));
+  if(fCompensated) fComp = static_cast<G4double*>(VHDNumaUtil::Allocate(fLayout.GetStorageSize()*sizeof(G4double)));
+}
+
+void VHDDenseTally::FirstTouch()
+{
+  size_t bytes = fLayout.GetStorageSize()*sizeof(G4double);
+  VHDNumaUtil::FirstTouch(fSum,bytes);
+  VHDNumaUtil::FirstTouch(fComp,bytes);
+  VHDNumaUtil::PrintPageNodes(fName,fSum,bytes);
+}
+
+void VHDDenseTally::Free()
+{
+  VHDNumaUtil::Free(fSum,fLayout.GetStorageSize()*sizeof(G4double));
+  if(fComp) VHDNumaUtil::Free(fComp,fLayout.GetStorageSize()*sizeof(G4double));
+  fSum = 0;
+  fComp = 0;
+}
+
+void VHDDenseTally::Add(G4long copyNo, G4double val)
+{
+  if(copyNo < 0 || copyNo >= fSize)
+	G4Exception("VHDDenseTally::Add(G4long,G4double)","",FatalException,"copy number out of the tally range!");
+  G4long k = fLayout.ToStorage(copyNo);
+  if(fComp)
+	VHDTallyReducer::Add(fSum[k],fComp[k],val);
+  else
+	fSum[k] += val;
+}
+
+void VHDDenseTally::Add(const G4THitsMap<G4double>& evtMap)
+{
+  VHDVTally::Add(evtMap);
+}
+
+G4double VHDDenseTally::Get(G4long copyNo) const
+{
+  if(copyNo < 0 || copyNo >= fSize) return 0.;
+  G4long k = fLayout.ToStorage(copyNo);
+  return fComp ? fSum[k] + fComp[k] : fSum[k];
+}
+
+void VHDDenseTally::Merge(const VHDVTally& other)
+{
+  if(&other == this) return;
+  std::vector<G4long> copyNo;
+  std::vector<G4double> sum, comp;
+  other.GetEntries(copyNo,sum,comp);
+  for(size_t i = 0; i < copyNo.size(); i++)
+  {
+	Add(copyNo[i],sum[i]);
+	if(comp[i] != 0.) Add(copyNo[i],comp[i]);
+  }
+}
+
+void VHDDenseTally::GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& val) const
+{
+  copyNo.clear();
+  val.clear();
+  for(G4long i = 0; i < fSize; i++)
+  {
+	G4long k = fLayout.ToStorage(i);
+	if(fSum[k] == 0. && (!fComp || fComp[k] == 0.)) continue;  //(a small total is all in the compensation)
+	copyNo.push_back(i);
+	val.push_back(Get(i));
+  }
+}
+
+void VHDDenseTally::GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& sum, std::vector<G4double>& comp) const
+{
+  copyNo.clear();
+  sum.clear();
+  comp.clear();
+  for(G4long i = 0; i < fSize; i++)
+  {
+	G4long k = fLayout.ToStorage(i);
+	if(fSum[k] == 0. && (!fComp || fComp[k] == 0.)) continue;
+	copyNo.push_back(i);
+	sum.push_back(fSum[k]);
+	comp.push_back(fComp ? fComp[k] : 0.);
+  }
+}
+
+void VHDDenseTally::SetEntries(const std::vector<G4long>& copyNo, const std::vector<G4double>& sum, const std::vector<G4double>& comp)
+{
+  Reset();
+  for(size_t i = 0; i < copyNo.size(); i++)
+  {
+	if(copyNo[i] < 0 || copyNo[i] >= fSize) continue;
+	G4long k = fLayout.ToStorage(copyNo[i]);
+	if(fComp){
+		fSum[k] = sum[i];
+		fComp[k] = comp[i];
+	}else{
+		fSum[k] = sum[i] + comp[i];
+	}
+  }
+}
+
+//  A fresh mapping gives back the zero pages instead of writing every voxel.
+void VHDDenseTally::Reset()
+{
+  Free();
+  Allocate();
+}
@@ -42,16 +42,28 @@
 #include "G4UnitsTable.hh"
 #include "VHDDetectorConstruction.hh"
 #include "VHDPhantomZSliceHeader.hh"
+#include "G4Version.hh"
 #include <stdlib.h>
 #include <stdio.h>
 
 //the below .hh need to be up here instead of down by the function 'SetMultiSensDet' for the destructor to work properly
 #include "G4SDManager.hh"
 #include "G4SDParticleWithEnergyFilter.hh"
-#include "VHDPSEnergyDeposit_NestedParam.hh"
-#include "VHDMSDCellFlux_NestedParam.hh"
-#include "VHDPSEnergyDeposit_RegParam.hh"
-#include "VHDMSDCellFlux_RegParam.hh"
+#include "VHDPSEnergyDeposit.hh"
+#include "VHDMSDCellFlux.hh"
+#include "VHDVoxelSD.hh"
+#include "VHDVoxelTable.hh"
+#include "VHDPhantomFile.hh"
+#include "VHDRunLengthLabels.hh"
+#include "VHDMaterialIndices.hh"
+#include "G4Timer.hh"
+#include <iterator>
+#include <algorithm>
+#include "VHDDetectorMessenger.hh"
+#ifdef G4MULTITHREADED
+#include "G4Threading.hh"
+#include <thread>
+#endif
 
 //-------------------------------------------------------------
 VHDDetectorConstruction::VHDDetectorConstruction()
@@ -60,18 +72,30 @@ VHDDetectorConstruction::VHDDetectorConstruction()
   //make sure all the pointer address is 0 or NULL
   fZSliceHeaderMerged = 0;
   fMateIDs = 0;
+  fIndexBytes = 0;
+  fReadThreads = 0;
+  fPhantomFile = 0;
+  fCompression = 0;
+  fRunLabels = 0;
+  fRunLookup = false;
   NEngbin = 0;
-  //MFDet = 0;
+  MFDet = 0;
+  fVoxelLogic = 0;
+  fVoxelTable = 0;
   
   electronflag = FALSE;
   photonflag = FALSE;
+  fScoring = "fused";
+  fMessenger = new VHDDetectorMessenger(this);
 }
 
 //-------------------------------------------------------------
 VHDDetectorConstruction::~VHDDetectorConstruction()
 {
   delete fZSliceHeaderMerged;
-  delete [] fMateIDs;
+  delete fMateIDs;
+  delete fPhantomFile;  //unmaps the array of fMateIDs
+  delete fRunLabels;
   
   //delete memory in fZSliceHeaders
   std::vector<VHDPhantomZSliceHeader*>::iterator itr1;
@@ -81,22 +105,27 @@ VHDDetectorConstruction::~VHDDetectorConstruction()
   }
   fZSliceHeaders.clear();
   
-  //delete memory in fOriginalMaterials
+  //delete memory in fMaterials (fOriginalMaterials shares them between the organ labels)
   std::vector<G4Material*>::iterator itr2;
-  for(itr2 = fOriginalMaterials.begin(); itr2 != fOriginalMaterials.end(); itr2++)
+  for(itr2 = fMaterials.begin(); itr2 != fMaterials.end(); itr2++)
   {
   	delete (*itr2);
   }
+  fMaterials.clear();
   fOriginalMaterials.clear();
   
   MaterialsOfInterest.clear();
   
   //delete all primitive scorers by calling the destructor of each primitive scorer!
-  G4int Nprim = MFDet->GetNumberOfPrimitives();
-  for(G4int n = 0; n < Nprim; n++){
-  	delete MFDet->GetPrimitive(n);
+  if(MFDet){
+	G4int Nprim = MFDet->GetNumberOfPrimitives();
+	for(G4int n = 0; n < Nprim; n++){
+		delete MFDet->GetPrimitive(n);
+	}
   }
 
+  delete fMessenger;
+  delete fVoxelTable;
   G4cout << "destroy VHDDetectorConstruction" << G4endl;
 }
 
@@ -133,15 +162,34 @@ G4VPhysicalVolume* VHDDetectorConstruction::Construct()
   // Read in all the data from voxelized data files
   ReadPhantomData();
 
+  // Build the materials of the organ labels found in the phantom
+  BuildReferencedMaterials();
+
   // Construct 
   ConstructPhantomContainer();
 
+  // Per-voxel scoring metadata (voxel volume, mass, organ of interest, organ)
+  fVoxelTable = new VHDVoxelTable(nVoxelX,nVoxelY,nVoxelZ,8.*voxelHalfDimX*voxelHalfDimY*voxelHalfDimZ,fMateIDs,
+				  fOriginalMaterials,Organtag2MatIndx,fLabelsOfInterest,fRunLabels);
+
   //this function will be defined by another derived class, NestedParamVHDDetectorConstruction or RegularVHDDetectorConsturction
   ConstructPhantom();
+
+#if G4VERSION_NUMBER < 1000
+  //Geant4 9.x does not call ConstructSDandField(), so the scorers are set up here
+  ConstructSDandField();
+#endif
   
   return world_phys;
 }
 
+//-------------------------------------------------------------
+void VHDDetectorConstruction::ConstructSDandField()
+{
+  //sensitive detectors are thread-local: in MT mode the master and every worker build their own set of scorers
+  ConstructMultiSensDet();
+}
+
 
 //-------------------------------------------------------------
 void VHDDetectorConstruction::InitialisationOfMaterials()
@@ -195,22 +243,27 @@ void VHDDetectorConstruction::InitialisationOfMaterials()
                                    symbol = "I",
                                    z = 53.0, a = 126.90447* g/mole );
   
-  //====================== define all the tissue materials needed for the digital phantoms ======================
-  G4int Nmat,organtag1,organtag2,Nelement,elindx;
-  G4double density,frac,fracsum;
-  G4Material* tempmat;
-  G4String organname,fname1,fname2;
+  G4Element* elements[] = {elH,elC,elN,elO,elNa,elMg,elP,elS,elCl,elAr,elK,elCa,elFe,elI};
+  fElements.assign(elements,elements + totNelement);
 
-  //Air and push it into fOriginalMaterials vector
+  //====================== read the composition of all the organ parts of the digital phantoms ======================
+  //the organ materials are built once the phantom is read, for the labels its voxels use (BuildReferencedMaterials)
+  G4int Nmat,organtag1,organtag2,Nelement;
+  G4double frac;
+  G4String fname1,fname2;
+
+  //Air: the world, and organ label 0
   air = new G4Material( "Air",
                         1.290*mg/cm3,
                         Nelement = 2 );
   air->AddElement(elN, 0.7);
   air->AddElement(elO, 0.3); 
   
-  fOriginalMaterials.push_back(air);
+  fMaterials.push_back(air);
   organtag1 = 0;
   Organtag2MatIndx[static_cast<unsigned int>(organtag1)] = 0;
+  fOrganCompositions.assign(1,OrganComposition());
+  fOrganCompositions[0].name = "Air";
   
   //open the file and read the element composition and density informatiion
   fname1 = dirname + "/ECompDensity.txt";
@@ -225,97 +278,97 @@ void VHDDetectorConstruction::InitialisationOfMaterials()
     G4Exception("VHDDetectorConstruction:InitialisationOfMaterials","",FatalErrorInArgument,G4String("Invalid file name: " + fname2).c_str());
   }
   
-  std::map<G4int,G4double> elspace;
   finDF1 >> Nmat;
+  fOrganCompositions.resize(Nmat + 1);
   for(unsigned int i = 1; i <= static_cast<unsigned int>(Nmat); i++ ){
+    OrganComposition comp;
     finDF1 >> organtag1;   //read ECompDensity.txt
-    fracsum = 0.0;
     for(G4int j=1; j <= totNelement;  j++){
 	finDF1 >> frac;
-	if(frac > 0.0){  //only store the element that has frac > 0.0
-	   elspace[j] = frac/100.0;  //add the element as fraction instead of percent
-	   fracsum += elspace[j];
-	}
+	if(frac > 0.0) comp.fractions[j] = frac/100.0;  //only store the element that has frac > 0.0, as fraction instead of percent
     }
-    
-    finDF1 >> density;
-    finDF2 >> organtag2 >> organname;  // read OrgantagvsName.txt
-    Nelement = elspace.size();
+    finDF1 >> comp.density;
+    comp.density *= g/cm3;
+    finDF2 >> organtag2 >> comp.name;  // read OrgantagvsName.txt
    
     if(organtag1 == organtag2){
-	tempmat = new G4Material(organname,
-				density*g/cm3,
-				Nelement);
-
-	//set element composition fraction appropriately
-	std::map<G4int,G4double>::iterator it;
-        for(it=elspace.begin(); it != elspace.end(); it++){
-		elindx = it->first;
-		frac = it->second;
-		switch(elindx){
-		   case 1:
-		      tempmat->AddElement(elH,frac);
-		      break;
-		   case 2:
-		      tempmat->AddElement(elC,frac);
-		      break;
-		   case 3:
-		      tempmat->AddElement(elN,frac);
-		      break;
-		   case 4:
-		      tempmat->AddElement(elO,frac);
-		      break;
-		   case 5:
-		      tempmat->AddElement(elNa,frac);
-		      break;
-		   case 6:
-		      tempmat->AddElement(elMg,frac);
-		      break;
-		   case 7:
-		      tempmat->AddElement(elP,frac);
-		      break;
-		   case 8:
-		      tempmat->AddElement(elS,frac);
-		      break;
-		   case 9:
-		      tempmat->AddElement(elCl,frac);
-		      break;
-		   case 10:
-		      tempmat->AddElement(elAr,frac);
-		      break;
-		   case 11:
-		      tempmat->AddElement(elK,frac);
-		      break;
-		   case 12:
-		      tempmat->AddElement(elCa,frac);
-		      break;
-		   case 13:
-		      tempmat->AddElement(elFe,frac);
-		      break;
-		   case 14:
-		      tempmat->AddElement(elI,frac);
-		   default:
-			;
-		}
-	}
         Organtag2MatIndx[static_cast<unsigned int>(organtag1)] = i;
-	fOriginalMaterials.push_back(tempmat);
+	fOrganCompositions[i] = comp;
     }
-    elspace.clear();  //clear the elspace for another tissue material
   }
   finDF1.close();
   finDF2.close();
   
   
-  //note: Organtag2MatIndx converts UFH phantom organtag to the material matrix indx stored in this class, fOriginalMaterials
-  //fOriginalMaterials store all the G4Material's defined according its corresponding elemental composition for all the definied organ parts in UFH phantoms
+  //note: Organtag2MatIndx converts UFH phantom organtag to the organ label stored in the voxels, the index in fOrganCompositions
+  //and, once the phantom is read, in fOriginalMaterials
+}
+
+//-------------------------------------------------------------
+void VHDDetectorConstruction::BuildReferencedMaterials()
+{
+  G4Timer timer;
+  timer.Start();
+  size_t nLabels = fOrganCompositions.size();
+
+  //----- Organ labels used by at least one voxel
+  std::vector<char> used(nLabels,0);
+  if( fMateIDs ){
+    G4int nVoxels = fMateIDs->GetNumberOfVoxels();
+    for( G4int i = 0; i < nVoxels; i++ ){
+      size_t label = fMateIDs->Get(i);
+      if( label < nLabels ) used[label] = 1;
+    }
+  }else{
+    for( G4int ir = 0; ir < fRunLabels->GetNumberOfRuns(); ir++ ){
+      size_t label = fRunLabels->GetRunIndex(ir);
+      if( label < nLabels ) used[label] = 1;
+    }
+  }
+
+  //----- One G4Material per distinct composition (density and element fractions) of these labels; the labels
+  //      keep their own organ tag, density and mass in the voxel table
+  typedef std::pair<G4double,std::map<G4int,G4double> > CompositionKey;
+  std::map<CompositionKey,G4Material*> built;
+  fOriginalMaterials.assign(nLabels,air);
+  G4int nUsed = used[0];
+  for( size_t i = 1; i < nLabels; i++ ){
+    if( !used[i] ) continue;
+    nUsed++;
+    const OrganComposition& comp = fOrganCompositions[i];
+    G4Material*& mat = built[CompositionKey(comp.density,comp.fractions)];
+    if( !mat ){
+      mat = new G4Material(comp.name,comp.density,comp.fractions.size());
+      std::map<G4int,G4double>::const_iterator it;
+      for( it = comp.fractions.begin(); it != comp.fractions.end(); it++ ) mat->AddElement(fElements[it->first-1],it->second);
+      fMaterials.push_back(mat);
+    }
+    fOriginalMaterials[i] = mat;
+  }
+
+  //----- Materials of interest of the legacy scorers: those of the labels of interest in the phantom
+  for( size_t i = 0; i < fLabelsOfInterest.size(); i++ ){
+    unsigned int label = fLabelsOfInterest[i];
+    if( label >= nLabels || !used[label] ) continue;
+    if( std::find(MaterialsOfInterest.begin(),MaterialsOfInterest.end(),fOriginalMaterials[label]) == MaterialsOfInterest.end() )
+      MaterialsOfInterest.push_back(fOriginalMaterials[label]);
+  }
+  timer.Stop();
+  G4cout << "materials: " << nUsed << " of " << Organtag2MatIndx.size() << " organ labels in the phantom, "
+	 << fMaterials.size() << " G4Materials built (" << Organtag2MatIndx.size() << " without the scan), "
+	 << timer.GetRealElapsed() << " s" << G4endl;
 }
 
 
 //-------------------------------------------------------------
 void VHDDetectorConstruction::ReadPhantomData()
 {
-  G4String fname1,fname2,fname3;
+  if(fPhantomFileName != ""){
+	MapPhantomFile();
+	return;
+  }
+
+  G4String fname1,fname2;
 
   fname1 = dirname + "/Data.dat";
   std::ifstream finDF(fname1);
@@ -324,68 +377,286 @@ void VHDDetectorConstruction::ReadPhantomData()
      G4Exception("VHDDetectorConstruction:ReadPhantomData()","",FatalErrorInArgument,G4String("Invalid file name: " + fname1).c_str());
   }
 
-  G4int compression;
-  finDF >> compression; // not used here
+  finDF >> fCompression; // 0: one organ tag per voxel, 1: runs of voxels (RLE)
+  if( fCompression != 0 && fCompression != 1 ){
+     G4Exception("VHDDetectorConstruction:ReadPhantomData()","",FatalErrorInArgument,G4String("Unknown compression of the slices in " + fname1).c_str());
+  }
+  if( fCompression == 1 ) fRunLabels = new VHDRunLengthLabels;
 
   finDF >> fNoFiles;
   totDensity = 0;
+  std::vector<SliceTask> tasks(fNoFiles);
   for(G4int i = 0; i < fNoFiles; i++ ){
     finDF >> fname2;
-    //--- Read one data file & collect instances of VHDPhantomZSliceHeader
-    fname3 = dirname + "/" + fname2;
-    ReadPhantomDataFile(fname3);
+    fSliceFileNames.push_back(fname2);
+    tasks[i].fname = dirname + "/" + fname2;
+  }
+  finDF.close();
+
+  //----- organ tag -> material index as a table for the slice parsers (-1: unknown tag)
+  std::map<unsigned int,unsigned int>::const_iterator it = Organtag2MatIndx.end();
+  fOrgantagTable.assign((--it)->first + 1,-1);
+  for( it = Organtag2MatIndx.begin(); it != Organtag2MatIndx.end(); it++ ) fOrgantagTable[it->first] = it->second;
+
+#ifdef G4MULTITHREADED
+  G4int nThreads = fReadThreads > 0 ? fReadThreads : std::thread::hardware_concurrency();
+  nThreads = std::max(1,std::min(nThreads,fNoFiles));
+#else
+  G4int nThreads = 1;  //sequential build: the slices are read in turn
+#endif
+  G4Timer timer;
+  timer.Start();
+
+  //----- Read the slice headers, then give every slice its first copy number
+  fZSliceHeaders.assign(fNoFiles,0);
+  ReadSlicesInParallel(nThreads,false,tasks);
+  G4int nVoxels = 0;
+  for(G4int i = 0; i < fNoFiles; i++ ){
+    tasks[i].first = nVoxels;
+    nVoxels += fZSliceHeaders[i]->GetNoVoxels();
   }
 
   //----- Merge data headers 
   MergeZSliceHeaders();
-  finDF.close();
+  CheckMaterialNames();
+
+  //----- Read the labels of the slices into their own part of the array (runs: one list per slice)
+  if( !fRunLabels ){
+    fMateIDs = new VHDMaterialIndices(nVoxels,ChooseIndexBytes());
+  }
+  ReadSlicesInParallel(nThreads,true,tasks);
+
+  //----- Expand the runs into the material index of every voxel, unless the parameterisation looks them up
+  if( fRunLabels ){
+    for(G4int i = 0; i < fNoFiles; i++ ){
+      for( size_t ir = 0; ir < tasks[i].runs.size(); ir++ ) fRunLabels->AddRun(tasks[i].runs[ir].first,tasks[i].runs[ir].second);
+    }
+    fRunLabels->Finish(fZSliceHeaderMerged->GetNoVoxelX());
+    G4cout << "RLE slices: " << fRunLabels->GetNumberOfRuns() << " runs for " << fRunLabels->GetNumberOfVoxels()
+	   << " voxels (" << fRunLabels->GetMemory()/1048576. << " MB)" << G4endl;
+    //the writers below need the array
+    G4bool expand = !(fRunLookup && SupportsRunLookup()) || fWritePhantomFileName != "" || fWriteRunLengthDir != "";
+    if( fRunLookup && !expand ){
+      G4cout << "material indices looked up in the runs (no per-voxel array)" << G4endl;
+    }else{
+      if( fRunLookup && !SupportsRunLookup() ) G4cout << "** /VHDMSDv1/det/runLookup needs the nested geometry: runs expanded" << G4endl;
+      fMateIDs = new VHDMaterialIndices(fRunLabels->GetNumberOfVoxels(),ChooseIndexBytes());
+      fRunLabels->Expand(fMateIDs,nThreads);
+    }
+  }
+  timer.Stop();
+  G4cout << "phantom slices read in " << timer.GetRealElapsed() << " s (" << fNoFiles << " files, " << nThreads << " threads)" << G4endl;
+  if( fMateIDs ){
+    G4cout << "material indices: " << fMateIDs->GetBytes() << " byte(s) per voxel for " << fOrganCompositions.size()
+	   << " organ labels (" << fMateIDs->GetMemory()/1048576. << " MB)" << G4endl;
+  }
+
+  //----- Convert to the binary phantom file / to RLE slices
+  if(fWritePhantomFileName != "")
+	VHDPhantomFile::Write(fWritePhantomFileName,*fZSliceHeaderMerged,Organtag2MatIndx,*fMateIDs);
+  if(fWriteRunLengthDir != "")
+	WriteRunLengthPhantom(fWriteRunLengthDir);
+}
+
+//-------------------------------------------------------------
+void VHDDetectorConstruction::MapPhantomFile()
+{
+  fPhantomFile = new VHDPhantomFile(fPhantomFileName);
+  //the stored indices are organ labels: the material files must be the ones it was written with
+  if( !fPhantomFile->CheckOrganTags(Organtag2MatIndx) ){
+	G4Exception("VHDDetectorConstruction::MapPhantomFile()","",FatalErrorInArgument,
+		    G4String("The organ tags of " + dirname + "/ECompDensity.txt differ from those of " + fPhantomFileName).c_str());
+  }
+  fZSliceHeaderMerged = fPhantomFile->CreateSliceHeader();
+  fNoFiles = fPhantomFile->GetNoVoxelZ();  //one z slice per .g4m file
+  fMateIDs = fPhantomFile->CreateMaterialIndices();  //the width it was written with
+  if( !fMateIDs->GetWide() && !SupportsCompactIndices() ){
+    //the regular geometry needs size_t indices: an owned copy replaces the mapped array
+    G4int nVoxels = fMateIDs->GetNumberOfVoxels();
+    VHDMaterialIndices* wide = new VHDMaterialIndices(nVoxels,sizeof(size_t));
+    for( G4int i = 0; i < nVoxels; i++ ) wide->Set(i,fMateIDs->Get(i));
+    G4cout << "** " << fMateIDs->GetBytes() << "-byte material indices of " << fPhantomFileName
+	   << " widened to size_t for the regular geometry (" << wide->GetMemory()/1048576. << " MB)" << G4endl;
+    delete fMateIDs;
+    fMateIDs = wide;
+  }
+}
+
+//-------------------------------------------------------------
+//  Width of the material indices. G4PhantomParameterisation (regular geometry) reads them from its own
+//  size_t array (GetMaterialIndex, GetMaterial(nx,ny,nz), G4RegularNavigation), so the compact widths
+//  are only for a parameterisation that reads VHDMaterialIndices (nested geometry).
+G4int VHDDetectorConstruction::ChooseIndexBytes() const
+{
+  if( SupportsCompactIndices() ) return VHDMaterialIndices::ChooseBytes(fOrganCompositions.size(),fIndexBytes);
+  if( fIndexBytes != 0 && fIndexBytes != static_cast<G4int>(sizeof(size_t)) )
+    G4cout << "** /VHDMSDv1/det/indexBytes " << fIndexBytes << " needs the nested geometry: size_t material indices used" << G4endl;
+  return sizeof(size_t);
+}
+
+//-------------------------------------------------------------
+//  Slices ithread, ithread + nThreads, ... on thread ithread (thread 0 is the caller); an error
+//  is kept in the task and reported by the caller once all the threads are done.
+void VHDDetectorConstruction::ReadSlicesInParallel(G4int nThreads, G4bool body, std::vector<SliceTask>& tasks)
+{
+#ifdef G4MULTITHREADED
+  std::vector<std::thread> pool;
+  for(G4int t = 1; t < nThreads; t++)
+	pool.push_back(std::thread(&VHDDetectorConstruction::ReadSlices,this,t,nThreads,body,&tasks));
+  ReadSlices(0,nThreads,body,&tasks);
+  for(size_t t = 0; t < pool.size(); t++) pool[t].join();
+#else
+  ReadSlices(0,1,body,&tasks);
+#endif
+
+  for(size_t i = 0; i < tasks.size(); i++){
+	if( tasks[i].error != "" )
+	  G4Exception("VHDDetectorConstruction::ReadPhantomData()","",FatalErrorInArgument,tasks[i].error.c_str());
+  }
+}
 
+//-------------------------------------------------------------
+void VHDDetectorConstruction::ReadSlices(G4int ithread, G4int nThreads, G4bool body, std::vector<SliceTask>* tasks)
+{
+  for(G4int i = ithread; i < static_cast<G4int>(tasks->size()); i += nThreads){
+	if( body )
+	  ReadSliceBody((*tasks)[i],fZSliceHeaders[i]->GetNoVoxels());
+	else
+	  ReadSliceHeader((*tasks)[i],i);
+  }
 }
 
 //-------------------------------------------------------------
-void VHDDetectorConstruction::ReadPhantomDataFile(const G4String& fname)  //the image data contains the header and the material ID (no density)
+void VHDDetectorConstruction::ReadSliceHeader(SliceTask& task, G4int islice)  //the image data contains the header and the material ID (no density)
 { 
-  std::ifstream fin(fname.c_str(), std::ios_base::in);  //ios_base::in ==> open file for reading
-  //std::ifstream fin(fname.c_str());
+  std::ifstream fin(task.fname.c_str(), std::ios_base::in);  //ios_base::in ==> open file for reading
   if( !fin.is_open() ) {
-    G4Exception("VHDDetectorConstruction:ReadPhantomDataFile(const G4String& fname)","",FatalErrorInArgument,G4String("Invalid file name: " + fname).c_str());
+    task.error = "Invalid file name: " + task.fname;
+    return;
   }
   
   //==================== Read data header ====================
-  VHDPhantomZSliceHeader* sliceHeader = new VHDPhantomZSliceHeader( fin );
-  fZSliceHeaders.push_back( sliceHeader );  //keep track of all the slice header read in from the .g4m and saved in a vector of std::vector<VHDPhantomZSliceHeader*>
-  
-  //==================== Read material indices ====================
-  G4int nVoxels = sliceHeader->GetNoVoxels();  //total number of voxels needed for this geometry
-    
-  //--- If first slice, initiliaze fMateIDs
-  if( fZSliceHeaders.size() == 1 ){
-    fMateIDs = new size_t[fNoFiles*nVoxels];  //size_t is probably the same as using unsigned int (8-bit int)
+  fZSliceHeaders[islice] = new VHDPhantomZSliceHeader( fin );  //one slot per slice, filled by one thread
+  task.body = fin.tellg();  //the labels follow
+  fin.close();
+}
+
+//-------------------------------------------------------------
+//  The labels after the header are read in one block and parsed with strtoul. Uncompressed
+//  slices: one organ tag per voxel, written to the slice's own copy numbers. RLE slices: the
+//  number of runs, then (organ tag, number of voxels) per run, kept in the task.
+void VHDDetectorConstruction::ReadSliceBody(SliceTask& task, G4int nVoxels)
+{
+  std::ifstream fin(task.fname.c_str(), std::ios_base::in);
+  if( !fin.is_open() ) {
+    task.error = "Invalid file name: " + task.fname;
+    return;
   }
+  fin.seekg(task.body);
+  std::string text((std::istreambuf_iterator<char>(fin)),std::istreambuf_iterator<char>());
+  fin.close();
 
-  //==================== read in all the materialID's from all the voxels of all the files availalbe into fMateIDs[] ====================
-  unsigned int mateID;
-  std::map<unsigned int,unsigned int>::iterator it;
-  G4int voxelCopyNo = (fZSliceHeaders.size()-1)*nVoxels; // number of voxels from previously read slices; perhaps the copy No starts at 0 since using 
-  for( G4int ii = 0; ii < nVoxels; ii++, voxelCopyNo++ ){
-    fin >> mateID;
-    //correspond mateID to the correct G4Material
-    it = Organtag2MatIndx.find(mateID);
-    fMateIDs[voxelCopyNo] = it->second;
+  const char* p = text.c_str();
+  char* end;
+  unsigned long organtag;
+  if( !fRunLabels ){
+    for( G4int ii = 0; ii < nVoxels; ii++ ){
+      organtag = strtoul(p,&end,10);
+      if( end == p ) {
+	task.error = "Fewer organ tags than voxels in " + task.fname;
+	return;
+      }
+      p = end;
+      //correspond the organ tag to the correct G4Material
+      if( organtag >= fOrgantagTable.size() || fOrgantagTable[organtag] < 0 ) {
+	task.error = "Unknown organ tag in " + task.fname;
+	return;
+      }
+      fMateIDs->Set(task.first + ii,fOrgantagTable[organtag]);
+    }
+    return;
   }
 
-  fin.close();
+  long nRuns = strtol(p,&end,10), length, total = 0;
+  p = end;
+  for( long ir = 0; ir < nRuns; ir++ ){
+    organtag = strtoul(p,&end,10);
+    p = end;
+    length = strtol(p,&end,10);
+    if( end == p ) break;
+    p = end;
+    if( organtag >= fOrgantagTable.size() || fOrgantagTable[organtag] < 0 ) {
+      task.error = "Unknown organ tag in " + task.fname;
+      return;
+    }
+    task.runs.push_back(std::make_pair(static_cast<unsigned int>(fOrgantagTable[organtag]),static_cast<G4int>(length)));
+    total += length;
+  }
+  if( total != nVoxels ) task.error = "The runs do not cover the voxels of the slice in " + task.fname;
 }
 
+//-------------------------------------------------------------
+void VHDDetectorConstruction::WriteRunLengthPhantom(const G4String& dir) const
+{
+  G4String fname = dir + "/Data.dat";
+  std::ofstream fout(fname.c_str());
+  if( !fout.is_open() ){
+    G4Exception("VHDDetectorConstruction::WriteRunLengthPhantom()","",FatalErrorInArgument,G4String("Cannot write: " + fname).c_str());
+  }
+  fout << 1 << G4endl << fNoFiles << G4endl;
+  for( size_t i = 0; i < fSliceFileNames.size(); i++ ) fout << fSliceFileNames[i] << G4endl;
+  fout.close();
+
+  //--- the slices store organ tags: invert Organtag2MatIndx (one tag per organ label)
+  std::map<size_t,unsigned int> matIndx2Organtag;
+  std::map<unsigned int,unsigned int>::const_iterator it;
+  for( it = Organtag2MatIndx.begin(); it != Organtag2MatIndx.end(); it++ ) matIndx2Organtag[it->second] = it->first;
+
+  G4long nRunsTotal = 0;
+  G4int voxelCopyNo = 0;
+  for( size_t i = 0; i < fZSliceHeaders.size(); i++ ){
+    fname = dir + "/" + fSliceFileNames[i];
+    fout.open(fname.c_str());
+    if( !fout.is_open() ){
+      G4Exception("VHDDetectorConstruction::WriteRunLengthPhantom()","",FatalErrorInArgument,G4String("Cannot write: " + fname).c_str());
+    }
+    fZSliceHeaders[i]->Write(fout);
+    G4int nVoxels = fZSliceHeaders[i]->GetNoVoxels();
+    std::vector<G4int> runStart;
+    for( G4int ii = 0; ii < nVoxels; ii++ ){
+      if( ii == 0 || fMateIDs->Get(voxelCopyNo+ii) != fMateIDs->Get(voxelCopyNo+ii-1) ) runStart.push_back(ii);
+    }
+    runStart.push_back(nVoxels);
+    fout << runStart.size()-1 << "\n";
+    for( size_t ir = 0; ir + 1 < runStart.size(); ir++ ){
+      fout << matIndx2Organtag[fMateIDs->Get(voxelCopyNo+runStart[ir])] << " " << runStart[ir+1] - runStart[ir] << "\n";
+    }
+    fout.close();
+    voxelCopyNo += nVoxels;
+    nRunsTotal += runStart.size()-1;
+  }
+  G4cout << "RLE phantom written to " << dir << ": " << fZSliceHeaders.size() << " slices, " << nRunsTotal << " runs" << G4endl;
+}
+
+//-------------------------------------------------------------
+void VHDDetectorConstruction::CheckMaterialNames() const
+{
+  //the merged header has the names of every slice (Merge checks that they are the same)
+  std::vector<G4String> known;
+  for( size_t i = 0; i < fOrganCompositions.size(); i++ ){
+    if( fOrganCompositions[i].name != "" ) known.push_back(fOrganCompositions[i].name);
+  }
+  if( !fZSliceHeaderMerged->CheckMaterialNames(known) ){
+    G4Exception("VHDDetectorConstruction::CheckMaterialNames()","",FatalErrorInArgument,
+		G4String("A material of the slices listed in " + dirname + "/Data.dat is not in OrgantagvsName.txt").c_str());
+  }
+}
 
 //-------------------------------------------------------------
 void VHDDetectorConstruction::MergeZSliceHeaders()
 {
-  //----- Images must have the same dimension ... 
-  fZSliceHeaderMerged = new VHDPhantomZSliceHeader( *fZSliceHeaders[0] );
-  for( unsigned int ii = 1; ii < fZSliceHeaders.size(); ii++ ) {
-    *fZSliceHeaderMerged += *fZSliceHeaders[ii];
-  };
+  //----- Images must have the same dimension ... (checked in one pass)
+  fZSliceHeaderMerged = VHDPhantomZSliceHeader::Merge( fZSliceHeaders );
 }
 
 //-----------------------------------------------------------------------
@@ -462,7 +733,7 @@ void VHDDetectorConstruction::DefineMaterialsOfInterest()
  	{
  		fin >> letag;
  		leindx = Organtag2MatIndx[static_cast<unsigned int>(letag)];
- 		MaterialsOfInterest.push_back(fOriginalMaterials[leindx]);
+ 		fLabelsOfInterest.push_back(leindx);  //their materials are known once the phantom is read (BuildReferencedMaterials)
  	}
  	fin.close();
  }
@@ -470,41 +741,25 @@ void VHDDetectorConstruction::DefineMaterialsOfInterest()
 
 void VHDDetectorConstruction::SetMultiSensDet_NestedParam(G4LogicalVolume* voxel_logic)
 {
+  if(fScoring == "fused"){
+	SetVoxelSD(voxel_logic,true);
+	return;
+  }
   G4SDManager* SDman = G4SDManager::GetSDMpointer();
   G4String phantomSDname = "PhantomSD";
 
-  MFDet = new G4MultiFunctionalDetector(phantomSDname);
-  SDman->AddNewDetector(MFDet);             // Register SD to SDManager.
-  voxel_logic->SetSensitiveDetector(MFDet);  // Assign SD to the logical volume.
+  G4MultiFunctionalDetector* mfd = new G4MultiFunctionalDetector(phantomSDname);
+  SDman->AddNewDetector(mfd);             // Register SD to SDManager.
+  voxel_logic->SetSensitiveDetector(mfd);  // Assign SD to the logical volume.
 
   //==========================Total energy deposit scorer=========================================
   G4String psName;
   VHDPSEnergyDeposit_NestedParam* scorer0 = new VHDPSEnergyDeposit_NestedParam(psName="totalEDep",nVoxelX,nVoxelY,nVoxelZ);
-  MFDet->RegisterPrimitive(scorer0);
+  mfd->RegisterPrimitive(scorer0);
 
   //--- Cell flux for photon or electron with energy bin
-  //=======================read the energy bin file ==============================//
-  G4double tmp;
   std::vector<G4double> engbin;
-
-  G4String fname;
-  if(ebin == 0)
-	fname = dirname + "/Energybin1.txt";   //25 energy bins; use this energy bin when using the DRFs provided by Choonsik Lee
-  else
-	fname = dirname + "/Energybin2.txt";  //28 energy bins; use this energy bin when using the DRFs from Wayson et al.'s datafile for newborn phantom
-  G4cout << "energybin fname = " << fname << G4endl;
-  std::ifstream finDF(fname);
-  if(finDF.good() != 1 )
-  {
-     G4Exception("VHDDetectorConstruction:SetMultiSensDet(G4LogicalVolume* voxel_logic)","",FatalErrorInArgument,G4String("Invalid file name: " + fname).c_str());
-  }
-  finDF >> NEngbin;
-  for(G4int i = 0; i < NEngbin; i++ ){
-    finDF >> tmp;
-    engbin.push_back(tmp);
-  }
-  finDF.close();
-  //=======================end of reading the energy bin file ==============================//
+  ReadEnergyBins(engbin);
 
 
   //==================== Construct Cell Flux scorers for a number of energy bins============//
@@ -530,52 +785,44 @@ void VHDDetectorConstruction::SetMultiSensDet_NestedParam(G4LogicalVolume* voxel
       //-----Cell Flux Scorer that store the total tracklength per volume --> per unit surface
       VHDMSDCellFlux_NestedParam* scorer = new VHDMSDCellFlux_NestedParam(psgName,nVoxelX,nVoxelY,nVoxelZ);
       scorer->SetMaterialsOfInterest(MaterialsOfInterest);  //define the material of interest
+      scorer->SetVoxelTable(fVoxelTable);  //material of interest and voxel volume by table lookup
       scorer->Weighted(FALSE);
       scorer->SetFilter(pkinEFilter);    // Assign filter
-      MFDet->RegisterPrimitive(scorer);  // Register it to MultiFunctionalDetector
+      mfd->RegisterPrimitive(scorer);  // Register it to MultiFunctionalDetector
   }
   engbin.clear();
+
+  //keep the master's detector to delete its scorers at the end; workers clean up their own SDManager
+#ifdef G4MULTITHREADED
+  if(G4Threading::IsMasterThread())	MFDet = mfd;
+#else
+  MFDet = mfd;
+#endif
   G4cout << "end of setting up the multifunctional detectors..." << G4endl;
 }
 
 void VHDDetectorConstruction::SetMultiSensDet_RegParam(G4LogicalVolume* voxel_logic)
 {
+  if(fScoring == "fused"){
+	SetVoxelSD(voxel_logic,false);
+	return;
+  }
   G4SDManager* SDman = G4SDManager::GetSDMpointer();
   G4String phantomSDname = "PhantomSD";
 
-  MFDet = new G4MultiFunctionalDetector(phantomSDname);
-  SDman->AddNewDetector(MFDet);             // Register SD to SDManager.
-  voxel_logic->SetSensitiveDetector(MFDet);  // Assign SD to the logical volume.
+  G4MultiFunctionalDetector* mfd = new G4MultiFunctionalDetector(phantomSDname);
+  SDman->AddNewDetector(mfd);             // Register SD to SDManager.
+  voxel_logic->SetSensitiveDetector(mfd);  // Assign SD to the logical volume.
 
   //==========================Total energy deposit scorer=========================================
   G4String psName;
   VHDPSEnergyDeposit_RegParam* scorer0 = new VHDPSEnergyDeposit_RegParam(psName="totalEDep",nVoxelX,nVoxelY,nVoxelZ);
-  MFDet->RegisterPrimitive(scorer0);
+  mfd->RegisterPrimitive(scorer0);
  
 
   //--- Cell flux for photon or electron with energy bin
-  //=======================read the energy bin file ==============================//
-  G4double tmp;
   std::vector<G4double> engbin;
-
-  G4String fname;
-  if(ebin == 0)
-	fname = dirname + "/Energybin1.txt";   //25 energy bins; use this energy bin when using the DRFs provided by Choonsik Lee
-  else
-	fname = dirname + "/Energybin2.txt";  //28 energy bins; use this energy bin when using the DRFs from Wayson et al.'s datafile for newborn phantom
-  G4cout << "energybin fname = " << fname << G4endl;
-  std::ifstream finDF(fname);
-  if(finDF.good() != 1 )
-  {
-     G4Exception("VHDDetectorConstruction:SetMultiSensDet(G4LogicalVolume* voxel_logic)","",FatalErrorInArgument,G4String("Invalid file name: " + fname).c_str());
-  }
-  finDF >> NEngbin;
-  for(G4int i = 0; i < NEngbin; i++ ){
-    finDF >> tmp;
-    engbin.push_back(tmp);
-  }
-  finDF.close();
-  //=======================end of reading the energy bin file ==============================//
+  ReadEnergyBins(engbin);
 
 
   //==================== Construct Cell Flux scorers for a number of energy bins============//
@@ -601,17 +848,65 @@ void VHDDetectorConstruction::SetMultiSensDet_RegParam(G4LogicalVolume* voxel_lo
       //-----Cell Flux Scorer that store the total tracklength per volume --> per unit surface
       VHDMSDCellFlux_RegParam* scorer = new VHDMSDCellFlux_RegParam(psgName,nVoxelX,nVoxelY,nVoxelZ);
       scorer->SetMaterialsOfInterest(MaterialsOfInterest);  //define the material of interest
+      scorer->SetVoxelTable(fVoxelTable);  //material of interest and voxel volume by table lookup
       scorer->Weighted(FALSE);
       scorer->SetFilter(pkinEFilter);    // Assign filter
-      MFDet->RegisterPrimitive(scorer);  // Register it to MultiFunctionalDetector
+      mfd->RegisterPrimitive(scorer);  // Register it to MultiFunctionalDetector
   }
   engbin.clear();
+
+  //keep the master's detector to delete its scorers at the end; workers clean up their own SDManager
+#ifdef G4MULTITHREADED
+  if(G4Threading::IsMasterThread())	MFDet = mfd;
+#else
+  MFDet = mfd;
+#endif
   G4cout << "end of setting up the multifunctional detectors..." << G4endl;
 }
 
+//-------------------------------------------------------------
+//  Read the upper edges [keV] of the energy bins of the cell flux (sets NEngbin)
+void VHDDetectorConstruction::ReadEnergyBins(std::vector<G4double>& engbin)
+{
+  G4double tmp;
+  engbin.clear();
 
+  G4String fname;
+  if(ebin == 0)
+	fname = dirname + "/Energybin1.txt";   //25 energy bins; use this energy bin when using the DRFs provided by Choonsik Lee
+  else
+	fname = dirname + "/Energybin2.txt";  //28 energy bins; use this energy bin when using the DRFs from Wayson et al.'s datafile for newborn phantom
+  G4cout << "energybin fname = " << fname << G4endl;
+  std::ifstream finDF(fname);
+  if(finDF.good() != 1 )
+  {
+     G4Exception("VHDDetectorConstruction:SetMultiSensDet(G4LogicalVolume* voxel_logic)","",FatalErrorInArgument,G4String("Invalid file name: " + fname).c_str());
+  }
+  finDF >> NEngbin;
+  for(G4int i = 0; i < NEngbin; i++ ){
+    finDF >> tmp;
+    engbin.push_back(tmp);
+  }
+  finDF.close();
+}
 
+//-------------------------------------------------------------
+//  Fused scoring: one VHDVoxelSD scores the energy deposit and the cell flux of every energy bin
+void VHDDetectorConstruction::SetVoxelSD(G4LogicalVolume* voxel_logic, G4bool nested)
+{
+  G4SDManager* SDman = G4SDManager::GetSDMpointer();
+  G4String phantomSDname = "PhantomSD";
 
+  std::vector<G4double> engbin;
+  ReadEnergyBins(engbin);
+  for(size_t i = 0; i < engbin.size(); i++) engbin[i] *= keV;
 
+  VHDVoxelSD* voxelSD = new VHDVoxelSD(phantomSDname,nVoxelX,nVoxelY,nVoxelZ,nested);
+  voxelSD->SetVoxelTable(fVoxelTable);
+  voxelSD->SetEnergyBins(engbin);
+  voxelSD->SetParticles(electronflag,photonflag);
+  SDman->AddNewDetector(voxelSD);             // Register SD to SDManager.
+  voxel_logic->SetSensitiveDetector(voxelSD);  // Assign SD to the logical volume.
 
-
+  G4cout << "end of setting up the fused voxel detector (" << NEngbin << " energy bins)..." << G4endl;
+}
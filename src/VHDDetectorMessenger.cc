@@ -0,0 +1,138 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+
+/**
+ * @file   VHDDetectorMessenger.cc
+ * @brief  define the messenger for the geometry and scoring options of the detector construction
+ *
+ * @name   Geant4.9.6-p02
+ */
+
+#include "VHDDetectorMessenger.hh"
+#include "VHDDetectorConstruction.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithABool.hh"
+#include "G4UIcmdWithAnInteger.hh"
+
+
+VHDDetectorMessenger::VHDDetectorMessenger(VHDDetectorConstruction* pDet)
+:pDetector(pDet)
+{
+  detDir = new G4UIdirectory("/VHDMSDv1/det/");
+  detDir->SetGuidance("detector commands");
+
+  scoringCmd = new G4UIcmdWithAString("/VHDMSDv1/det/scoring",this);
+  scoringCmd->SetGuidance("Sensitive detector of the voxels (before /run/initialize):");
+  scoringCmd->SetGuidance("  fused  : one detector scoring the energy deposit and all the cell flux energy bins per step (default)");
+  scoringCmd->SetGuidance("  legacy : multifunctional detector, one scorer and energy filter per energy bin");
+  scoringCmd->SetParameterName("scoring",false);
+  scoringCmd->SetCandidates("fused legacy");
+  scoringCmd->AvailableForStates(G4State_PreInit);
+  scoringCmd->SetToBeBroadcasted(false);
+
+  phantomFileCmd = new G4UIcmdWithAString("/VHDMSDv1/det/phantomFile",this);
+  phantomFileCmd->SetGuidance("Map the phantom from a binary phantom file instead of reading Data.dat and the .g4m slices");
+  phantomFileCmd->SetGuidance("(before /run/initialize; the material files of the geometry directory are still read).");
+  phantomFileCmd->SetParameterName("fileName",false);
+  phantomFileCmd->AvailableForStates(G4State_PreInit);
+  phantomFileCmd->SetToBeBroadcasted(false);
+
+  writePhantomFileCmd = new G4UIcmdWithAString("/VHDMSDv1/det/writePhantomFile",this);
+  writePhantomFileCmd->SetGuidance("Write the phantom read from Data.dat and the .g4m slices to a binary phantom file");
+  writePhantomFileCmd->SetGuidance("for /VHDMSDv1/det/phantomFile (before /run/initialize).");
+  writePhantomFileCmd->SetParameterName("fileName",false);
+  writePhantomFileCmd->AvailableForStates(G4State_PreInit);
+  writePhantomFileCmd->SetToBeBroadcasted(false);
+
+  writeRLEPhantomCmd = new G4UIcmdWithAString("/VHDMSDv1/det/writeRLEPhantom",this);
+  writeRLEPhantomCmd->SetGuidance("Write the phantom read to an existing directory as Data.dat (compression 1) and");
+  writeRLEPhantomCmd->SetGuidance("run-length-encoded slices of the same names (before /run/initialize).");
+  writeRLEPhantomCmd->SetParameterName("dir",false);
+  writeRLEPhantomCmd->AvailableForStates(G4State_PreInit);
+  writeRLEPhantomCmd->SetToBeBroadcasted(false);
+
+  runLookupCmd = new G4UIcmdWithABool("/VHDMSDv1/det/runLookup",this);
+  runLookupCmd->SetGuidance("Keep the runs of RLE slices and look the material of a voxel up in them instead of");
+  runLookupCmd->SetGuidance("expanding a per-voxel array (nested geometry only; before /run/initialize).");
+  runLookupCmd->SetParameterName("lookup",false);
+  runLookupCmd->AvailableForStates(G4State_PreInit);
+  runLookupCmd->SetToBeBroadcasted(false);
+
+  indexBytesCmd = new G4UIcmdWithAnInteger("/VHDMSDv1/det/indexBytes",this);
+  indexBytesCmd->SetGuidance("Bytes per voxel of the material indices: 1, 2 or 8 (size_t, the former array),");
+  indexBytesCmd->SetGuidance("0 (default) the smallest that holds the number of materials (before /run/initialize).");
+  indexBytesCmd->SetGuidance("Nested geometry only: the regular geometry always uses 8 bytes.");
+  indexBytesCmd->SetParameterName("bytes",false);
+  indexBytesCmd->SetRange("bytes==0 || bytes==1 || bytes==2 || bytes==8");
+  indexBytesCmd->AvailableForStates(G4State_PreInit);
+  indexBytesCmd->SetToBeBroadcasted(false);
+
+  readThreadsCmd = new G4UIcmdWithAnInteger("/VHDMSDv1/det/readThreads",this);
+  readThreadsCmd->SetGuidance("Threads reading the phantom slices in parallel, 0 (default): one per core (before /run/initialize; multi-threaded builds only).");
+  readThreadsCmd->SetParameterName("nThreads",false);
+  readThreadsCmd->SetRange("nThreads>=0");
+  readThreadsCmd->AvailableForStates(G4State_PreInit);
+  readThreadsCmd->SetToBeBroadcasted(false);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+VHDDetectorMessenger::~VHDDetectorMessenger()
+{
+  delete scoringCmd;
+  delete phantomFileCmd;
+  delete writePhantomFileCmd;
+  delete writeRLEPhantomCmd;
+  delete runLookupCmd;
+  delete indexBytesCmd;
+  delete readThreadsCmd;
+  delete detDir;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void VHDDetectorMessenger::SetNewValue(G4UIcommand* command, G4String newValue)
+{
+  if( command == scoringCmd )
+  {
+	G4cout << "voxel scoring: " << newValue << G4endl;
+	pDetector->SetScoring(newValue);
+  }
+  if( command == phantomFileCmd )
+	pDetector->SetPhantomFile(newValue);
+  if( command == writePhantomFileCmd )
+	pDetector->SetWritePhantomFile(newValue);
+  if( command == writeRLEPhantomCmd )
+	pDetector->SetWriteRunLengthDir(newValue);
+  if( command == runLookupCmd )
+	pDetector->SetRunLookup(runLookupCmd->GetNewBoolValue(newValue));
+  if( command == indexBytesCmd )
+	pDetector->SetIndexBytes(indexBytesCmd->GetNewIntValue(newValue));
+  if( command == readThreadsCmd )
+	pDetector->SetReadThreads(readThreadsCmd->GetNewIntValue(newValue));
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -22,39 +22,56 @@
 // * use  in  resulting  scientific  publications,  and indicate your *
 // * acceptance of all terms of the Geant4 Software license.          *
 // ********************************************************************
+
 /**
- * @file   VHDPSEnergyDeposit_NestedParam.cc
- * @brief  energy deposit scorer defition
+ * @file   VHDEventBuffer.cc
+ * @brief  reusable per-event store of a primitive scorer, reset in O(entries of the event)
  *
- * @date   7th Aug 2013
- * @author Shih-ying Huang
  * @name   Geant4.9.6-p02
  */
 
-#include "VHDPSEnergyDeposit_NestedParam.hh"
+#include "VHDEventBuffer.hh"
 
+G4bool VHDEventBuffer::sPooled = true;
 
-VHDPSEnergyDeposit_NestedParam::VHDPSEnergyDeposit_NestedParam(G4String name,G4int nx, G4int ny, G4int nz)
-  :G4PSEnergyDeposit(name),fNx(nx),fNy(ny),fNz(nz)
+VHDEventBuffer::VHDEventBuffer(G4int capacity)
+  : fBits(0), fMask(0), fNAlloc(0), fPeak(0), fDirty(0), fID(-1)
 {
-	fNxNy = fNx*fNy;
+  G4int bits = 4;
+  while((1 << bits) < capacity) bits++;
+  Allocate(bits);
 }
 
-VHDPSEnergyDeposit_NestedParam::~VHDPSEnergyDeposit_NestedParam()
+//  (Re)allocate 2^bits slots and move the entries of the current event into them, in the same order.
+void VHDEventBuffer::Allocate(G4int bits)
 {
-	if(filter){  //'filter' is a private variable that is definied in G4VPrimitiveScorer
-		delete filter;  //delete it if it's defined
-	}
-	G4cout << "destroying VHDPSEnergyDeposit..." << G4endl;
-}
+  std::vector<G4long> key;
+  std::vector<G4double> val;
+  std::vector<G4int> touched;
+  key.swap(fKey);
+  val.swap(fVal);
+  touched.swap(fTouched);
 
-G4int VHDPSEnergyDeposit_NestedParam::GetIndex(G4Step* aStep)
-{
-  const G4VTouchable* touchable = aStep->GetPreStepPoint()->GetTouchable();
-  G4int ix = touchable->GetReplicaNumber(1);
-  G4int iy = touchable->GetReplicaNumber(2);
-  G4int iz = touchable->GetReplicaNumber(0);
-  return ix + iy*fNx + iz*fNxNy;
+  fBits = bits;
+  fMask = (1 << bits) - 1;
+  fKey.assign(1 << bits,-1);
+  fVal.assign(1 << bits,0.);
+  fTouched.reserve(1 << (bits-1));
+  fNAlloc++;
 
+  std::vector<G4int>* dirty = fDirty;  //already listed in this event
+  fDirty = 0;
+  for(size_t i = 0; i < touched.size(); i++) Add(key[touched[i]],val[touched[i]]);
+  fDirty = dirty;
 }
 
+void VHDEventBuffer::Reset()
+{
+  G4int n = fTouched.size();
+  if(n > fPeak) fPeak = n;
+  for(G4int i = 0; i < n; i++){
+	fKey[fTouched[i]] = -1;
+	fVal[fTouched[i]] = 0.;
+  }
+  fTouched.clear();
+}
@@ -0,0 +1,131 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+/**
+ * @file   VHDForkRunner.cc
+ * @brief  initialize once, then fork processes running shards of the events and reduce their tallies
+ *
+ * @name   Geant4.9.6-p02
+ */
+
+#ifndef G4MULTITHREADED
+
+#include "VHDForkRunner.hh"
+#include "VHDForkRunnerMessenger.hh"
+#include "VHDMultiSDRunAction.hh"
+#include "VHDMultiSDRun.hh"
+#include "VHDMSDSteppingAction.hh"
+#include "VHDPhiloxEngine.hh"
+#include "G4RunManager.hh"
+#include <vector>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+VHDForkRunner::VHDForkRunner(VHDMultiSDRunAction* run, VHDMSDSteppingAction* step)
+  : fRunAction(run), fStepAction(step), fNProc(1)
+{
+  fMessenger = new VHDForkRunnerMessenger(this);
+}
+
+VHDForkRunner::~VHDForkRunner()
+{
+  delete fMessenger;
+  G4cout << "destroying VHDForkRunner..." << G4endl;
+}
+
+void VHDForkRunner::BeamOn(G4int nEvent)
+{
+  G4RunManager* runManager = G4RunManager::GetRunManager();
+
+  //build the physics tables in the parent, the children inherit them copy-on-write
+  runManager->BeamOn(0);
+
+  G4int nproc = (fNProc < nEvent) ? fNProc : nEvent;  //no empty shard
+  //counter-based engine: all the shards share the run seed, shard i starts at the stream of its first event
+  //otherwise: one seed per shard
+  G4long baseSeed = fRunAction->NextSeed();
+  G4bool counterBased = VHDPhiloxEngine::IsActive();
+  G4cout << "Forking " << nproc << " processes for " << nEvent << " events (base seed " << baseSeed << ")" << G4endl;
+
+  std::vector<pid_t> pids;
+  G4int firstEvent = 0;
+  for(G4int i = 0; i < nproc; i++)
+  {
+	G4int nev = nEvent/nproc + ((i < nEvent%nproc) ? 1 : 0);
+	G4cout.flush();
+	fflush(stdout);
+	pid_t pid = fork();
+	if(pid < 0)
+		G4Exception("VHDForkRunner::BeamOn(G4int)","",FatalException,"fork() failed!");
+	if(pid == 0)
+		RunShard(i,nev,firstEvent,counterBased ? baseSeed : baseSeed+i);
+	pids.push_back(pid);
+	firstEvent += nev;
+  }
+
+  G4bool allDone = true;
+  for(G4int i = 0; i < nproc; i++)
+  {
+	int status = 0;
+	waitpid(pids[i],&status,0);
+	if(!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+	{
+		G4cout << "shard " << i << " (pid " << pids[i] << ") did not complete!" << G4endl;
+		allDone = false;
+	}
+  }
+  if(!allDone)
+	G4Exception("VHDForkRunner::BeamOn(G4int)","",FatalException,"some shards of the forked run failed!");
+
+  //reduce the shards into one run and write the output with the usual EndOfRunAction
+  VHDMultiSDRun* run = (VHDMultiSDRun*)fRunAction->GenerateRun();
+  for(G4int i = 0; i < nproc; i++)
+  {
+	G4String fname = fRunAction->ShardFileName(i);
+	if(!run->ReadShard(fname,i))
+		G4Exception("VHDForkRunner::BeamOn(G4int)","",FatalException,G4String("cannot read the shard file " + fname).c_str());
+	remove(fname.c_str());
+  }
+  fRunAction->EndOfRunAction(run);
+  delete run;
+}
+
+void VHDForkRunner::RunShard(G4int id, G4int nEvent, G4int firstEvent, G4long seed)
+{
+  fRunAction->SetShard(id,seed);
+  VHDPhiloxEngine::SetEventOffset(VHDPhiloxEngine::GetEventOffset() + firstEvent);
+  if(fStepAction) fStepAction->SetShardID(id);
+
+  G4RunManager::GetRunManager()->BeamOn(nEvent);
+
+  if(fStepAction) fStepAction->WriteHistograms();
+  G4cout << "shard " << id << " done: " << nEvent << " events" << G4endl;
+  G4cout.flush();
+  fflush(stdout);
+  _exit(0);  //do not run the destructors of the parent's objects
+}
+
+#endif
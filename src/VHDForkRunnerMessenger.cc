@@ -0,0 +1,82 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+/**
+ * @file   VHDForkRunnerMessenger.cc
+ * @brief  define the messenger for the fork-after-initialization mode
+ *
+ * @name   Geant4.9.6-p02
+ */
+
+#ifndef G4MULTITHREADED
+
+#include "VHDForkRunnerMessenger.hh"
+#include "VHDForkRunner.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAnInteger.hh"
+
+
+VHDForkRunnerMessenger::VHDForkRunnerMessenger(VHDForkRunner* pFork)
+:pForkRunner(pFork)
+{
+  forkDir = new G4UIdirectory("/VHDMSDv1/fork/");
+  forkDir->SetGuidance("fork-after-initialization commands");
+
+  nProcCmd = new G4UIcmdWithAnInteger("/VHDMSDv1/fork/nProcesses",this);
+  nProcCmd->SetGuidance("Number of child processes forked by /VHDMSDv1/fork/beamOn.");
+  nProcCmd->SetParameterName("nproc",false);
+  nProcCmd->SetRange("nproc>0");
+  nProcCmd->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  beamOnCmd = new G4UIcmdWithAnInteger("/VHDMSDv1/fork/beamOn",this);
+  beamOnCmd->SetGuidance("Start a run whose events are shared among nProcesses forked processes.");
+  beamOnCmd->SetGuidance("The tallies of all processes are added into one output set.");
+  beamOnCmd->SetParameterName("nevent",false);
+  beamOnCmd->SetRange("nevent>0");
+  beamOnCmd->AvailableForStates(G4State_Idle);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+VHDForkRunnerMessenger::~VHDForkRunnerMessenger()
+{
+  delete nProcCmd;
+  delete beamOnCmd;
+  delete forkDir;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void VHDForkRunnerMessenger::SetNewValue(G4UIcommand* command, G4String newValue)
+{
+  if( command == nProcCmd )
+	pForkRunner->SetNumberOfProcesses(nProcCmd->GetNewIntValue(newValue));
+
+  if( command == beamOnCmd )
+	pForkRunner->BeamOn(beamOnCmd->GetNewIntValue(newValue));
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,230 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+
+/**
+ * @file   VHDHashTally.cc
+ * @brief  sparse run tally in a flat open-addressing hash table with 64-bit (voxel, bin) keys
+ *
+ * @name   Geant4.9.6-p02
+ */
+
+#include "VHDHashTally.hh"
+#include <algorithm>
+#include <sstream>
+
+std::vector<G4String> VHDHashTally::sQuantities;
+
+VHDHashTally::VHDHashTally(const G4String& name, G4int nBins, G4bool compensated, G4int capacity)
+  : VHDVTally(name), fNBins(nBins > 0 ? nBins : 1), fCompensated(compensated),
+    fBits(0), fMask(0), fCount(0), fNRehash(0)
+{
+  fBits0 = 4;
+  while((1L << fBits0) < capacity) fBits0++;
+  Rehash(fBits0);
+  fNRehash = 0;
+}
+
+VHDHashTally::~VHDHashTally()
+{;}
+
+//  Move the entries into 2^bits slots (the order of the entries in the table changes, not their values).
+void VHDHashTally::Rehash(G4int bits)
+{
+  std::vector<G4long> key;
+  std::vector<G4double> sum, comp;
+  key.swap(fKey);
+  sum.swap(fSum);
+  comp.swap(fComp);
+
+  fBits = bits;
+  fMask = (1L << bits) - 1;
+  fKey.assign(1L << bits,-1);
+  fSum.assign(1L << bits,0.);
+  if(fCompensated) fComp.assign(1L << bits,0.);
+  fNRehash++;
+
+  for(size_t i = 0; i < key.size(); i++)
+  {
+	if(key[i] < 0) continue;
+	G4long slot = Find(key[i]);
+	fKey[slot] = key[i];
+	fSum[slot] = sum[i];
+	if(fCompensated) fComp[slot] = comp[i];
+  }
+}
+
+void VHDHashTally::Reserve(G4long n)
+{
+  G4long need = fCount + n;
+  if(need*100 <= static_cast<G4long>(fKey.size())*MaxLoadPercent) return;
+  G4int bits = fBits;
+  while(need*100 > (1L << bits)*MaxLoadPercent) bits++;
+  Rehash(bits);
+}
+
+void VHDHashTally::Add(G4long copyNo, G4double val)
+{
+  if(copyNo < 0)
+	G4Exception("VHDHashTally::Add(G4long,G4double)","",FatalException,"negative copy number!");
+  Reserve(1);
+  AddKey(Key(copyNo),val);
+}
+
+void VHDHashTally::Add(const G4THitsMap<G4double>& evtMap)
+{
+  Reserve(evtMap.GetMap()->size());
+  std::map<G4int,G4double*>::iterator itr = evtMap.GetMap()->begin();
+  for(; itr != evtMap.GetMap()->end(); itr++) AddKey(Key(itr->first),*(itr->second));
+}
+
+void VHDHashTally::Add(const VHDEventBuffer& evtBuf)
+{
+  G4int n = evtBuf.GetNumberOfEntries();
+  Reserve(n);
+  for(G4int i = 0; i < n; i++) AddKey(Key(evtBuf.GetCopyNo(i)),evtBuf.GetValue(i));
+}
+
+G4double VHDHashTally::Get(G4long copyNo) const
+{
+  if(copyNo < 0) return 0.;
+  G4long slot = Find(Key(copyNo));
+  if(fKey[slot] < 0) return 0.;
+  return fCompensated ? fSum[slot] + fComp[slot] : fSum[slot];
+}
+
+void VHDHashTally::Merge(const VHDVTally& other)
+{
+  if(&other == this) return;
+  std::vector<G4long> copyNo;
+  std::vector<G4double> sum, comp;
+  other.GetEntries(copyNo,sum,comp);
+  //most keys of a partial are usually already here: grow entry by entry rather than for the whole partial
+  for(size_t i = 0; i < copyNo.size(); i++)
+  {
+	G4long key = Key(copyNo[i]);
+	Reserve(1);
+	AddKey(key,sum[i]);
+	if(comp[i] != 0.) AddKey(key,comp[i]);
+  }
+}
+
+namespace {
+  struct SlotLess {
+    const std::vector<G4long>* key;
+    G4bool operator()(G4long a, G4long b) const {return (*key)[a] < (*key)[b];}
+  };
+}
+
+//  The (voxel, bin) keys sort like the copy numbers.
+void VHDHashTally::GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& sum, std::vector<G4double>& comp) const
+{
+  std::vector<G4long> slots;
+  slots.reserve(fCount);
+  for(size_t i = 0; i < fKey.size(); i++)
+	if(fKey[i] >= 0) slots.push_back(i);
+  SlotLess less;
+  less.key = &fKey;
+  std::sort(slots.begin(),slots.end(),less);
+
+  copyNo.resize(slots.size());
+  sum.resize(slots.size());
+  comp.resize(slots.size());
+  for(size_t i = 0; i < slots.size(); i++)
+  {
+	copyNo[i] = CopyNo(fKey[slots[i]]);
+	sum[i] = fSum[slots[i]];
+	comp[i] = fCompensated ? fComp[slots[i]] : 0.;
+  }
+}
+
+void VHDHashTally::GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& val) const
+{
+  std::vector<G4double> comp;
+  GetEntries(copyNo,val,comp);
+  for(size_t i = 0; i < val.size(); i++) val[i] += comp[i];
+}
+
+void VHDHashTally::SetEntries(const std::vector<G4long>& copyNo, const std::vector<G4double>& sum, const std::vector<G4double>& comp)
+{
+  Reset();
+  Reserve(copyNo.size());
+  for(size_t i = 0; i < copyNo.size(); i++)
+  {
+	if(copyNo[i] < 0) continue;
+	G4long slot = Find(Key(copyNo[i]));
+	if(fKey[slot] < 0){
+		fKey[slot] = Key(copyNo[i]);
+		fCount++;
+	}
+	if(fCompensated){
+		fSum[slot] = sum[i];
+		fComp[slot] = comp[i];
+	}else{
+		fSum[slot] = sum[i] + comp[i];
+	}
+  }
+}
+
+//  Back to the initial capacity.
+void VHDHashTally::Reset()
+{
+  fCount = 0;
+  Rehash(fBits0);
+}
+
+G4double VHDHashTally::GetMemory() const
+{
+  return fKey.size()*(sizeof(G4long) + sizeof(G4double)) + fComp.size()*sizeof(G4double);
+}
+
+void VHDHashTally::Describe() const
+{
+  G4cout << "++ " << fName << ": hash tally (" << fNBins << " bins per voxel)" << G4endl;
+}
+
+void VHDHashTally::Report() const
+{
+  //G4THitsMap: one red-black tree node (48 bytes) and one heap double (a 32 byte malloc chunk) per entry
+  G4double mapBytes = fCount*80.;
+  G4cout << "  " << fName << ": hash tally of " << fCount << " entries in " << fKey.size() << " slots (load factor "
+	 << GetLoadFactor() << ", " << fNRehash << " rehashes), "
+	 << GetMemory()/1048576. << " MB (a G4THitsMap would use about " << mapBytes/1048576. << " MB)" << G4endl;
+}
+
+void VHDHashTally::SetQuantities(const G4String& names)
+{
+  sQuantities.clear();
+  std::istringstream is(names);
+  std::string name;
+  while(is >> name)
+	if(name != "none") sQuantities.push_back(name);
+}
+
+G4bool VHDHashTally::IsHashed(const G4String& colName)
+{
+  for(size_t i = 0; i < sQuantities.size(); i++)
+	if(colName.find(sQuantities[i]) != std::string::npos) return true;
+  return false;
+}
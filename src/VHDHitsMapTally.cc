@@ -0,0 +1,154 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+/**
+ * @file   VHDHitsMapTally.cc
+ * @brief  thread-private G4THitsMap tally (one replica per thread, merged at the end of the run)
+ *
+ * @name   Geant4.9.6-p02
+ */
+
+#include "VHDHitsMapTally.hh"
+#include "VHDTallyReducer.hh"
+
+VHDHitsMapTally::VHDHitsMapTally(const G4String& detName, const G4String& colName, G4bool compensated)
+  : VHDVTally(detName+"/"+colName), fCompensated(compensated)
+{
+  fMap = new G4THitsMap<G4double>(detName,colName);
+}
+
+VHDHitsMapTally::~VHDHitsMapTally()
+{
+  delete fMap;
+}
+
+void VHDHitsMapTally::Add(G4long copyNo, G4double val)
+{
+  G4int key = static_cast<G4int>(copyNo);
+  if(!fCompensated){
+	fMap->add(key,val);
+	return;
+  }
+  //a new entry starts at 0 so that its sum stays on the grid of VHDTallyReducer::Add
+  G4double* sum = (*fMap)[key];
+  if(!sum){
+	fMap->add(key,0.);
+	sum = (*fMap)[key];
+  }
+  VHDTallyReducer::Add(*sum,fComp[key],val);
+}
+
+void VHDHitsMapTally::Add(const G4THitsMap<G4double>& evtMap)
+{
+  if(fCompensated){
+	VHDVTally::Add(evtMap);
+	return;
+  }
+  *fMap += evtMap;
+}
+
+G4double VHDHitsMapTally::Get(G4long copyNo) const
+{
+  G4int key = static_cast<G4int>(copyNo);
+  G4double* val = (*fMap)[key];
+  if(!val) return 0.;
+  std::map<G4int,G4double>::const_iterator itc = fComp.find(key);
+  return (itc != fComp.end()) ? *val + itc->second : *val;
+}
+
+void VHDHitsMapTally::Merge(const VHDVTally& other)
+{
+  if(&other == this) return;
+  const VHDHitsMapTally* o = dynamic_cast<const VHDHitsMapTally*>(&other);
+  if(o && (fCompensated || o->fCompensated)){
+	std::vector<G4long> copyNo;
+	std::vector<G4double> sum, comp;
+	o->GetEntries(copyNo,sum,comp);
+	for(size_t i = 0; i < copyNo.size(); i++){
+		Add(copyNo[i],sum[i]);
+		if(comp[i] != 0.) Add(copyNo[i],comp[i]);
+	}
+	return;
+  }
+  if(o){
+	*fMap += *(o->fMap);
+	return;
+  }
+  std::vector<G4long> copyNo;
+  std::vector<G4double> val;
+  other.GetEntries(copyNo,val);
+  for(size_t i = 0; i < copyNo.size(); i++) Add(copyNo[i],val[i]);
+}
+
+void VHDHitsMapTally::GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& val) const
+{
+  copyNo.clear();
+  val.clear();
+  std::map<G4int,G4double*>::iterator itr = fMap->GetMap()->begin();
+  for(; itr != fMap->GetMap()->end(); itr++)
+  {
+	copyNo.push_back(itr->first);
+	val.push_back(*(itr->second));
+  }
+  if(fComp.empty()) return;
+  for(size_t i = 0; i < copyNo.size(); i++)
+  {
+	std::map<G4int,G4double>::const_iterator itc = fComp.find(static_cast<G4int>(copyNo[i]));
+	if(itc != fComp.end()) val[i] += itc->second;
+  }
+}
+
+void VHDHitsMapTally::GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& sum, std::vector<G4double>& comp) const
+{
+  copyNo.clear();
+  sum.clear();
+  comp.clear();
+  std::map<G4int,G4double>::const_iterator itc = fComp.begin();
+  std::map<G4int,G4double*>::iterator itr = fMap->GetMap()->begin();
+  for(; itr != fMap->GetMap()->end(); itr++)
+  {
+	copyNo.push_back(itr->first);
+	sum.push_back(*(itr->second));
+	while(itc != fComp.end() && itc->first < itr->first) itc++;
+	comp.push_back((itc != fComp.end() && itc->first == itr->first) ? itc->second : 0.);
+  }
+}
+
+void VHDHitsMapTally::SetEntries(const std::vector<G4long>& copyNo, const std::vector<G4double>& sum, const std::vector<G4double>& comp)
+{
+  Reset();
+  for(size_t i = 0; i < copyNo.size(); i++)
+  {
+	G4int key = static_cast<G4int>(copyNo[i]);
+	G4double val = sum[i];
+	fMap->add(key,val);
+	if(fCompensated && comp[i] != 0.) fComp[key] = comp[i];
+  }
+}
+
+void VHDHitsMapTally::Reset()
+{
+  fMap->clear();
+  fComp.clear();
+}
@@ -0,0 +1,245 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+
+/**
+ * @file   VHDLogTally.cc
+ * @brief  log-structured run tally: records appended per step, radix sorted and reduced per batch of events
+ *
+ * @name   Geant4.9.6-p02
+ */
+
+#include "VHDLogTally.hh"
+#include "VHDHashTally.hh"
+#include "G4Timer.hh"
+#include <cmath>
+#include <algorithm>
+
+G4bool VHDLogTally::sEnabled = false;
+G4int VHDLogTally::sBatch = 64;
+
+VHDLogTally::VHDLogTally(const G4String& name, VHDVTally* data)
+  : VHDVTally(name), fData(data), fEvent(0), fNEvent(0), fNRecord(0), fNSegment(0), fNFlush(0), fFlushTime(0.)
+{
+  fSumSq = new VHDHashTally(name+"/sumSq");
+  fRecord.reserve(1 << 16);
+}
+
+VHDLogTally::~VHDLogTally()
+{
+  delete fData;
+  delete fSumSq;
+}
+
+void VHDLogTally::Add(G4long copyNo, G4double val)
+{
+  if(copyNo < 0)
+	G4Exception("VHDLogTally::Add(G4long,G4double)","",FatalException,"negative copy number!");
+  Record r;
+  r.key = (static_cast<unsigned long long>(copyNo) << EventBits) | fEvent;
+  r.val = val;
+  fRecord.push_back(r);
+}
+
+void VHDLogTally::EndOfEvent()
+{
+  fNEvent++;
+  //a batch also ends when the log holds 4M records (64 MB)
+  if(++fEvent >= sBatch || fRecord.size() >= (1u << 22)) Flush();
+}
+
+//  LSD radix sort of the keys, RadixBits per pass; the passes over digits shared by all the keys are skipped.
+void VHDLogTally::RadixSort() const
+{
+  size_t n = fRecord.size();
+  fSorted.resize(n);
+  unsigned long long maxKey = 0;
+  for(size_t i = 0; i < n; i++) maxKey |= fRecord[i].key;
+
+  const unsigned long long mask = (1ULL << RadixBits) - 1;
+  std::vector<size_t> count(1 << RadixBits);
+  Record* src = &fRecord[0];
+  Record* dst = &fSorted[0];
+  for(G4int shift = 0; shift < 64 && (maxKey >> shift) != 0; shift += RadixBits)
+  {
+	std::fill(count.begin(),count.end(),0);
+	for(size_t i = 0; i < n; i++) count[(src[i].key >> shift) & mask]++;
+	if(count[(src[0].key >> shift) & mask] == n) continue;
+	size_t pos = 0;
+	for(size_t d = 0; d < count.size(); d++)
+	{
+		size_t c = count[d];
+		count[d] = pos;
+		pos += c;
+	}
+	for(size_t i = 0; i < n; i++) dst[count[(src[i].key >> shift) & mask]++] = src[i];
+	std::swap(src,dst);
+  }
+  if(src != &fRecord[0]) fRecord.swap(fSorted);
+}
+
+//  One segment per copy number: the sum of the segment goes into the data tally (each per-event sum if
+//  the data tally is compensated), the squares of its per-event sums into the sum of squares.
+void VHDLogTally::Flush() const
+{
+  fEvent = 0;
+  if(fRecord.empty()) return;
+  G4Timer timer;
+  timer.Start();
+  RadixSort();
+  G4bool compensated = fData->IsCompensated();
+  size_t n = fRecord.size(), i = 0;
+  while(i < n)
+  {
+	unsigned long long copyNo = fRecord[i].key >> EventBits;
+	G4double sum = 0., sumsq = 0.;
+	while(i < n && (fRecord[i].key >> EventBits) == copyNo)
+	{
+		unsigned long long key = fRecord[i].key;
+		G4double evt = 0.;
+		while(i < n && fRecord[i].key == key) evt += fRecord[i++].val;
+		//a compensated tally takes every event sum: its adds are exact, a sum over the batch is not
+		if(compensated)	fData->Add(static_cast<G4long>(copyNo),evt);
+		else		sum += evt;
+		sumsq += evt*evt;
+	}
+	if(!compensated) fData->Add(static_cast<G4long>(copyNo),sum);
+	fSumSq->Add(static_cast<G4long>(copyNo),sumsq);
+	fNSegment++;
+  }
+  fNRecord += n;
+  fNFlush++;
+  fRecord.clear();
+  timer.Stop();
+  fFlushTime += timer.GetRealElapsed();
+}
+
+G4double VHDLogTally::Get(G4long copyNo) const
+{
+  Flush();
+  return fData->Get(copyNo);
+}
+
+G4double VHDLogTally::GetSumSq(G4long copyNo) const
+{
+  Flush();
+  return fSumSq->Get(copyNo);
+}
+
+void VHDLogTally::Merge(const VHDVTally& other)
+{
+  if(&other == this) return;
+  Flush();
+  const VHDLogTally* log = dynamic_cast<const VHDLogTally*>(&other);
+  if(log){
+	log->Flush();
+	fData->Merge(*(log->fData));
+  }else{
+	fData->Merge(other);
+  }
+}
+
+void VHDLogTally::MergeStats(const VHDVTally& other)
+{
+  const VHDLogTally* log = dynamic_cast<const VHDLogTally*>(&other);
+  if(!log || log == this) return;
+  log->Flush();
+  fSumSq->Merge(*(log->fSumSq));
+  fNEvent += log->fNEvent;
+  fNRecord += log->fNRecord;
+  fNSegment += log->fNSegment;
+  fNFlush += log->fNFlush;
+  fFlushTime += log->fFlushTime;
+}
+
+void VHDLogTally::GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& val) const
+{
+  Flush();
+  fData->GetEntries(copyNo,val);
+}
+
+void VHDLogTally::GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& sum, std::vector<G4double>& comp) const
+{
+  Flush();
+  fData->GetEntries(copyNo,sum,comp);
+}
+
+void VHDLogTally::SetEntries(const std::vector<G4long>& copyNo, const std::vector<G4double>& sum, const std::vector<G4double>& comp)
+{
+  fRecord.clear();
+  fEvent = 0;
+  fData->SetEntries(copyNo,sum,comp);
+}
+
+void VHDLogTally::Reset()
+{
+  fRecord.clear();
+  fEvent = 0;
+  fData->Reset();
+  fSumSq->Reset();
+}
+
+void VHDLogTally::FillZSlice(G4int iz, G4int nxny, G4double* img, G4int bin, G4int nBins) const
+{
+  Flush();
+  fData->FillZSlice(iz,nxny,img,bin,nBins);
+}
+
+void VHDLogTally::FirstTouch()
+{
+  fData->FirstTouch();
+}
+
+//  The log in front of the data tally (its sum of squares is internal).
+void VHDLogTally::Describe() const
+{
+  fData->Describe();
+}
+
+//  Relative error of a voxel over N events: R^2 = sum(x^2)/sum(x)^2 - 1/N.
+void VHDLogTally::Report() const
+{
+  Flush();
+  fData->Report();
+  G4cout << "  " << fName << ": deposit log of " << fNRecord << " records in " << fNFlush << " batches";
+  if(fNSegment > 0) G4cout << ", " << static_cast<G4double>(fNRecord)/fNSegment << " records per tally update";
+  G4cout << ", " << fFlushTime << " s sorting and reducing" << G4endl;
+  if(fNEvent < 2) return;
+
+  std::vector<G4long> copyNo;
+  std::vector<G4double> val;
+  fData->GetEntries(copyNo,val);
+  G4long nGood = 0;
+  G4double sumR = 0.;
+  for(size_t i = 0; i < copyNo.size(); i++)
+  {
+	G4double r2 = fSumSq->Get(copyNo[i])/(val[i]*val[i]) - 1./fNEvent;
+	G4double r = r2 > 0. ? std::sqrt(r2) : 0.;
+	sumR += r;
+	if(r < 0.05) nGood++;
+  }
+  if(copyNo.empty()) return;
+  G4cout << "    relative error over " << fNEvent << " events: mean " << sumR/copyNo.size() << ", "
+	 << nGood << " of " << copyNo.size() << " entries below 5 %" << G4endl;
+}
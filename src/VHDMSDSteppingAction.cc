@@ -44,45 +44,128 @@
 #include "VHDMultiSDEventAction.hh"
 #include "G4RunManager.hh"
 #include "G4ProcessType.hh"
+#ifdef G4MULTITHREADED
+#include "G4Threading.hh"
+#include "G4AutoLock.hh"
+
+namespace {
+  G4Mutex histoMutex = G4MUTEX_INITIALIZER;
+  G4ThreadLocal VHDMSDSteppingAction* workerAction = 0;  //the stepping action of this worker thread
+}
+#endif
+
+TH1F* VHDMSDSteppingAction::fMergedElectron = 0;
+TH1F* VHDMSDSteppingAction::fMergedPhoton = 0;
 
 
 VHDMSDSteppingAction::VHDMSDSteppingAction(char dname[])
 {
    //set the data directory
    strcpy(datadir,dname);
+
+#ifdef G4MULTITHREADED
+   fThreadID = G4Threading::G4GetThreadId();
+#else
+   fThreadID = -1;
+#endif
+   fShardID = -1;
    
    //ROOT histogram
    G4cout << "In VHDMSDSteppingAction constructor... initializing root histograms!!" << G4endl;
    
-   hE_electron = new TH1F("KineticEnergy_electron","The spectrum of radionuclide decay products in electrons",1000,0.0,1.0);  //1000 bins, 1 keV per bin
-   hE_electron->GetXaxis()->SetTitle("Particle Kinetic Energy (MeV) ");
-   
-   hE_photon = new TH1F("KineticEnergy_photon","The spectrum of radionuclide decay products in photons",1000,0.0,1.0);  //1000 bins, 1 keV per bin
-   hE_photon->GetXaxis()->SetTitle("Particle Kinetic Energy (MeV) ");
+   {
+#ifdef G4MULTITHREADED
+	//ROOT registers a new histogram in the current directory: the workers must not do it concurrently
+	G4AutoLock l(&histoMutex);
+	if(fThreadID >= 0) workerAction = this;
+#endif
+	hE_electron = NewHistogram("KineticEnergy_electron","The spectrum of radionuclide decay products in electrons");
+	hE_photon = NewHistogram("KineticEnergy_photon","The spectrum of radionuclide decay products in photons");
+   }
+}
 
+TH1F* VHDMSDSteppingAction::NewHistogram(const char* name, const char* title)
+{
+   TH1F* h = new TH1F(name,title,1000,0.0,1.0);  //1000 bins, 1 keV per bin
+   h->SetDirectory(0);  //owned here, written explicitly into its file
+   h->GetXaxis()->SetTitle("Particle Kinetic Energy (MeV) ");
+   return h;
+}
+
+void VHDMSDSteppingAction::WriteHistogram(TH1F* h, const char* fname)
+{
+   TFile* outfile = TFile::Open(fname,"recreate");
+   h->Write();
+   outfile->Close();
 }
 
 VHDMSDSteppingAction::~VHDMSDSteppingAction()
 {
+#ifdef G4MULTITHREADED
+   if(fThreadID >= 0){
+	//a worker has added its histograms into the merged ones at the end of each run
+	workerAction = 0;
+	delete hE_electron;
+	delete hE_photon;
+	hE_electron = hE_photon = 0;
+   }
+#endif
+   WriteHistograms();
+   G4cout << "destroying VHDMSDSteppingAction ..." << G4endl;
+   MaterialOfInterest.clear();
+}
+
+void VHDMSDSteppingAction::WriteHistograms()
+{
+   if(!hE_electron) return;  //already written
+
    // Save and write the ROOT files of electron and photon energy histogram
+   //each forked process writes its own histograms in fork mode (add them up with hadd)
    char filename1[500];
-   sprintf(filename1,"%s/RootData/hE_electron.root",datadir);
-   TFile* outfile1 = TFile::Open(filename1,"recreate");
-   hE_electron->Write();	
+   if(fShardID >= 0)
+	sprintf(filename1,"%s/RootData/hE_electron_p%02d.root",datadir,fShardID);
+   else
+	sprintf(filename1,"%s/RootData/hE_electron.root",datadir);
+   WriteHistogram(hE_electron,filename1);
    delete hE_electron;
    hE_electron = 0;
-   outfile1->Close();
 
    char filename2[500];
-   sprintf(filename2,"%s/RootData/hE_photon.root",datadir);
-   TFile* outfile2 = TFile::Open(filename2,"recreate");
-   hE_photon->Write();	
+   if(fShardID >= 0)
+	sprintf(filename2,"%s/RootData/hE_photon_p%02d.root",datadir,fShardID);
+   else
+	sprintf(filename2,"%s/RootData/hE_photon.root",datadir);
+   WriteHistogram(hE_photon,filename2);
    delete hE_photon;
    hE_photon = 0;
-   outfile2->Close();
+}
 
-   G4cout << "destroying VHDMSDSteppingAction ..." << G4endl;
-   MaterialOfInterest.clear();
+void VHDMSDSteppingAction::MergeWorkerHistograms()
+{
+#ifdef G4MULTITHREADED
+   VHDMSDSteppingAction* step = workerAction;
+   if(!step || !step->hE_electron) return;
+   G4AutoLock l(&histoMutex);
+   //the merged histograms keep the spectra of all the runs, as the sequential ones do
+   if(!fMergedElectron){
+	fMergedElectron = NewHistogram("KineticEnergy_electron","The spectrum of radionuclide decay products in electrons");
+	fMergedPhoton = NewHistogram("KineticEnergy_photon","The spectrum of radionuclide decay products in photons");
+   }
+   fMergedElectron->Add(step->hE_electron);
+   fMergedPhoton->Add(step->hE_photon);
+   step->hE_electron->Reset();
+   step->hE_photon->Reset();
+#endif
+}
+
+void VHDMSDSteppingAction::WriteMergedHistograms(const char* dname)
+{
+   if(!fMergedElectron) return;
+   char filename[500];
+   sprintf(filename,"%s/RootData/hE_electron.root",dname);
+   WriteHistogram(fMergedElectron,filename);
+   sprintf(filename,"%s/RootData/hE_photon.root",dname);
+   WriteHistogram(fMergedPhoton,filename);
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo....
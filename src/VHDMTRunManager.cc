@@ -0,0 +1,103 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+/**
+ * @file   VHDMTRunManager.cc
+ * @brief  multi-threaded run manager with adaptive (guided) chunks of events pulled by the workers
+ *
+ * @name   Geant4.10.x (G4MULTITHREADED)
+ */
+
+#ifdef G4MULTITHREADED
+
+#include "VHDMTRunManager.hh"
+#include "VHDMTRunManagerMessenger.hh"
+#include "G4AutoLock.hh"
+#include "G4Threading.hh"
+#include <cmath>
+
+namespace { G4Mutex dispatchMutex = G4MUTEX_INITIALIZER; }
+
+VHDMTRunManager::VHDMTRunManager()
+  : G4MTRunManager(), fAdaptive(true), fChunkFactor(2.0), fMinChunk(1)
+{
+  fMessenger = new VHDMTRunManagerMessenger(this);
+}
+
+VHDMTRunManager::~VHDMTRunManager()
+{
+  delete fMessenger;
+  G4cout << "destroying VHDMTRunManager..." << G4endl;
+}
+
+void VHDMTRunManager::InitializeEventLoop(G4int n_event, const char* macroFile, G4int n_select)
+{
+  fChunksPerWorker.clear();
+  fEventsPerWorker.clear();
+  G4MTRunManager::InitializeEventLoop(n_event,macroFile,n_select);
+}
+
+//guided self-scheduling: a fraction 1/(chunkFactor*nworkers) of the events still to be dispatched
+G4int VHDMTRunManager::NextChunkSize() const
+{
+  G4int remaining = numberOfEventToBeProcessed - numberOfEventProcessed;
+  G4int nw = (nworkers > 0) ? nworkers : 1;
+  G4int nev = static_cast<G4int>(std::ceil(remaining/(fChunkFactor*nw)));
+  if(nev < fMinChunk) nev = fMinChunk;
+  return nev;
+}
+
+G4int VHDMTRunManager::SetUpNEvents(G4Event* evt, G4SeedsQueue* seedsQueue, G4bool reseedRequired)
+{
+  //hold the lock over the base call so that the chunk size and the dispatch are consistent
+  G4AutoLock l(&dispatchMutex);
+  if(fAdaptive) eventModulo = NextChunkSize();
+  G4int nev = G4MTRunManager::SetUpNEvents(evt,seedsQueue,reseedRequired);
+  if(nev > 0)
+  {
+	G4int tid = G4Threading::G4GetThreadId();
+	fChunksPerWorker[tid] += 1;
+	fEventsPerWorker[tid] += nev;
+  }
+  return nev;
+}
+
+void VHDMTRunManager::RunTermination()
+{
+  G4MTRunManager::RunTermination();  //waits for the workers and calls the master EndOfRunAction
+  PrintDispatchReport();
+}
+
+void VHDMTRunManager::PrintDispatchReport() const
+{
+  G4cout << "=== Event dispatch (" << (fAdaptive ? "adaptive chunks" : "fixed eventModulo") << ") ===" << G4endl;
+  std::map<G4int,G4int>::const_iterator itr = fChunksPerWorker.begin();
+  for(; itr != fChunksPerWorker.end(); itr++)
+  {
+	G4int nev = fEventsPerWorker.find(itr->first)->second;
+	G4cout << "  worker " << itr->first << ": " << itr->second << " chunks, " << nev << " events" << G4endl;
+  }
+}
+
+#endif
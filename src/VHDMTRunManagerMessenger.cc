@@ -0,0 +1,95 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+/**
+ * @file   VHDMTRunManagerMessenger.cc
+ * @brief  define the messenger for the event dispatch of the multi-threaded run manager
+ *
+ * @name   Geant4.10.x (G4MULTITHREADED)
+ */
+
+#ifdef G4MULTITHREADED
+
+#include "VHDMTRunManagerMessenger.hh"
+#include "VHDMTRunManager.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithABool.hh"
+#include "G4UIcmdWithADouble.hh"
+#include "G4UIcmdWithAnInteger.hh"
+
+
+VHDMTRunManagerMessenger::VHDMTRunManagerMessenger(VHDMTRunManager* pRM)
+:pRunManager(pRM)
+{
+  schedDir = new G4UIdirectory("/VHDMSDv1/sched/");
+  schedDir->SetGuidance("event dispatch commands (multi-threaded mode)");
+
+  adaptiveCmd = new G4UIcmdWithABool("/VHDMSDv1/sched/adaptive",this);
+  adaptiveCmd->SetGuidance("Dispatch the events in adaptive (guided) chunks; false uses the fixed /run/eventModulo.");
+  adaptiveCmd->SetParameterName("adaptive",false);
+  adaptiveCmd->AvailableForStates(G4State_PreInit,G4State_Idle);
+  adaptiveCmd->SetToBeBroadcasted(false);
+
+  chunkFactorCmd = new G4UIcmdWithADouble("/VHDMSDv1/sched/chunkFactor",this);
+  chunkFactorCmd->SetGuidance("Chunk size = remaining events / (chunkFactor * number of threads).");
+  chunkFactorCmd->SetParameterName("factor",false);
+  chunkFactorCmd->SetRange("factor>=1.0");
+  chunkFactorCmd->AvailableForStates(G4State_PreInit,G4State_Idle);
+  chunkFactorCmd->SetToBeBroadcasted(false);
+
+  minChunkCmd = new G4UIcmdWithAnInteger("/VHDMSDv1/sched/minChunk",this);
+  minChunkCmd->SetGuidance("Smallest number of events dispatched to a worker at once.");
+  minChunkCmd->SetParameterName("nev",false);
+  minChunkCmd->SetRange("nev>0");
+  minChunkCmd->AvailableForStates(G4State_PreInit,G4State_Idle);
+  minChunkCmd->SetToBeBroadcasted(false);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+VHDMTRunManagerMessenger::~VHDMTRunManagerMessenger()
+{
+  delete adaptiveCmd;
+  delete chunkFactorCmd;
+  delete minChunkCmd;
+  delete schedDir;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void VHDMTRunManagerMessenger::SetNewValue(G4UIcommand* command, G4String newValue)
+{
+  if( command == adaptiveCmd )
+	pRunManager->SetAdaptive(adaptiveCmd->GetNewBoolValue(newValue));
+
+  if( command == chunkFactorCmd )
+	pRunManager->SetChunkFactor(chunkFactorCmd->GetNewDoubleValue(newValue));
+
+  if( command == minChunkCmd )
+	pRunManager->SetMinChunk(minChunkCmd->GetNewIntValue(newValue));
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
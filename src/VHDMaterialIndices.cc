@@ -0,0 +1,83 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+/**
+ * @file   VHDMaterialIndices.cc
+ * @brief  material index of every voxel stored in 1, 2 or 8 bytes
+ *
+ * @name   Geant4.9.6-p02
+ */
+
+#include "VHDMaterialIndices.hh"
+#include <algorithm>
+#include <string.h>
+
+VHDMaterialIndices::VHDMaterialIndices(G4int nVoxels, G4int bytes)
+  : fNVoxels(nVoxels), fBytes(bytes), fOwned(true)
+{
+  if(!IsValidWidth(fBytes))
+	G4Exception("VHDMaterialIndices::VHDMaterialIndices()","",FatalErrorInArgument,"Material indices of 1, 2 or 8 bytes only!");
+  size_t size = static_cast<size_t>(fNVoxels)*fBytes;
+  fData = new char[size];
+  memset(fData,0,size);
+}
+
+VHDMaterialIndices::VHDMaterialIndices(void* data, G4int nVoxels, G4int bytes)
+  : fNVoxels(nVoxels), fBytes(bytes), fData(data), fOwned(false)
+{
+  if(!IsValidWidth(fBytes))
+	G4Exception("VHDMaterialIndices::VHDMaterialIndices()","",FatalErrorInArgument,"Material indices of 1, 2 or 8 bytes only!");
+}
+
+VHDMaterialIndices::~VHDMaterialIndices()
+{
+  if(fOwned) delete [] static_cast<char*>(fData);
+}
+
+void VHDMaterialIndices::Fill(G4int first, G4int last, size_t index)
+{
+  switch(fBytes){
+  case 1:
+	std::fill(static_cast<unsigned char*>(fData) + first,static_cast<unsigned char*>(fData) + last,static_cast<unsigned char>(index));
+	break;
+  case 2:
+	std::fill(static_cast<unsigned short*>(fData) + first,static_cast<unsigned short*>(fData) + last,static_cast<unsigned short>(index));
+	break;
+  default:
+	std::fill(static_cast<size_t*>(fData) + first,static_cast<size_t*>(fData) + last,index);
+  }
+}
+
+G4int VHDMaterialIndices::ChooseBytes(size_t nMaterials, G4int requested)
+{
+  G4int bytes = sizeof(size_t);
+  if(nMaterials <= 256)
+	bytes = 1;
+  else if(nMaterials <= 65536)
+	bytes = 2;
+  if(IsValidWidth(requested) && requested >= bytes) return requested;
+  if(requested != 0)
+	G4cout << "** " << requested << "-byte material indices cannot hold " << nMaterials << " materials: " << bytes << " bytes used" << G4endl;
+  return bytes;
+}
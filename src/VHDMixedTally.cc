@@ -0,0 +1,243 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+
+/**
+ * @file   VHDMixedTally.cc
+ * @brief  mixed-precision dense per-voxel tally (float sum and float compensation) with an optional double check
+ *
+ * @name   Geant4.9.6-p02
+ */
+
+#include "VHDMixedTally.hh"
+#include "VHDTallyReducer.hh"
+#include "VHDNumaUtil.hh"
+#include <cmath>
+#include <algorithm>
+
+G4bool VHDMixedTally::sMixed = false;
+G4bool VHDMixedTally::sCheck = false;
+
+VHDMixedTally::VHDMixedTally(const G4String& name, G4long nVoxels, G4bool ordered, G4bool check,
+			     const VHDVoxelLayout* layout)
+  : VHDVTally(name), fSize(nVoxels), fLayout(layout ? *layout : VHDVoxelLayout(nVoxels)), fSum(0), fComp(0), fShadow(0), fShadowComp(0), fNShadowAdd(0),
+    fOrdered(ordered), fCheck(check)
+{
+  Allocate();
+}
+
+VHDMixedTally::~VHDMixedTally()
+{
+  Free();
+}
+
+void VHDMixedTally::Allocate()
+{
+  fSum = static_cast<G4float*>(VHDNumaUtil::Allocate(fLayout.GetStorageSize()*sizeof(G4float)));
+  fComp = static_cast<G4float*>(VHDNumaUtil::Allocate(fLayout.GetStorageSize()*sizeof(G4float)));
+  if(fCheck){
+	fShadow = static_cast<G4double*>(VHDNumaUtil::Allocate(fLayout.GetStorageSize()*sizeof(G4double)));
+	fShadowComp = static_cast<G4double*>(VHDNumaUtil::Allocate(fLayout.GetStorageSize()*sizeof(G4double)));
+  }
+  fNShadowAdd = 0;
+}
+
+void VHDMixedTally::FirstTouch()
+{
+  size_t bytes = fLayout.GetStorageSize()*sizeof(G4float);
+  VHDNumaUtil::FirstTouch(fSum,bytes);
+  VHDNumaUtil::FirstTouch(fComp,bytes);
+  VHDNumaUtil::FirstTouch(fShadow,2*bytes);
+  VHDNumaUtil::FirstTouch(fShadowComp,2*bytes);
+  VHDNumaUtil::PrintPageNodes(fName,fSum,bytes);
+}
+
+void VHDMixedTally::Free()
+{
+  VHDNumaUtil::Free(fSum,fLayout.GetStorageSize()*sizeof(G4float));
+  VHDNumaUtil::Free(fComp,fLayout.GetStorageSize()*sizeof(G4float));
+  if(fShadow){
+	VHDNumaUtil::Free(fShadow,fLayout.GetStorageSize()*sizeof(G4double));
+	VHDNumaUtil::Free(fShadowComp,fLayout.GetStorageSize()*sizeof(G4double));
+  }
+  fSum = fComp = 0;
+  fShadow = fShadowComp = 0;
+}
+
+//  Neumaier step in float on the float part of val (the float remainder joins the error term), then the
+//  compensation is folded back into the sum so that it stays below one ulp of the sum: a float compensation
+//  left to grow would itself lose the deposits smaller than its own ulp.
+void VHDMixedTally::AddPair(G4long k, G4double val)
+{
+  G4float hi = static_cast<G4float>(val);
+  G4float lo = static_cast<G4float>(val - hi);
+  G4float s = fSum[k];
+  G4float t = s + hi;
+  G4float e;
+  if( std::fabs(s) >= std::fabs(hi) )
+	e = (s - t) + hi;
+  else
+	e = (hi - t) + s;
+  e += fComp[k] + lo;
+  s = t + e;
+  fComp[k] = e - (s - t);
+  fSum[k] = s;
+}
+
+void VHDMixedTally::Add(G4long copyNo, G4double val)
+{
+  if(copyNo < 0 || copyNo >= fSize)
+	G4Exception("VHDMixedTally::Add(G4long,G4double)","",FatalException,"copy number out of the tally range!");
+  G4long k = fLayout.ToStorage(copyNo);
+  AddPair(k,val);
+  if(fShadow){
+	VHDTallyReducer::Add(fShadow[k],fShadowComp[k],val);
+	fNShadowAdd++;
+  }
+}
+
+G4double VHDMixedTally::Get(G4long copyNo) const
+{
+  if(copyNo < 0 || copyNo >= fSize) return 0.;
+  G4long k = fLayout.ToStorage(copyNo);
+  return static_cast<G4double>(fSum[k]) + static_cast<G4double>(fComp[k]);
+}
+
+//  Arrival-order merge of a worker tally; the shadow is left alone (the workers are checked by MergeCheck).
+void VHDMixedTally::Merge(const VHDVTally& other)
+{
+  if(&other == this) return;
+  std::vector<G4long> copyNo;
+  std::vector<G4double> sum, comp;
+  other.GetEntries(copyNo,sum,comp);
+  for(size_t i = 0; i < copyNo.size(); i++)
+  {
+	if(copyNo[i] < 0 || copyNo[i] >= fSize) continue;
+	G4long k = fLayout.ToStorage(copyNo[i]);
+	AddPair(k,sum[i]);
+	if(comp[i] != 0.) AddPair(k,comp[i]);
+  }
+}
+
+void VHDMixedTally::GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& val) const
+{
+  copyNo.clear();
+  val.clear();
+  for(G4long i = 0; i < fSize; i++)
+  {
+	G4long k = fLayout.ToStorage(i);
+	if(fSum[k] == 0.f && fComp[k] == 0.f) continue;
+	copyNo.push_back(i);
+	val.push_back(Get(i));
+  }
+}
+
+void VHDMixedTally::GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& sum, std::vector<G4double>& comp) const
+{
+  copyNo.clear();
+  sum.clear();
+  comp.clear();
+  for(G4long i = 0; i < fSize; i++)
+  {
+	G4long k = fLayout.ToStorage(i);
+	if(fSum[k] == 0.f && fComp[k] == 0.f) continue;
+	copyNo.push_back(i);
+	sum.push_back(fSum[k]);
+	comp.push_back(fComp[k]);
+  }
+}
+
+//  The double result of the reduction is stored as the nearest float and the float remainder.
+void VHDMixedTally::SetEntries(const std::vector<G4long>& copyNo, const std::vector<G4double>& sum, const std::vector<G4double>& comp)
+{
+  Reset();
+  for(size_t i = 0; i < copyNo.size(); i++)
+  {
+	if(copyNo[i] < 0 || copyNo[i] >= fSize) continue;
+	G4long k = fLayout.ToStorage(copyNo[i]);
+	G4double val = sum[i] + comp[i];
+	fSum[k] = static_cast<G4float>(val);
+	fComp[k] = static_cast<G4float>(val - fSum[k]);
+  }
+}
+
+void VHDMixedTally::Reset()
+{
+  Free();
+  Allocate();
+}
+
+void VHDMixedTally::Check(CheckStats& st) const
+{
+  if(!fShadow || fNShadowAdd == 0) return;
+  G4long n = fLayout.GetStorageSize();  //the padding of a Morton layout is zero in both
+  G4double dmax = 0.;
+  for(G4long i = 0; i < n; i++)
+	dmax = std::max(dmax,std::fabs(fShadow[i] + fShadowComp[i]));
+  for(G4long i = 0; i < n; i++)
+  {
+	G4double d = fShadow[i] + fShadowComp[i];
+	G4double f = static_cast<G4double>(fSum[i]) + static_cast<G4double>(fComp[i]);
+	if(d == 0. && f == 0.) continue;
+	G4double rel = (d != 0.) ? std::fabs(f - d)/std::fabs(d) : 1.;
+	st.nVoxel++;
+	st.sumRel += rel;
+	st.maxRel = std::max(st.maxRel,rel);
+	st.totMixed += f;
+	st.totDouble += d;
+	if(std::fabs(d) < 1.e-3*dmax){
+		st.nLow++;
+		st.lowMaxRel = std::max(st.lowMaxRel,rel);
+	}
+  }
+}
+
+void VHDMixedTally::MergeCheck(const VHDVTally& worker)
+{
+  const VHDMixedTally* w = dynamic_cast<const VHDMixedTally*>(&worker);
+  if(!w || w == this) return;
+  CheckStats st;
+  w->Check(st);
+  fMerged.nVoxel += st.nVoxel;
+  fMerged.nLow += st.nLow;
+  fMerged.sumRel += st.sumRel;
+  fMerged.maxRel = std::max(fMerged.maxRel,st.maxRel);
+  fMerged.lowMaxRel = std::max(fMerged.lowMaxRel,st.lowMaxRel);
+  fMerged.totMixed += st.totMixed;
+  fMerged.totDouble += st.totDouble;
+}
+
+void VHDMixedTally::Report() const
+{
+  G4cout << "  " << fName << ": mixed precision (float sum + float compensation), "
+	 << 2.*fLayout.GetStorageSize()*sizeof(G4float)/1048576. << " MB" << G4endl;
+  if(!fCheck) return;
+  CheckStats st = fMerged;
+  Check(st);
+  if(st.nVoxel == 0) return;
+  G4cout << "    accuracy vs double: " << st.nVoxel << " voxels, max rel. deviation " << st.maxRel
+	 << ", mean " << st.sumRel/st.nVoxel << ", total "
+	 << ((st.totDouble != 0.) ? std::fabs(st.totMixed - st.totDouble)/std::fabs(st.totDouble) : 0.)
+	 << "; low-dose voxels (< 1e-3 of the max): " << st.nLow << ", max rel. deviation " << st.lowMaxRel << G4endl;
+}
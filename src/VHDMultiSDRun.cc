@@ -51,10 +51,56 @@
 //  data members.
 //  std::vector<G4String> theCollName;            // Collection Name,
 //  std::vector<G4int> theCollID;                 // Collection ID,
-//  std::vector<G4THitsMap<G4double>*> theRunMap; // HitsMap for RUN.
+//  std::vector<VHDVTally*> theRunTally;          // tally for RUN.
 //
-//  The resualtant HitsMap objects are obtain using access method,
-//  GetHitsMap(..).
+//  The resualtant tallies are obtain using access method, GetTally(..).
+//  The run tally of each collection is created by CreateTally(..) for
+//  the backend chosen by /VHDMSDv1/tally/backend:
+//   "replica"     : a G4THitsMap per thread (VHDHitsMapTally), merged at
+//                   the end of the run; GetHitsMap(..) gives access to it
+//   "atomic"      : (MT) one dense double grid shared by all the threads
+//   "atomicFloat" : (MT) one dense float grid shared by all the threads
+//                   (VHDSharedAtomicTally); the worker runs add directly
+//                   into the tallies of the master run.
+//   "brick"       : a grid of 8x8x8 voxel bricks per thread, allocated
+//                   on first touch (VHDBrickTally)
+//  The fused detector (VHDVoxelSD) has no collections: it gets a dense
+//  tally for the energy deposit and one for the [voxel][bin] cell flux,
+//  the bins of which are looked up as <SD name>/PhotonCellFlux%02d
+//  (VHDTallySlice) like the legacy scorers.
+//  The collections listed by /VHDMSDv1/tally/hashQuantities are kept in
+//  a flat open-addressing hash table per thread instead (VHDHashTally),
+//  for grids too large for a dense array; so is a dense collection whose
+//  arrays over all the threads exceed /VHDMSDv1/tally/denseLimit.
+//  The collections of a VHDDirectScorer (energy deposit) get a dense
+//  flat array per thread instead of the G4THitsMap (VHDDenseTally): the
+//  run binds it to the scorer, which adds each hit straight into it, and
+//  RecordEvent(..) has nothing to merge for them.
+//  The other collections of a VHDPooledScorer (legacy cell flux) fill a
+//  VHDEventBuffer of the run instead of a new G4THitsMap per event; a
+//  buffer hit in the event lists itself in theDirty, so RecordEvent(..)
+//  only visits the buffers hit, each over its touched entries only.
+//  The dense tallies are stored in the order of /VHDMSDv1/tally/layout
+//  (linear or Morton, see VHDVoxelLayout); they are read back by copy
+//  number, so the output is always in linear order.
+//  With /VHDMSDv1/tally/writeCache N the run tallies of a run that
+//  processes events get a direct-mapped cache of N entries in front
+//  (VHDCacheTally), flushed at the end of every event; a worker run
+//  puts its own cache in front of a shared tally of the master run.
+//  With the "ordered" reduction (/VHDMSDv1/tally/reduction ordered)
+//  the replica tallies are exact two-bin sums and Merge(..) / ReadShard(..)
+//  only stage them by thread / shard ID; ReduceTallies() adds them up
+//  in a fixed pairwise tree (VHDTallyReducer). All the additions are
+//  exact, so the output depends neither on the order in which the
+//  workers or shards complete nor on their number.
+//
+//    In multi-threaded mode every worker thread owns its own VHDMultiSDRun
+//  and the master run collects them in Merge(..) at the end of the run.
+//  The worker and master runs are built from the same detector, so the
+//  collections are in the same order in both. Merge(..) is executed by
+//  the worker thread as soon as its event loop is over, so the time elapsed
+//  since the worker run was generated is the busy time of that worker;
+//  PrintWorkerUtilisation() compares it with the wall time of the master run.
 //
 //=====================================================================
 
@@ -62,13 +108,64 @@
 #include "G4SDManager.hh"
 
 #include "G4MultiFunctionalDetector.hh"
+#include <cstdio>
 #include "G4VPrimitiveScorer.hh"
+#include "G4Timer.hh"
+#include "G4RunManager.hh"
+#include "VHDDetectorConstruction.hh"
+#include "VHDHitsMapTally.hh"
+#include "VHDDenseTally.hh"
+#include "VHDMixedTally.hh"
+#include "VHDHashTally.hh"
+#include "VHDBrickTally.hh"
+#include "VHDRoiTally.hh"
+#include "VHDLogTally.hh"
+#include "VHDCacheTally.hh"
+#include "VHDVoxelTable.hh"
+#include "VHDDirectScorer.hh"
+#include "VHDEventBuffer.hh"
+#include "VHDVoxelSD.hh"
+#include "VHDTallySlice.hh"
+#include "VHDTallyReducer.hh"
+#include "VHDVoxelLayout.hh"
+#include "VHDPerfCounter.hh"
+#include "VHDNumaUtil.hh"
+#include <fstream>
+#ifdef G4MULTITHREADED
+#include "G4Threading.hh"
+#include "G4MTRunManager.hh"
+#include "VHDSharedAtomicTally.hh"
+#endif
 
 //  Constructor. 
 //   (The vector of MultiFunctionalDetector name has to given.)
-VHDMultiSDRun::VHDMultiSDRun(const std::vector<G4String> mfdName): G4Run()
+VHDMultiSDRun::VHDMultiSDRun(const std::vector<G4String> mfdName, const G4String& backend): G4Run()
 {
+  fTimer = new G4Timer;
+  fTimer->Start();
+  fNHitsMapAlloc = 0;
+  fNMerge = 0;
+  fNBuffer = fNBufferAlloc = 0;
+  fBufferPeak = 0;
+  fCacheMiss = fCacheRef = 0;
+  fPerf = 0;
+  fWCAdd = fWCHit = fWCEvict = fWCWrite = fWCFlush = 0;
+
   G4SDManager* SDman = G4SDManager::GetSDMpointer();
+
+  //--- a worker run uses the shared tallies of the master run, if any
+  const VHDMultiSDRun* masterRun = 0;
+#ifdef G4MULTITHREADED
+  if( !G4Threading::IsMasterThread() )
+    masterRun = static_cast<const VHDMultiSDRun*>(G4MTRunManager::GetMasterRunManager()->GetCurrentRun());
+  fEventLoop = masterRun != 0;  //the master run of the MT build only merges the workers
+#else
+  fEventLoop = true;
+#endif
+  //--- the backend is set on the master run action only (/VHDMSDv1/tally/backend is not broadcast):
+  //    a worker run takes the one of the master run
+  fBackend = masterRun ? masterRun->fBackend : backend;
+  if( fEventLoop && VHDPerfCounter::IsEnabled() ) fPerf = new VHDPerfCounter;
   
   //=================================================
   //  Initalize RunMaps for accumulation.
@@ -80,7 +177,22 @@ VHDMultiSDRun::VHDMultiSDRun(const std::vector<G4String> mfdName): G4Run()
     G4String detName = mfdName[idet];
     //--- Seek and Obtain MFD objects from SDmanager.
 
-    G4MultiFunctionalDetector* mfd = (G4MultiFunctionalDetector*)(SDman->FindSensitiveDetector(detName));
+    G4VSensitiveDetector* sd = SDman->FindSensitiveDetector(detName);
+    VHDVoxelSD* voxelSD = dynamic_cast<VHDVoxelSD*>(sd);
+    if ( voxelSD ){
+	//--- fused detector: no hits collection, the detector adds into the run tallies
+	G4int nBins = voxelSD->GetNumberOfBins();
+	VHDVTally* edep = CreateFusedTally(detName,"totalEDep",1,fBackend,masterRun);
+	VHDVTally* flux = CreateFusedTally(detName,"CellFlux",nBins,fBackend,masterRun);
+	voxelSD->SetRunTallies(edep,flux);
+	for (G4int ib = 0; ib < nBins; ib++){
+	    char name[50];
+	    std::sprintf(name,"%s/PhotonCellFlux%02d",detName.c_str(),ib);
+	    theSlice.push_back(new VHDTallySlice(name,flux,ib,nBins));
+	}
+	continue;
+    }
+    G4MultiFunctionalDetector* mfd = dynamic_cast<G4MultiFunctionalDetector*>(sd);
     if ( mfd ){
 	//--- Loop over the registered primitive scorers
 	for (G4int icol = 0; icol < mfd->GetNumberOfPrimitives(); icol++){
@@ -96,10 +208,24 @@ VHDMultiSDRun::VHDMultiSDRun(const std::vector<G4String> mfdName): G4Run()
 	    if ( collectionID >= 0 ){
 		G4cout << "++ "<<fullCollectionName<< " id " << collectionID << G4endl;
 		// Store obtained HitsCollection information into data members.
-		// And, creates new G4THitsMap for accumulating quantities during RUN.
+		// And, creates new tally for accumulating quantities during RUN.
 		theCollName.push_back(fullCollectionName);
 		theCollID.push_back(collectionID);
-		theRunMap.push_back(new G4THitsMap<G4double>(detName,collectionName));
+		VHDDirectScorer* direct = dynamic_cast<VHDDirectScorer*>(scorer);
+		VHDVTally* tally = CreateTally(detName,collectionName,theRunTally.size(),fBackend,masterRun,direct != 0);
+		theRunTally.push_back(tally);
+		theReducer.push_back((!masterRun && VHDTallyReducer::IsOrdered() && tally->IsCompensated()) ? new VHDTallyReducer : 0);
+		//--- the scorer adds straight into a thread-private run tally
+		if( direct ) direct->SetRunTally(tally->IsShared() ? 0 : tally);
+		theDirect.push_back(direct && !tally->IsShared());
+		//--- otherwise the scorer fills a reusable event buffer of this run
+		VHDPooledScorer* pooled = dynamic_cast<VHDPooledScorer*>(scorer);
+		VHDEventBuffer* buffer = (pooled && !theDirect.back() && VHDEventBuffer::IsPooled()) ? new VHDEventBuffer : 0;
+		if( buffer ) buffer->SetDirtyList(&theDirty,theRunTally.size()-1);
+		if( pooled ) pooled->SetEventBuffer(buffer);
+		if( !theDirect.back() && !buffer ) theHitsMapColl.push_back(theRunTally.size()-1);
+		thePooled.push_back(pooled);
+		theEventBuffer.push_back(buffer);
 	    }else{
 		G4cout << "** collection " << fullCollectionName << " not found. "<<G4endl;
 	    }
@@ -108,21 +234,166 @@ VHDMultiSDRun::VHDMultiSDRun(const std::vector<G4String> mfdName): G4Run()
   }
 }
 
+//  Create a run tally of the fused detector (VHDVoxelSD), nBins values per voxel.
+//   It has no hits collection (ID -1) and is always filled directly by the detector.
+VHDVTally* VHDMultiSDRun::CreateFusedTally(const G4String& detName, const G4String& colName,
+					   G4int nBins, const G4String& backend, const VHDMultiSDRun* masterRun)
+{
+  if( !masterRun ) G4cout << "++ " << detName << "/" << colName << " (fused, " << nBins << " bins per voxel)" << G4endl;
+  VHDVTally* tally = CreateTally(detName,colName,theRunTally.size(),backend,masterRun,true,nBins);
+  theCollName.push_back(detName+"/"+colName);
+  theCollID.push_back(-1);
+  theRunTally.push_back(tally);
+  theReducer.push_back((!masterRun && VHDTallyReducer::IsOrdered() && tally->IsCompensated()) ? new VHDTallyReducer : 0);
+  theDirect.push_back(true);
+  thePooled.push_back(0);
+  theEventBuffer.push_back(0);
+  return tally;
+}
+
+//  Create the run tally of collection # icol.
+//   A worker run shares the tally of the master run when the latter is shared;
+//   the shared backends fall back to "replica" in the sequential build.
+//   The replica of a direct scorer's collection is a dense array (VHDDenseTally),
+//   or float pairs with /VHDMSDv1/tally/precision mixed (VHDMixedTally).
+//   The quantities listed by /VHDMSDv1/tally/hashQuantities get a thread-private
+//   sparse hash table whatever the backend (VHDHashTally).
+//   With /VHDMSDv1/tally/roiFluence the cell flux collections are sized by the
+//   ROI of the voxel table (VHDRoiTally over a data tally of nRoi voxels).
+//   With /VHDMSDv1/tally/depositLog a thread-private tally is fronted by a
+//   log of deposit records reduced per batch of events (VHDLogTally).
+VHDVTally* VHDMultiSDRun::CreateTally(const G4String& detName, const G4String& colName,
+				     G4int icol, const G4String& backend, const VHDMultiSDRun* masterRun,
+				     G4bool dense, G4int nBins)
+{
+  if( masterRun && icol < static_cast<G4int>(masterRun->theRunTally.size())
+      && masterRun->theRunTally[icol]->IsShared() ){
+    VHDVTally* shared = masterRun->theRunTally[icol];
+    if( VHDCacheTally::GetSize() > 0 ){
+      //--- this worker's cache in front of the shared tally (the cache is owned, not the tally)
+      theTallyOwned.push_back(true);
+      VHDCacheTally* cache = new VHDCacheTally(shared->GetName(),shared,false,VHDCacheTally::GetSize());
+      theCache.push_back(cache);
+      return cache;
+    }
+    theTallyOwned.push_back(false);
+    return shared;
+  }
+  theTallyOwned.push_back(true);
+  const VHDDetectorConstruction* detector = (const VHDDetectorConstruction*)(G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+  //--- fluence: the data tally only holds the ROI voxels of the voxel table
+  const VHDVoxelTable* table = detector->GetVoxelTable();
+  VHDVTally* tally = 0;
+  if( VHDRoiTally::IsEnabled() && colName.find("CellFlux") != std::string::npos
+      && table && table->GetNumberOfRoiVoxels() > 0 ){
+    VHDVTally* data = CreateStore(detName,colName,backend,masterRun,dense,table->GetNumberOfRoiVoxels(),nBins,false);
+    tally = new VHDRoiTally(detName+"/"+colName,data,table,nBins);
+  }else{
+    tally = CreateStore(detName,colName,backend,masterRun,dense,detector->GetNX()*detector->GetNY()*detector->GetNZ(),nBins,true);
+  }
+  //--- deposit records reduced per batch of events (thread-private tallies only)
+  if( VHDLogTally::IsEnabled() && !tally->IsShared() ){
+    VHDLogTally* log = new VHDLogTally(detName+"/"+colName,tally);
+    theLog.push_back(log);
+    tally = log;
+  }
+  //--- write-combining cache in front (runs processing events only)
+  if( fEventLoop && VHDCacheTally::GetSize() > 0 ){
+    VHDCacheTally* cache = new VHDCacheTally(detName+"/"+colName,tally,true,VHDCacheTally::GetSize());
+    theCache.push_back(cache);
+    tally = cache;
+  }
+  //--- the backend is printed once per run, by the master (the worker runs build the same tallies)
+  if( !masterRun ) tally->Describe();
+  //--- a worker places its own tallies on its node now and reports where they landed
+  if( masterRun && VHDNumaUtil::IsFirstTouch() ) tally->FirstTouch();
+  return tally;
+}
+
+//  Create the data tally of nVoxels x nBins values for CreateTally.
+//   grid: the voxels are the nx*ny*nz grid of the detector (else the brick backend and the Morton
+//   layout, which need the grid, fall back to the dense array and the linear layout).
+VHDVTally* VHDMultiSDRun::CreateStore(const G4String& detName, const G4String& colName,
+				      const G4String& backend, const VHDMultiSDRun* masterRun,
+				      G4bool dense, G4int nVoxels, G4int nBins, G4bool grid)
+{
+  if( VHDHashTally::IsHashed(colName) )
+    return new VHDHashTally(detName+"/"+colName,nBins,VHDTallyReducer::IsOrdered());
+  const VHDDetectorConstruction* detector = (const VHDDetectorConstruction*)(G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+  G4long nValues = static_cast<G4long>(nVoxels)*nBins;
+  if( backend == "brick" && grid )
+    return new VHDBrickTally(detName+"/"+colName,detector->GetNX(),detector->GetNY(),detector->GetNZ(),nBins,VHDTallyReducer::IsOrdered());
+  VHDVoxelLayout layout(nValues);
+  if( grid )
+    layout = VHDVoxelLayout(detector->GetNX(),detector->GetNY(),detector->GetNZ(),nBins,VHDVoxelLayout::IsMortonDefault());
+#ifdef G4MULTITHREADED
+  if( !masterRun && (backend == "atomic" || backend == "atomicFloat") ){
+    layout.Print();
+    if( backend == "atomic" )
+      return new VHDSharedAtomicTally<G4double>(detName+"/"+colName,nValues,&layout);
+    return new VHDSharedAtomicTally<G4float>(detName+"/"+colName,nValues,&layout);
+  }
+#else
+  if( backend != "replica" && backend != "brick" )
+    G4cout << "** tally backend " << backend << " needs the multi-threaded build; using replica." << G4endl;
+#endif
+  if( dense || backend == "brick" ){
+    //--- one array per worker plus the master's: above the limit the sparse table, whose memory follows the hits
+    G4long bytes = layout.GetStorageSize()*(VHDMixedTally::IsMixed() ? 2*sizeof(G4float) : (VHDTallyReducer::IsOrdered() ? 2 : 1)*sizeof(G4double));
+    G4int nCopies = 1;
+#ifdef G4MULTITHREADED
+    nCopies = G4MTRunManager::GetMasterRunManager()->GetNumberOfThreads() + 1;
+#endif
+    G4double mb = static_cast<G4double>(bytes)*nCopies/1048576.;
+    if( VHDDenseTally::GetMemoryLimit() > 0 && mb > VHDDenseTally::GetMemoryLimit() ){
+      if( !masterRun )
+        G4cout << "** " << detName << "/" << colName << ": dense tallies of " << mb << " MB (" << nCopies
+               << " copies) above /VHDMSDv1/tally/denseLimit " << VHDDenseTally::GetMemoryLimit()
+               << " MB; using a hash table per thread." << G4endl;
+      return new VHDHashTally(detName+"/"+colName,nBins,VHDTallyReducer::IsOrdered());
+    }
+    if( !masterRun ) layout.Print();
+    if( VHDMixedTally::IsMixed() )
+      return new VHDMixedTally(detName+"/"+colName,nValues,VHDTallyReducer::IsOrdered(),VHDMixedTally::IsCheck(),&layout);
+    return new VHDDenseTally(detName+"/"+colName,nValues,VHDTallyReducer::IsOrdered(),&layout);
+  }
+  return new VHDHitsMapTally(detName,colName,VHDTallyReducer::IsOrdered());
+}
+
 // Destructor
 // clear all data members.
 VHDMultiSDRun::~VHDMultiSDRun()
 {
-  //--- Clear HitsMap for RUN
-  G4int Nmap = theRunMap.size();
+  //--- Clear tallies for RUN
+  G4int Nmap = theRunTally.size();
   for ( G4int i = 0; i < Nmap; i++){
-    if(theRunMap[i] ){
-    	delete theRunMap[i];
+    if(theRunTally[i] && theTallyOwned[i] ){
+    	delete theRunTally[i];
     	G4cout << "RunMap # " << i << " is deleted!" << G4endl;
     }
+    delete theReducer[i];
+    //--- unbind the scorers from the tally and buffer of this run
+    VHDDirectScorer* direct = dynamic_cast<VHDDirectScorer*>(thePooled[i]);
+    if( direct ) direct->SetRunTally(0);
+    if( thePooled[i] ) thePooled[i]->SetEventBuffer(0);
+    delete theEventBuffer[i];
   }
   theCollName.clear();
   theCollID.clear();
-  theRunMap.clear();
+  theRunTally.clear();
+  theTallyOwned.clear();
+  theReducer.clear();
+  theDirect.clear();
+  thePooled.clear();
+  theEventBuffer.clear();
+  theDirty.clear();
+  theHitsMapColl.clear();
+  theLog.clear();
+  theCache.clear();
+  for ( size_t i = 0; i < theSlice.size(); i++) delete theSlice[i];
+  theSlice.clear();
+  delete fTimer;
+  delete fPerf;
   G4cout << "Destroy VHDMultiSDRun ..." << G4endl;
 }
 
@@ -137,18 +408,35 @@ void VHDMultiSDRun::RecordEvent(const G4Event* aEvent)
   //check stuck event!!
   //G4int leEVT = aEvent->GetEventID();
 
+  //=======================================================
+  // Pooled collections: only the buffers hit in this event,
+  // each one over its touched entries only
+  //=======================================================
+  for ( size_t k = 0; k < theDirty.size(); k++ ){
+    G4int i = theDirty[k];
+    theRunTally[i]->Add(*theEventBuffer[i]);
+    theEventBuffer[i]->Reset();
+  }
+  fNMerge += theDirty.size();
+  theDirty.clear();
+
   //=============================
   // HitsCollection of This Event
   //============================
   G4HCofThisEvent* HCE = aEvent->GetHCofThisEvent();
-  if (!HCE) return;
+  if (!HCE){
+    EndOfEventTallies();
+    return;
+  }
 
   //=======================================================
   // Sum up HitsMap of this Event  into HitsMap of this RUN
+  // (the direct and pooled collections have no HitsMap)
   //=======================================================
-  G4int Ncol = theCollID.size();
+  G4int Ncol = theHitsMapColl.size();
   
-  for ( G4int i = 0; i < Ncol ; i++ ){  // Loop over HitsCollection
+  for ( G4int k = 0; k < Ncol ; k++ ){  // Loop over HitsCollection
+    G4int i = theHitsMapColl[k];
     G4THitsMap<G4double>* EvtMap=0;
     if ( theCollID[i] >= 0 ){           // Collection is attached to HCE
       EvtMap = (G4THitsMap<G4double>*)(HCE->GetHC(theCollID[i]));
@@ -156,22 +444,151 @@ void VHDMultiSDRun::RecordEvent(const G4Event* aEvent)
       G4cout <<" Error EvtMap Not Found "<< i << G4endl;
     }
     if( EvtMap ){
-      //=== Sum up HitsMap of this event to HitsMap of RUN.===
-      *theRunMap[i] += *EvtMap;
+      fNHitsMapAlloc++;
+      if( EvtMap->entries() == 0 ) continue;  // no hit in this collection
+      //=== Sum up HitsMap of this event to the tally of RUN.===
+      theRunTally[i]->Add(*EvtMap);
+      EvtMap->clear();
+      fNMerge++;
     }
-    EvtMap->clear();
    }
-  
+
+  EndOfEventTallies();
+}
+
+//  End of the event for the write-combining caches (flushed) and then for the deposit
+//  logs behind them (flushed every logBatch events).
+void VHDMultiSDRun::EndOfEventTallies()
+{
+  for ( size_t k = 0; k < theCache.size(); k++ ) theCache[k]->Flush();
+  for ( size_t k = 0; k < theLog.size(); k++ ) theLog[k]->EndOfEvent();
+}
+
+#ifdef G4MULTITHREADED
+//  Merge is called on the master run once for each worker run at the end of the run.
+void VHDMultiSDRun::Merge(const G4Run* aRun)
+{
+  const VHDMultiSDRun* localRun = static_cast<const VHDMultiSDRun*>(aRun);
+
+  G4int Ncol = theRunTally.size();
+  if( Ncol != static_cast<G4int>(localRun->theRunTally.size()) ){
+    G4Exception("VHDMultiSDRun::Merge(const G4Run*)","",FatalException,"worker and master runs have a different number of HitsMap!");
+  }
+  std::vector<G4long> copyNo;
+  std::vector<G4double> sum, comp;
+  for ( G4int i = 0; i < Ncol ; i++ ){
+    const VHDVTally* localTally = localRun->theRunTally[i];
+    //--- the worker's write-combining cache: count it and look behind it (e.g. at the shared tally itself)
+    const VHDCacheTally* cache = dynamic_cast<const VHDCacheTally*>(localTally);
+    if( cache ){
+      cache->Flush();
+      fWCAdd += cache->GetNumberOfAdds();
+      fWCHit += cache->GetNumberOfHits();
+      fWCEvict += cache->GetNumberOfEvictions();
+      fWCWrite += cache->GetNumberOfWrites();
+      fWCFlush += cache->GetNumberOfFlushes();
+      localTally = cache->GetData();
+    }
+    //--- precision check of the worker tally against its double shadow
+    VHDMixedTally* mixed = dynamic_cast<VHDMixedTally*>(theRunTally[i]);
+    if( mixed ) mixed->MergeCheck(*localTally);
+    //--- sums of squares of the deposit log (the data go through the reducer or Merge)
+    VHDLogTally* log = dynamic_cast<VHDLogTally*>(theRunTally[i]);
+    if( log ) log->MergeStats(*localTally);
+    if( theReducer[i] && localTally != theRunTally[i] ){
+      //--- ordered reduction: stage the partial of this worker, added up in ReduceTallies()
+      localTally->GetEntries(copyNo,sum,comp);
+      theReducer[i]->AddPartial(G4Threading::G4GetThreadId(),copyNo,sum,comp);
+    }else{
+      theRunTally[i]->Merge(*(localRun->theRunTally[i]));  // nothing to do for a shared tally
+    }
+  }
+
+  //--- allocation of the event hit containers of the worker
+  fNHitsMapAlloc += localRun->fNHitsMapAlloc;
+  fNMerge += localRun->fNMerge;
+  if( localRun->fPerf ){
+    fCacheMiss += localRun->fPerf->GetCacheMisses();
+    fCacheRef += localRun->fPerf->GetCacheReferences();
+  }
+  for ( G4int i = 0; i < Ncol ; i++ ){
+    const VHDEventBuffer* buffer = localRun->theEventBuffer[i];
+    if( !buffer ) continue;
+    fNBuffer++;
+    fNBufferAlloc += buffer->GetNumberOfAllocations();
+    if( buffer->GetPeakEntries() > fBufferPeak ) fBufferPeak = buffer->GetPeakEntries();
+  }
+
+  //--- the worker thread is done with its event loop
+  localRun->fTimer->Stop();
+  fWorkerID.push_back(G4Threading::G4GetThreadId());
+  fWorkerNEvent.push_back(localRun->GetNumberOfEvent());
+  fWorkerBusy.push_back(localRun->fTimer->GetRealElapsed());
+
+  G4Run::Merge(aRun);  // number of events
 }
 
+//  Utilisation = busy time of the worker / wall time of the master run.
+//  A low minimum utilisation means that some workers idled at the end of the run.
+void VHDMultiSDRun::PrintWorkerUtilisation()
+{
+  fTimer->Stop();
+  G4double wall = fTimer->GetRealElapsed();
+  G4int Nw = fWorkerID.size();
+  if( Nw == 0 || wall <= 0. ) return;
+
+  G4double sumU = 0., minU = 1., maxBusy = 0., minBusy = wall;
+  G4cout << "=== Worker utilisation (run wall time " << wall << " s) ===" << G4endl;
+  for ( G4int i = 0; i < Nw; i++ ){
+    G4double u = fWorkerBusy[i]/wall;
+    G4cout << "  worker " << fWorkerID[i] << ": " << fWorkerNEvent[i] << " events, busy "
+	   << fWorkerBusy[i] << " s, utilisation " << 100.*u << " %" << G4endl;
+    sumU += u;
+    if( u < minU ) minU = u;
+    if( fWorkerBusy[i] > maxBusy ) maxBusy = fWorkerBusy[i];
+    if( fWorkerBusy[i] < minBusy ) minBusy = fWorkerBusy[i];
+  }
+  G4cout << "  mean utilisation " << 100.*sumU/Nw << " %, min " << 100.*minU
+	 << " %, tail (last - first worker done) " << maxBusy - minBusy << " s" << G4endl;
+}
+#endif
+
 //=================================================================
-//  Access method for HitsMap of the RUN
+//  Access method for the tallies of the RUN
 //
+//-----
+// Access tally.
+//  By full description of collection name, that is
+//    <MultiFunctional Detector Name>/<Primitive Scorer Name>
+VHDVTally* VHDMultiSDRun::GetTally(const G4String& fullName) const {
+    G4int Ncol = theCollName.size();
+    for ( G4int i = 0; i < Ncol; i++){
+	if ( theCollName[i] == fullName ){
+	    return theRunTally[i];
+	}
+    }
+    //--- energy bins of the fused cell flux tensor
+    for ( size_t i = 0; i < theSlice.size(); i++){
+	if ( theSlice[i]->GetName() == fullName ){
+	    return theSlice[i];
+	}
+    }
+    return NULL;
+}
+
+//-----
+// Access HitsMap (replica backend only).
+//  By sequential number.
+G4THitsMap<G4double>* VHDMultiSDRun::GetHitsMap(G4int i) const {
+    VHDHitsMapTally* tally = dynamic_cast<VHDHitsMapTally*>(theRunTally[i]);
+    return tally ? tally->GetHitsMap() : NULL;
+}
+
 //-----
 // Access HitsMap.
 //  By  MultiFunctionalDetector name and Collection Name.
 G4THitsMap<G4double>* VHDMultiSDRun::GetHitsMap(const G4String& detName,
-					 const G4String& colName){
+					 const G4String& colName) const {
     G4String fullName = detName+"/"+colName;
     return GetHitsMap(fullName);
 }
@@ -180,38 +597,180 @@ G4THitsMap<G4double>* VHDMultiSDRun::GetHitsMap(const G4String& detName,
 // Access HitsMap.
 //  By full description of collection name, that is
 //    <MultiFunctional Detector Name>/<Primitive Scorer Name>
-G4THitsMap<G4double>* VHDMultiSDRun::GetHitsMap(const G4String& fullName){
-    G4int Ncol = theCollName.size();
-    for ( G4int i = 0; i < Ncol; i++){
-	if ( theCollName[i] == fullName ){
-	    return theRunMap[i];
-	}
-    }
-    return NULL;
+G4THitsMap<G4double>* VHDMultiSDRun::GetHitsMap(const G4String& fullName) const {
+    VHDHitsMapTally* tally = dynamic_cast<VHDHitsMapTally*>(GetTally(fullName));
+    return tally ? tally->GetHitsMap() : NULL;
 }
 
 //-----
-// - Dump All HitsMap of this RUN. (for debuging and monitoring of quantity).
-//   This method calls G4THisMap::PrintAll() for individual HitsMap.
+// - Dump All tallies of this RUN. (for debuging and monitoring of quantity).
 void VHDMultiSDRun::DumpAllScorer(){
 
-  // - Number of HitsMap in this RUN.
+  // - Number of tallies in this RUN.
   G4int n = GetNumberOfHitsMap();
-  // - GetHitsMap and dump values.
+  std::vector<G4long> copyNo;
+  std::vector<G4double> val;
+  // - Get tally and dump values.
   for ( G4int i = 0; i < n ; i++ ){
-    G4THitsMap<G4double>* RunMap =GetHitsMap(i);
-    if ( RunMap ) {
-      G4cout << " PrimitiveScorer RUN " 
-	     << RunMap->GetSDname() <<","<< RunMap->GetName() << G4endl;
-      G4cout << " Number of entries " << RunMap->entries() << G4endl;
-      std::map<G4int,G4double*>::iterator itr = RunMap->GetMap()->begin();
-      for(; itr != RunMap->GetMap()->end(); itr++) {
-	G4cout << "  copy no.: " << itr->first
-	       << "  Run Value : " << *(itr->second) 
+    theRunTally[i]->GetEntries(copyNo,val);
+    G4cout << " PrimitiveScorer RUN " << theRunTally[i]->GetName() << G4endl;
+    G4cout << " Number of entries " << copyNo.size() << G4endl;
+    for ( size_t j = 0; j < copyNo.size(); j++ ){
+	G4cout << "  copy no.: " << copyNo[j]
+	       << "  Run Value : " << val[j]
 	       << G4endl;
-      }
     }
   }
 }
 
+//-----
+// - Print the statistics of the tally backend.
+void VHDMultiSDRun::ReportTallies() const {
+  G4int n = theRunTally.size();
+  for ( G4int i = 0; i < n ; i++ ) theRunTally[i]->Report();
+
+  //--- event hit containers of this run and of the merged worker runs
+  G4long nBuffer = fNBuffer, nAlloc = fNBufferAlloc;
+  G4int peak = fBufferPeak;
+  for ( G4int i = 0; i < n ; i++ ){
+    if( !theEventBuffer[i] ) continue;
+    nBuffer++;
+    nAlloc += theEventBuffer[i]->GetNumberOfAllocations();
+    if( theEventBuffer[i]->GetPeakEntries() > peak ) peak = theEventBuffer[i]->GetPeakEntries();
+  }
+  G4cout << "=== Event hit containers: " << fNHitsMapAlloc << " G4THitsMap allocated, "
+	 << nBuffer << " pooled event buffers (" << nAlloc << " allocations, at most "
+	 << peak << " entries in one event) ===" << G4endl;
+  if( numberOfEvent > 0 )
+    G4cout << "    collections added up per event: " << static_cast<G4double>(fNMerge)/numberOfEvent
+	   << " (only the collections hit)" << G4endl;
 
+  //--- write-combining caches of this run and of the merged worker runs
+  G4long wcAdd = fWCAdd, wcHit = fWCHit, wcEvict = fWCEvict, wcWrite = fWCWrite, wcFlush = fWCFlush;
+  for ( size_t k = 0; k < theCache.size(); k++ ){
+    theCache[k]->Flush();
+    wcAdd += theCache[k]->GetNumberOfAdds();
+    wcHit += theCache[k]->GetNumberOfHits();
+    wcEvict += theCache[k]->GetNumberOfEvictions();
+    wcWrite += theCache[k]->GetNumberOfWrites();
+    wcFlush += theCache[k]->GetNumberOfFlushes();
+  }
+  if( wcAdd > 0 ){
+    G4cout << "=== Write-combining caches (" << VHDCacheTally::GetSize() << " slots): " << wcAdd << " adds, hit rate "
+	   << 100.*wcHit/wcAdd << " %, " << wcEvict << " evictions, " << wcFlush << " end-of-event flushes, "
+	   << wcWrite << " writes into the run tallies (" << 100.*wcWrite/wcAdd << " % of the adds) ===" << G4endl;
+  }
+
+  //--- cache misses of the event loops, to compare the tally layouts
+  if( !VHDPerfCounter::IsEnabled() ) return;
+  G4long nMiss = fCacheMiss, nRef = fCacheRef;
+  if( fPerf ){
+    nMiss += fPerf->GetCacheMisses();
+    nRef += fPerf->GetCacheReferences();
+  }
+  G4cout << "=== Cache misses (" << (VHDVoxelLayout::IsMortonDefault() ? "morton" : "linear")
+	 << " layout): " << nMiss << " of " << nRef << " cache references";
+  if( nRef > 0 ) G4cout << " (" << 100.*nMiss/nRef << " %)";
+  if( numberOfEvent > 0 ) G4cout << ", " << static_cast<G4double>(nMiss)/numberOfEvent << " per event";
+  G4cout << " ===" << G4endl;
+}
+
+//-----
+// - Add up the staged partials of each tally, ordered by thread / shard ID.
+//   The entries scored by this run itself (none on the MT master) come first.
+void VHDMultiSDRun::ReduceTallies() {
+  G4int nThreads = 1;
+#ifdef G4MULTITHREADED
+  nThreads = G4MTRunManager::GetMasterRunManager()->GetNumberOfThreads();
+#endif
+  G4Timer timer;
+  timer.Start();
+  G4int n = theRunTally.size(), nPart = 0;
+  std::vector<G4long> copyNo;
+  std::vector<G4double> sum, comp;
+  for ( G4int i = 0; i < n ; i++ ){
+    if( !theReducer[i] || theReducer[i]->GetNumberOfPartials() == 0 ) continue;
+    VHDVTally* tally = theRunTally[i];
+    tally->GetEntries(copyNo,sum,comp);
+    if( !copyNo.empty() ) theReducer[i]->AddPartial(-1,copyNo,sum,comp);
+    nPart = theReducer[i]->GetNumberOfPartials();
+    theReducer[i]->Reduce(copyNo,sum,comp,nThreads);
+    tally->SetEntries(copyNo,sum,comp);
+  }
+  timer.Stop();
+  if( nPart > 0 )
+    G4cout << "=== Ordered reduction of " << nPart << " partial tallies (blocks of " << VHDTallyReducer::GetBlockSize()
+	   << " voxels, " << nThreads << " threads): " << timer.GetRealElapsed() << " s" << G4endl;
+}
+
+//-----
+// - Save all HitsMaps of this RUN to a binary shard file.
+//   Format: number of events, number of HitsMap (G4int), then for each HitsMap
+//   the number of entries followed by the (copy no., sum, compensation) triplets;
+//   the entry counts and the copy numbers are G4long.
+G4bool VHDMultiSDRun::WriteShard(const G4String& fname) const
+{
+  std::ofstream fout(fname.c_str(),std::ios::binary);
+  if( !fout.good() ){
+    G4cout << "cannot open file " << fname << G4endl;
+    return false;
+  }
+  G4int nevt = numberOfEvent;
+  G4int Nmap = theRunTally.size();
+  fout.write((const char*)&nevt,sizeof(G4int));
+  fout.write((const char*)&Nmap,sizeof(G4int));
+  std::vector<G4long> copyNo;
+  std::vector<G4double> sum, comp;
+  for ( G4int i = 0; i < Nmap; i++ ){
+    theRunTally[i]->GetEntries(copyNo,sum,comp);
+    G4long n = copyNo.size();
+    fout.write((const char*)&n,sizeof(G4long));
+    for ( G4long j = 0; j < n; j++ ){
+      fout.write((const char*)&copyNo[j],sizeof(G4long));
+      fout.write((const char*)&sum[j],sizeof(G4double));
+      fout.write((const char*)&comp[j],sizeof(G4double));
+    }
+  }
+  fout.close();
+  return !fout.fail();
+}
+
+//-----
+// - Add a shard file written by WriteShard(..) into the HitsMaps of this RUN
+//   (staged as partial # order with the ordered reduction).
+G4bool VHDMultiSDRun::ReadShard(const G4String& fname, G4int order)
+{
+  std::ifstream fin(fname.c_str(),std::ios::binary);
+  if( !fin.good() ){
+    G4cout << "cannot open file " << fname << G4endl;
+    return false;
+  }
+  G4int nevt = 0, Nmap = 0;
+  fin.read((char*)&nevt,sizeof(G4int));
+  fin.read((char*)&Nmap,sizeof(G4int));
+  if( Nmap != static_cast<G4int>(theRunTally.size()) ){
+    G4Exception("VHDMultiSDRun::ReadShard(const G4String&)","",FatalException,G4String("shard and run have a different number of HitsMap: " + fname).c_str());
+  }
+  for ( G4int i = 0; i < Nmap && fin.good(); i++ ){
+    G4long n = 0;
+    fin.read((char*)&n,sizeof(G4long));
+    std::vector<G4long> copyNo(n);
+    std::vector<G4double> sum(n), comp(n);
+    for ( G4long j = 0; j < n; j++ ){
+      fin.read((char*)&copyNo[j],sizeof(G4long));
+      fin.read((char*)&sum[j],sizeof(G4double));
+      fin.read((char*)&comp[j],sizeof(G4double));
+    }
+    if( theReducer[i] ){
+      theReducer[i]->AddPartial(order,copyNo,sum,comp);
+    }else{
+      for ( G4long j = 0; j < n; j++ ){
+        theRunTally[i]->Add(copyNo[j],sum[j]);
+        if( comp[j] != 0. ) theRunTally[i]->Add(copyNo[j],comp[j]);
+      }
+    }
+  }
+  if( !fin.good() ) return false;
+  numberOfEvent += nevt;
+  return true;
+}
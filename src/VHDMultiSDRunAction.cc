@@ -29,27 +29,40 @@
 // 
 #include "VHDMultiSDRunAction.hh"
 #include "VHDMultiSDRun.hh"
+#include "VHDMSDSteppingAction.hh"
+#include "VHDRandomMessenger.hh"
+#include "VHDTallyMessenger.hh"
+#include "VHDPhiloxEngine.hh"
 
 //-- In order to obtain detector information.
 #include "G4RunManager.hh"
 #include "VHDDetectorConstruction.hh"
+#include "VHDVoxelTable.hh"
+#include "VHDRoiTally.hh"
 #include "G4THitsMap.hh"
 #include "G4UnitsTable.hh"
 #include <time.h>
+#include <sys/time.h>
+#include <unistd.h>
 
 
 // Constructor
 VHDMultiSDRunAction::VHDMultiSDRunAction()
+  : fShardID(-1), fShardSeed(0), fSeed(0), fTallyBackend("replica")
 {
   // - Prepare data member for VHDMultiSDRun.
   //   vector represents a list of MultiFunctionalDetector names.
   theSDName.push_back(G4String("PhantomSD"));
+  fRandomMessenger = new VHDRandomMessenger(this);
+  fTallyMessenger = new VHDTallyMessenger(this);
 }
 
 // Destructor.
 VHDMultiSDRunAction::~VHDMultiSDRunAction()
 {
   theSDName.clear();
+  delete fRandomMessenger;
+  delete fTallyMessenger;
 
   G4cout << "Destroying VHDMultiSDRunAction! " << G4endl;
 }
@@ -61,7 +74,15 @@ G4Run* VHDMultiSDRunAction::GenerateRun()
   // Generate new RUN object, which is specially
   // dedicated for MultiFunctionalDetector scheme.
   //  Detail description can be found in VHDMultiSDRun.hh/cc.
-  return new VHDMultiSDRun(theSDName);
+  //  (the worker runs follow the backend of the master run)
+  //--- ROI-sized fluence: the master numbers the ROI voxels before any run tally is created
+  G4bool master = true;
+#ifdef G4MULTITHREADED
+  master = IsMaster();
+#endif
+  const VHDDetectorConstruction* detector = (const VHDDetectorConstruction*)(G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+  if( master && VHDRoiTally::IsEnabled() && detector->GetVoxelTable() ) detector->GetVoxelTable()->BuildRoi();
+  return new VHDMultiSDRun(theSDName,fTallyBackend);
 }
 
 //
@@ -69,9 +90,18 @@ G4Run* VHDMultiSDRunAction::GenerateRun()
 void VHDMultiSDRunAction::BeginOfRunAction(const G4Run* aRun)
 {
   G4cout << "### Run " << aRun->GetRunID() << " start." << G4endl;
-  G4long seed = time(0);
+#ifdef G4MULTITHREADED
+  //the worker engines are re-seeded event by event from the master engine
+  if(!IsMaster()) return;
+#endif
+  G4long seed = (fShardID >= 0) ? fShardSeed : NextSeed();
   G4cout << "The seed of this run = " << seed << G4endl;
-  CLHEP::HepRandom::setTheSeed(seed);
+  //two seeds (RanecuEngine::setSeed only picks one of its 215 seed pairs)
+  fSeeds[0] = 1 + (seed & 0x7fffffffL) % 2147483562L;
+  fSeeds[1] = 1 + ((seed >> 31) & 0x7fffffffL) % 2147483398L;
+  fSeeds[2] = 0;
+  CLHEP::HepRandom::setTheSeeds(fSeeds);
+  VHDPhiloxEngine::SetRunSeed(seed);  //key of the counter-based engine of every thread
   CLHEP::HepRandom::showEngineStatus();
   
 }
@@ -80,11 +110,32 @@ void VHDMultiSDRunAction::BeginOfRunAction(const G4Run* aRun)
 void VHDMultiSDRunAction::EndOfRunAction(const G4Run* aRun)
 {
 
+#ifdef G4MULTITHREADED
+  //the worker runs have been merged into the master run; only the master writes the output files
+  if(!IsMaster()){
+	VHDMSDSteppingAction::MergeWorkerHistograms();  //energy spectra of this worker into the master ones
+	return;
+  }
+  VHDMSDSteppingAction::WriteMergedHistograms(dirName);
+#endif
+
+  //fork mode: the child process only saves its shard, the parent reduces the shards and writes the output
+  if(fShardID >= 0){
+	if(!((VHDMultiSDRun*)aRun)->WriteShard(ShardFileName(fShardID)))
+		G4Exception("EndOfRunAction(const G4Run*)","",FatalException,"cannot write the shard file!");
+	return;
+  }
+
   //print out the total number of events during this run
   G4cout << "Number of Events in this run: " << aRun->GetNumberOfEvent() << G4endl;
 
   //- VHDMultiSDRun object.
   VHDMultiSDRun* MSDRun = (VHDMultiSDRun*)aRun;
+#ifdef G4MULTITHREADED
+  MSDRun->PrintWorkerUtilisation();
+#endif
+  MSDRun->ReduceTallies();  //ordered reduction of the worker / shard partials
+  MSDRun->ReportTallies();
   //--- Dump all socred quantities involved in VHDMultiSDRun to debug!
   //MSDRun->DumpAllScorer();
   //---
@@ -102,31 +153,35 @@ void VHDMultiSDRunAction::EndOfRunAction(const G4Run* aRun)
   // Dump accumulated quantities for this RUN.
   //  (Display only central region of x-y plane)
   //---------------------------------------------
-  G4THitsMap<G4double>* totEdep = MSDRun->GetHitsMap("PhantomSD/totalEDep");
+  VHDVTally* totEdep = MSDRun->GetTally("PhantomSD/totalEDep");
+  if(detector->GetVoxelTable()) detector->GetVoxelTable()->PrintOrganDose(totEdep,aRun->GetNumberOfEvent());
 
-  std::vector<G4THitsMap<G4double>*> pCellFlux;
+  std::vector<VHDVTally*> pCellFlux;
   char snamechar[50];
   for(G4int i = 0; i < NEbin; i++)
   {	
 	std::sprintf(snamechar,"PhantomSD/PhotonCellFlux%02d",i);
       	G4String sname(snamechar);
-	G4THitsMap<G4double>* tmp = MSDRun->GetHitsMap(sname);
+	VHDVTally* tmp = MSDRun->GetTally(sname);
 	if(tmp != NULL){
 		pCellFlux.push_back(tmp);
 	}
   }
 
-  G4int ix,iy,iz,n,m;
+  G4int iz,n,m;
   char fname1[700],fname2[700];
-  int b,indx;
+  int indx;
   
   FILE *pt1,*pt2;
   float *edepimg = 0;
   int nxny = static_cast<int>(fNxNy);
-  G4double zero = 0.0;
-  G4double* zero_ptr = &zero;
 
   std::vector<float*> pcellfluxhitimg;
+  std::vector<G4double> slice(nxny);  //one z slice of a tally (FillZSlice visits only the bricks hit with the brick backend)
+  //ROI fluence tallies: one compact file per energy bin instead of one nx*ny slice per bin and z
+  const VHDVoxelTable* table = detector->GetVoxelTable();
+  G4bool roiOut = VHDRoiTally::IsEnabled() && table && table->GetNumberOfRoiVoxels() > 0;
+  G4int nFluxSlice = roiOut ? 0 : NEbin;
   if(dirName != 0){
 	for(iz = 0; iz < fNz; iz++){
 		std::sprintf(fname1,"%s/Edep_MultiSD/Edep%03d.raw",dirName,iz);
@@ -136,37 +191,21 @@ void VHDMultiSDRunAction::EndOfRunAction(const G4Run* aRun)
 		}
 		else{
 			edepimg = new float [nxny];  //dynamic allocation of array memory
-			for(n=0; n<NEbin; n++)	pcellfluxhitimg.push_back(new float [nxny]);  //create all the image float arrays
-			for(iy = 0; iy < fNy; iy++){
-				b = iy*fNx;
-				for(ix = 0; ix < fNx; ix++){
-					indx = b + ix;
-					G4double* totED = (*totEdep)[CopyNo(ix,iy,iz)];
-					if (!totED ) totED = zero_ptr;
-					//instead of assigning totED = new G4double(0.0), just set it to a pointer of G4double = 0.0
-					//since (*totEdep)[CopyNo(ix,iy,iz)] does not call a 'new' statement while it's accessing the recorded map
-					//delete totED will be inappropriate as totED does not get a 'new' statement necessarily at every iteration
-					//so, Fares suggested that assigning totED to a pointer of G4double = 0.0 is more appropriate
-					//and the program will take care of its creation and deleting the memory once the program exits
-
-					//G4cout << "totED = " << *totED*1000 << " keV!" << G4endl;  //THIS STATEMENT HAS TO BE AFTER THE IF STATEMENT!!!! 
-					//THE IF STATEMENT IS TO CREATE A G4DOUBLE IF THE CopyNo in totEdep does not exist since the hitmap is recorded using std::map with copyNo and energy deposit!!!
-					//edepimg[indx] = static_cast< float >((*totED)*1000);
-					edepimg[indx] = static_cast< float >(*totED);   //unit of MeV
-
-					for(m=0; m< NEbin; m++){
-						G4double* eh = (*pCellFlux[m])[CopyNo(ix,iy,iz)];
-						if (!eh) eh = zero_ptr;
-						pcellfluxhitimg[m][indx] = static_cast< float >(*eh);    //unit of cm-2
-					}
-				}
+			for(n=0; n<nFluxSlice; n++)	pcellfluxhitimg.push_back(new float [nxny]);  //create all the image float arrays
+			totEdep->FillZSlice(iz,nxny,&slice[0]);
+			for(indx = 0; indx < nxny; indx++)
+				edepimg[indx] = static_cast< float >(slice[indx]);   //unit of MeV
+			for(m=0; m< nFluxSlice; m++){
+				pCellFlux[m]->FillZSlice(iz,nxny,&slice[0]);
+				for(indx = 0; indx < nxny; indx++)
+					pcellfluxhitimg[m][indx] = static_cast< float >(slice[indx]);    //unit of cm-2
 			}
 			fwrite(edepimg,sizeof(float),fNxNy,pt1);
 			fclose(pt1);
 			delete[] edepimg;
 
 
-			for(m=0; m<NEbin; m++){
+			for(m=0; m<nFluxSlice; m++){
 				std::sprintf(fname2,"%s/pCellFlux%02d/fluence%03d.raw",dirName,static_cast<int>(m+1),iz);
 				pt2 = fopen(fname2,"wb");
 				if(pt2 == NULL){
@@ -183,12 +222,63 @@ void VHDMultiSDRunAction::EndOfRunAction(const G4Run* aRun)
 			
 		}
 	}
+	if(roiOut) WriteRoiFluence(table,pCellFlux);
   }
 }
 
+//ROI output: roiVoxels.raw holds the copy number (ix + iy*nx + iz*nx*ny, int32) of every ROI voxel,
+//pCellFlux%02d/fluenceROI.raw the fluence of these voxels in the same order (float, cm-2)
+void VHDMultiSDRunAction::WriteRoiFluence(const VHDVoxelTable* table, const std::vector<VHDVTally*>& pCellFlux)
+{
+	char fname[700];
+	G4int nRoi = table->GetNumberOfRoiVoxels();
+	std::vector<int> voxel(nRoi);
+	for(G4int r = 0; r < nRoi; r++)	voxel[r] = table->GetRoiVoxel(r);
+	std::sprintf(fname,"%s/roiVoxels.raw",dirName);
+	FILE* pt = fopen(fname,"wb");
+	if(pt == NULL){
+		printf("cannot open file %s\n",fname);
+		return;
+	}
+	fwrite(&voxel[0],sizeof(int),nRoi,pt);
+	fclose(pt);
+
+	std::vector<float> fluence(nRoi);
+	for(size_t m = 0; m < pCellFlux.size(); m++){
+		for(G4int r = 0; r < nRoi; r++)	fluence[r] = static_cast< float >(pCellFlux[m]->Get(voxel[r]));    //unit of cm-2
+		std::sprintf(fname,"%s/pCellFlux%02d/fluenceROI.raw",dirName,static_cast<int>(m+1));
+		pt = fopen(fname,"wb");
+		if(pt == NULL){
+			printf("cannot open file %s\n",fname);
+			continue;
+		}
+		fwrite(&fluence[0],sizeof(float),nRoi,pt);
+		fclose(pt);
+	}
+	G4cout << "ROI fluence: " << nRoi << " voxels x " << pCellFlux.size() << " bins written ("
+	       << nRoi*sizeof(float)*pCellFlux.size()/1048576. << " MB instead of "
+	       << static_cast<G4double>(fNxNy)*fNz*sizeof(float)*pCellFlux.size()/1048576. << " MB)" << G4endl;
+}
+
 
 void VHDMultiSDRunAction::SetRunInfo(char dname[])
 {
 	strcpy(dirName,dname);
 }
 
+//time(0) alone gives the same seed to the jobs started in the same second
+G4long VHDMultiSDRunAction::NextSeed() const
+{
+	if(fSeed != 0) return fSeed;
+	struct timeval tv;
+	gettimeofday(&tv,0);
+	return ((G4long)tv.tv_sec << 20) ^ (G4long)tv.tv_usec ^ ((G4long)getpid() << 40);
+}
+
+G4String VHDMultiSDRunAction::ShardFileName(G4int id) const
+{
+	char fname[800];
+	std::sprintf(fname,"%s/shard%03d.bin",dirName,id);
+	return G4String(fname);
+}
+
@@ -35,8 +35,10 @@
 
 #include "VHDMultiSDRunActionROOT.hh"
 #include "VHDMultiSDRun.hh"
+#include "VHDMSDSteppingAction.hh"
 #include "G4RunManager.hh"
 #include "VHDDetectorConstruction.hh"
+#include "VHDVoxelTable.hh"
 #include "G4THitsMap.hh"
 #include "G4UnitsTable.hh"
 
@@ -62,12 +64,32 @@ VHDMultiSDRunActionROOT::~VHDMultiSDRunActionROOT()
 
 void VHDMultiSDRunActionROOT::EndOfRunAction(const G4Run* aRun)
 {
+#ifdef G4MULTITHREADED
+  //the worker runs have been merged into the master run; only the master writes the root files
+  if(!IsMaster()){
+	VHDMSDSteppingAction::MergeWorkerHistograms();  //energy spectra of this worker into the master ones
+	return;
+  }
+  VHDMSDSteppingAction::WriteMergedHistograms(dirName);
+#endif
+
+  //fork mode: the child process only saves its shard, the parent reduces the shards and writes the output
+  if(fShardID >= 0){
+	if(!((VHDMultiSDRun*)aRun)->WriteShard(ShardFileName(fShardID)))
+		G4Exception("EndOfRunAction(const G4Run*)","",FatalException,"cannot write the shard file!");
+	return;
+  }
 
   //print out the total number of events during this run
   G4cout << "Number of Events in this run: " << aRun->GetNumberOfEvent() << G4endl;
 
   //- VHDMultiSDRun object.
   VHDMultiSDRun* MSDRun = (VHDMultiSDRun*)aRun;
+#ifdef G4MULTITHREADED
+  MSDRun->PrintWorkerUtilisation();
+#endif
+  MSDRun->ReduceTallies();  //ordered reduction of the worker / shard partials
+  MSDRun->ReportTallies();
 
   //--- Dump all socred quantities involved in VHDMultiSDRun to check for ouptput!
   //MSDRun->DumpAllScorer();
@@ -87,20 +109,21 @@ void VHDMultiSDRunActionROOT::EndOfRunAction(const G4Run* aRun)
   // Dump accumulated quantities for this RUN.
   //  (Display only central region of x-y plane)
   //---------------------------------------------
-  G4THitsMap<G4double>* totEdep = MSDRun->GetHitsMap("PhantomSD/totalEDep");
+  VHDVTally* totEdep = MSDRun->GetTally("PhantomSD/totalEDep");
+  if(detector->GetVoxelTable()) detector->GetVoxelTable()->PrintOrganDose(totEdep,aRun->GetNumberOfEvent());
  
-  std::vector<G4THitsMap<G4double>*> pCellFlux;
+  std::vector<VHDVTally*> pCellFlux;
   char snamechar[50];
   for(G4int i = 0; i < NEbin; i++)
   {
 	std::sprintf(snamechar,"PhantomSD/PhotonCellFlux%02d",i);
       	G4String sname(snamechar);
-	G4THitsMap<G4double>* tmp = MSDRun->GetHitsMap(sname);
+	VHDVTally* tmp = MSDRun->GetTally(sname);
 	if(tmp != NULL){
 		pCellFlux.push_back(tmp);
 	}
   }
-  G4cout << "after reading the PhotonCellFlux G4THitsMap..." << G4endl;
+  G4cout << "after reading the PhotonCellFlux tallies..." << G4endl;
 
   G4int ix,iy,iz,m;
   char fname1[700],fname2[700];
@@ -137,7 +160,13 @@ void VHDMultiSDRunActionROOT::EndOfRunAction(const G4Run* aRun)
 	TreeHolder.push_back(letree);
   }
   
+  //one z slice of each tally at a time (FillZSlice visits only the bricks hit with the brick backend)
+  G4int nxny = fNxNy;
+  std::vector<G4double> edepSlice(nxny);
+  std::vector< std::vector<G4double> > fluxSlice(NEbin,std::vector<G4double>(nxny));
   for(iz = 0; iz < fNz; iz++){
+	totEdep->FillZSlice(iz,nxny,&edepSlice[0]);
+	for(m=0; m< NEbin; m++)	pCellFlux[m]->FillZSlice(iz,nxny,&fluxSlice[m][0]);
 	for(iy = 0; iy < fNy; iy++){
 		for(ix = 0; ix < fNx; ix++){
 			//set up the posX, posY, posZ
@@ -145,18 +174,18 @@ void VHDMultiSDRunActionROOT::EndOfRunAction(const G4Run* aRun)
 			posY = static_cast<int>(iy);
 			posZ = static_cast<int>(iz);
 			
-			G4double* eh1 = (*totEdep)[CopyNo(ix,iy,iz)];
-			if (eh1){  //write out (x,y,z) and Edep for voxels with energy deposit..
+			G4double eh1 = edepSlice[ix + iy*fNx];
+			if (eh1 != 0.){  //write out (x,y,z) and Edep for voxels with energy deposit..
 				
-				edep = static_cast< float >(*eh1);
+				edep = static_cast< float >(eh1);
 				EdepTree->Fill();
 
 			}
 			
 			for(m=0; m< NEbin; m++){
-				G4double* eh2 = (*pCellFlux[m])[CopyNo(ix,iy,iz)];
-				if(eh2){
-					fluence[m] = static_cast< float >(*eh2);   //unit of cm-2
+				G4double eh2 = fluxSlice[m][ix + iy*fNx];
+				if(eh2 != 0.){
+					fluence[m] = static_cast< float >(eh2);   //unit of cm-2
 					TreeHolder[m]->Fill();
 				}
 			}	
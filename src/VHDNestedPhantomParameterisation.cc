@@ -32,6 +32,8 @@
  */
 
 #include "VHDNestedPhantomParameterisation.hh"
+#include "VHDRunLengthLabels.hh"
+#include "VHDMaterialIndices.hh"
 #include "G4VPhysicalVolume.hh"
 #include "G4VTouchable.hh"
 #include "G4ThreeVector.hh"
@@ -51,6 +53,7 @@ VHDNestedPhantomParameterisation::VHDNestedPhantomParameterisation(const G4Three
   // x and y positions are already defined in DetectorConstruction by using
   // replicated volume. Here only we need to define is z positions of voxels.
   fMaterialIndices = 0;
+  fRunLabels = 0;
   
 //#ifdef G4VIS_USE
  //  ReadColourData();
@@ -127,8 +130,8 @@ G4Material* VHDNestedPhantomParameterisation::ComputeMaterial(G4VPhysicalVolume*
 //------------------------------------------------------------------
 unsigned int VHDNestedPhantomParameterisation::GetMaterialIndex( unsigned int copyNo ) const
 {
-  return *(fMaterialIndices+copyNo); //so *(fMaterialIndices+copyNo) is the same as fMaterialIndices[copyNo]
-  //THIS IS DEREFERENCING IN C++!!! ex: a[5] = 0 means a [offset of 5] = 0, and *(a+5) = 0 means pointed by (a+5) = 0
+  if( !fMaterialIndices ) return fRunLabels->GetMaterialIndex(copyNo);
+  return fMaterialIndices->Get(copyNo);
 }
 
 // Number of Materials
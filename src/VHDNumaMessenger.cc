@@ -0,0 +1,101 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+/**
+ * @file   VHDNumaMessenger.cc
+ * @brief  define the messenger for the NUMA placement of the worker threads and voxel arrays
+ *
+ * @name   Geant4.9.6-p02
+ */
+
+#include "VHDNumaMessenger.hh"
+#include "VHDNumaUtil.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithABool.hh"
+#include "G4UIcmdWithoutParameter.hh"
+
+
+VHDNumaMessenger::VHDNumaMessenger()
+{
+  numaDir = new G4UIdirectory("/VHDMSDv1/numa/");
+  numaDir->SetGuidance("NUMA placement commands");
+
+  pinCmd = new G4UIcmdWithAString("/VHDMSDv1/numa/pin",this);
+  pinCmd->SetGuidance("Bind each worker thread to the CPUs of one NUMA node (MT, before the first /run/beamOn):");
+  pinCmd->SetGuidance("  none (default), compact (fill node 0 first) or spread (round robin over the nodes)");
+  pinCmd->SetParameterName("policy",false);
+  pinCmd->SetCandidates("none compact spread");
+  pinCmd->AvailableForStates(G4State_PreInit,G4State_Idle);
+  pinCmd->SetToBeBroadcasted(false);
+
+  hugePagesCmd = new G4UIcmdWithABool("/VHDMSDv1/numa/hugePages",this);
+  hugePagesCmd->SetGuidance("Back the large voxel arrays allocated from now on with transparent huge pages.");
+  hugePagesCmd->SetParameterName("huge",false);
+  hugePagesCmd->AvailableForStates(G4State_PreInit,G4State_Idle);
+  hugePagesCmd->SetToBeBroadcasted(false);
+
+  firstTouchCmd = new G4UIcmdWithABool("/VHDMSDv1/numa/firstTouch",this);
+  firstTouchCmd->SetGuidance("Each worker writes every page of its dense run tallies when it creates them (MT),");
+  firstTouchCmd->SetGuidance("so that they are placed on its node at once, and prints the node of their pages.");
+  firstTouchCmd->SetGuidance("The whole grids are then committed, not only the voxels hit.");
+  firstTouchCmd->SetParameterName("touch",false);
+  firstTouchCmd->AvailableForStates(G4State_PreInit,G4State_Idle);
+  firstTouchCmd->SetToBeBroadcasted(false);
+
+  reportCmd = new G4UIcmdWithoutParameter("/VHDMSDv1/numa/report",this);
+  reportCmd->SetGuidance("Print the NUMA nodes and the current settings.");
+  reportCmd->AvailableForStates(G4State_PreInit,G4State_Idle);
+  reportCmd->SetToBeBroadcasted(false);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+VHDNumaMessenger::~VHDNumaMessenger()
+{
+  delete pinCmd;
+  delete hugePagesCmd;
+  delete firstTouchCmd;
+  delete reportCmd;
+  delete numaDir;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void VHDNumaMessenger::SetNewValue(G4UIcommand* command, G4String newValue)
+{
+  if( command == pinCmd )
+	VHDNumaUtil::SetPinPolicy(newValue);
+
+  if( command == hugePagesCmd )
+	VHDNumaUtil::SetHugePages(hugePagesCmd->GetNewBoolValue(newValue));
+
+  if( command == firstTouchCmd )
+	VHDNumaUtil::SetFirstTouch(firstTouchCmd->GetNewBoolValue(newValue));
+
+  if( command == reportCmd )
+	VHDNumaUtil::PrintTopology();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,178 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+/**
+ * @file   VHDNumaUtil.cc
+ * @brief  NUMA helpers: thread pinning, first-touch/huge-page allocation and page placement report
+ *
+ * @name   Geant4.9.6-p02
+ */
+
+#include "VHDNumaUtil.hh"
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#ifdef __linux__
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+G4String VHDNumaUtil::sPinPolicy = "none";
+G4bool VHDNumaUtil::sHugePages = false;
+G4bool VHDNumaUtil::sFirstTouch = false;
+
+//cpulist/online format of sysfs, e.g. "0-15,32-47"
+std::vector<G4int> VHDNumaUtil::ParseCPUList(const G4String& fname)
+{
+  std::vector<G4int> list;
+  std::ifstream fin(fname.c_str());
+  std::string line;
+  if(!fin.is_open() || !std::getline(fin,line)) return list;
+  std::stringstream ss(line);
+  std::string range;
+  while(std::getline(ss,range,','))
+  {
+	G4int first = 0, last = -1;
+	if(sscanf(range.c_str(),"%d-%d",&first,&last) == 1) last = first;
+	for(G4int i = first; i <= last; i++) list.push_back(i);
+  }
+  return list;
+}
+
+G4int VHDNumaUtil::GetNumberOfNodes()
+{
+  std::vector<G4int> nodes = ParseCPUList("/sys/devices/system/node/online");
+  return nodes.empty() ? 1 : static_cast<G4int>(nodes.size());
+}
+
+std::vector<G4int> VHDNumaUtil::GetNodeCPUs(G4int node)
+{
+  char fname[200];
+  sprintf(fname,"/sys/devices/system/node/node%d/cpulist",node);
+  return ParseCPUList(fname);
+}
+
+void VHDNumaUtil::PrintTopology()
+{
+  G4int nnode = GetNumberOfNodes();
+  G4cout << "=== NUMA: " << nnode << " node(s), pin policy " << sPinPolicy
+	 << ", huge pages " << (sHugePages ? "on" : "off") << " ===" << G4endl;
+  for(G4int n = 0; n < nnode; n++)
+	G4cout << "  node " << n << ": " << GetNodeCPUs(n).size() << " CPUs" << G4endl;
+}
+
+void VHDNumaUtil::PinThisThread(G4int workerID)
+{
+  if(sPinPolicy == "none" || workerID < 0) return;
+#ifdef __linux__
+  G4int nnode = GetNumberOfNodes();
+  G4int node = 0;
+  if(sPinPolicy == "spread")
+	node = workerID % nnode;  //round robin over the sockets
+  else
+  {
+	//compact: fill the CPUs of node 0 first, then node 1, ...
+	G4int first = 0;
+	for(node = 0; node < nnode-1; node++)
+	{
+		G4int ncpu = GetNodeCPUs(node).size();
+		if(workerID < first + ncpu) break;
+		first += ncpu;
+	}
+  }
+  std::vector<G4int> cpus = GetNodeCPUs(node);
+  if(cpus.empty()) return;
+
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  for(size_t i = 0; i < cpus.size(); i++) CPU_SET(cpus[i],&mask);
+  if(sched_setaffinity(0,sizeof(mask),&mask) != 0)
+	G4cout << "** worker " << workerID << ": cannot pin to node " << node << G4endl;
+  else
+	G4cout << "worker " << workerID << " pinned to node " << node << " (" << cpus.size() << " CPUs)" << G4endl;
+#endif
+}
+
+void* VHDNumaUtil::Allocate(size_t bytes)
+{
+  void* ptr = mmap(0,bytes,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+  if(ptr == MAP_FAILED)
+	G4Exception("VHDNumaUtil::Allocate(size_t)","",FatalException,"mmap failed: out of memory!");
+#ifdef MADV_HUGEPAGE
+  if(sHugePages) madvise(ptr,bytes,MADV_HUGEPAGE);
+#endif
+  return ptr;
+}
+
+void VHDNumaUtil::Free(void* ptr, size_t bytes)
+{
+  if(ptr) munmap(ptr,bytes);
+}
+
+void VHDNumaUtil::FirstTouch(void* ptr, size_t bytes)
+{
+  if(!ptr) return;
+  long pageSize = 4096;
+#ifdef __linux__
+  pageSize = sysconf(_SC_PAGESIZE);
+#endif
+  //the pages are zero: writing a zero only commits them
+  volatile char* p = static_cast<volatile char*>(ptr);
+  for(size_t off = 0; off < bytes; off += pageSize) p[off] = 0;
+}
+
+void VHDNumaUtil::PrintPageNodes(const G4String& name, const void* ptr, size_t bytes)
+{
+#if defined(__linux__) && defined(SYS_move_pages)
+  const G4int nsample = 64;
+  long pageSize = sysconf(_SC_PAGESIZE);
+  size_t npage = (bytes + pageSize - 1)/pageSize;
+  G4int n = (npage < (size_t)nsample) ? static_cast<G4int>(npage) : nsample;
+  if(n == 0) return;
+
+  std::vector<void*> pages(n);
+  std::vector<int> status(n,-1);
+  for(G4int i = 0; i < n; i++)
+	pages[i] = (char*)ptr + ((npage*i/n)*pageSize);
+  //nodes == NULL: only query the node of each page
+  if(syscall(SYS_move_pages,0,(unsigned long)n,&pages[0],(const int*)0,&status[0],0) != 0)
+  {
+	G4cout << "  " << name << ": page placement unavailable" << G4endl;
+	return;
+  }
+  G4int nnode = GetNumberOfNodes();
+  std::vector<G4int> count(nnode+1,0);  //last entry: untouched pages
+  for(G4int i = 0; i < n; i++)
+  {
+	if(status[i] >= 0 && status[i] < nnode) count[status[i]]++;
+	else count[nnode]++;
+  }
+  G4cout << "  " << name << " (" << bytes/(1024.*1024.) << " MB) pages:";
+  for(G4int i = 0; i < nnode; i++) G4cout << " node" << i << " " << 100.*count[i]/n << "%";
+  G4cout << ", untouched " << 100.*count[nnode]/n << "%" << G4endl;
+#endif
+}
@@ -0,0 +1,98 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+
+/**
+ * @file   VHDPerfCounter.cc
+ * @brief  last-level cache reference and miss counters of the calling thread (Linux perf events)
+ *
+ * @name   Geant4.9.6-p02
+ */
+
+#include "VHDPerfCounter.hh"
+#include <string.h>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+G4bool VHDPerfCounter::sEnabled = false;
+
+VHDPerfCounter::VHDPerfCounter()
+  : fMissFD(-1), fRefFD(-1)
+{
+#ifdef __linux__
+  fMissFD = Open(PERF_COUNT_HW_CACHE_MISSES);
+  fRefFD = Open(PERF_COUNT_HW_CACHE_REFERENCES);
+#endif
+  if(fMissFD < 0)
+	G4cout << "** cache miss counters not available (see /proc/sys/kernel/perf_event_paranoid)" << G4endl;
+}
+
+VHDPerfCounter::~VHDPerfCounter()
+{
+#ifdef __linux__
+  if(fMissFD >= 0) close(fMissFD);
+  if(fRefFD >= 0) close(fRefFD);
+#endif
+}
+
+//  Counter of the calling thread on any CPU, user space only, counting from now on.
+G4int VHDPerfCounter::Open(G4int config)
+{
+#ifdef __linux__
+  struct perf_event_attr attr;
+  memset(&attr,0,sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return syscall(__NR_perf_event_open,&attr,0,-1,-1,0);
+#else
+  return -1;
+#endif
+}
+
+G4long VHDPerfCounter::Read(G4int fd)
+{
+  if(fd < 0) return 0;
+  long long count = 0;
+#ifdef __linux__
+  if(read(fd,&count,sizeof(count)) != sizeof(count)) return 0;
+#endif
+  return count;
+}
+
+G4long VHDPerfCounter::GetCacheMisses() const
+{
+  return Read(fMissFD);
+}
+
+G4long VHDPerfCounter::GetCacheReferences() const
+{
+  return Read(fRefFD);
+}
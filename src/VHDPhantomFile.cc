@@ -0,0 +1,154 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+/**
+ * @file   VHDPhantomFile.cc
+ * @brief  memory-mapped binary phantom: header, organ tag table and the material index of every voxel
+ *
+ * @name   Geant4.9.6-p02
+ */
+
+#include "VHDPhantomFile.hh"
+#include "VHDPhantomZSliceHeader.hh"
+#include "VHDMaterialIndices.hh"
+#include <fstream>
+#include <vector>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const char* kMagic = "VHDPHAN";
+
+VHDPhantomFile::VHDPhantomFile(const G4String& fname)
+  : fHeader(0), fTags(0), fMateIDs(0), fBase(0), fSize(0)
+{
+  G4String origin = "VHDPhantomFile::VHDPhantomFile(const G4String&)";
+  G4int fd = open(fname.c_str(),O_RDONLY);
+  if(fd < 0)
+	G4Exception(origin,"",FatalErrorInArgument,G4String("Invalid file name: " + fname).c_str());
+  struct stat st;
+  if(fstat(fd,&st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)){
+	close(fd);
+	G4Exception(origin,"",FatalErrorInArgument,G4String("Not a phantom file: " + fname).c_str());
+  }
+  fSize = st.st_size;
+  fBase = mmap(0,fSize,PROT_READ,MAP_SHARED,fd,0);
+  close(fd);  //the mapping stays valid
+  if(fBase == MAP_FAILED)
+	G4Exception(origin,"",FatalException,G4String("mmap failed: " + fname).c_str());
+
+  fHeader = static_cast<const Header*>(fBase);
+  if(strncmp(fHeader->magic,kMagic,8) != 0 || fHeader->version != Version)
+	G4Exception(origin,"",FatalErrorInArgument,G4String("Not a phantom file of this version: " + fname).c_str());
+  if(fHeader->byteOrder != 0x01020304 || !VHDMaterialIndices::IsValidWidth(fHeader->indexBytes))
+	G4Exception(origin,"",FatalErrorInArgument,G4String("Phantom file written on another platform, convert it again: " + fname).c_str());
+  unsigned long long nVoxels = static_cast<unsigned long long>(fHeader->nx)*fHeader->ny*fHeader->nz;
+  if(fHeader->nVoxels != nVoxels || fHeader->dataOffset % PageBytes != 0
+     || fHeader->dataOffset + nVoxels*fHeader->indexBytes > fSize)
+	G4Exception(origin,"",FatalErrorInArgument,G4String("Truncated or corrupt phantom file: " + fname).c_str());
+
+  fTags = reinterpret_cast<const unsigned int*>(static_cast<const char*>(fBase) + sizeof(Header));
+  //mapped read-only: a write through the non-const pointer expected by the parameterisations would fault
+  fMateIDs = static_cast<char*>(fBase) + fHeader->dataOffset;
+#ifdef MADV_RANDOM
+  madvise(fMateIDs,nVoxels*fHeader->indexBytes,MADV_RANDOM);  //navigation reads scattered voxels, no read-ahead
+#endif
+
+  G4cout << "phantom file " << fname << ": " << fHeader->nx << " x " << fHeader->ny << " x " << fHeader->nz
+	 << " voxels mapped (" << fSize/1048576. << " MB, " << fHeader->indexBytes << "-byte material indices)" << G4endl;
+}
+
+VHDPhantomFile::~VHDPhantomFile()
+{
+  if(fBase && fBase != MAP_FAILED) munmap(fBase,fSize);
+}
+
+VHDPhantomZSliceHeader* VHDPhantomFile::CreateSliceHeader() const
+{
+  return new VHDPhantomZSliceHeader(fHeader->nx,fHeader->ny,fHeader->nz,fHeader->minX,fHeader->maxX,
+				    fHeader->minY,fHeader->maxY,fHeader->minZ,fHeader->maxZ);
+}
+
+VHDMaterialIndices* VHDPhantomFile::CreateMaterialIndices() const
+{
+  return new VHDMaterialIndices(fMateIDs,fHeader->nVoxels,fHeader->indexBytes);
+}
+
+G4bool VHDPhantomFile::CheckOrganTags(const std::map<unsigned int,unsigned int>& organtag2MatIndx) const
+{
+  if(fHeader->nTags != organtag2MatIndx.size()) return false;
+  std::map<unsigned int,unsigned int>::const_iterator it;
+  for(unsigned int i = 0; i < fHeader->nTags; i++)
+  {
+	it = organtag2MatIndx.find(fTags[2*i]);
+	if(it == organtag2MatIndx.end() || it->second != fTags[2*i+1]) return false;
+  }
+  return true;
+}
+
+void VHDPhantomFile::Write(const G4String& fname, const VHDPhantomZSliceHeader& header,
+			   const std::map<unsigned int,unsigned int>& organtag2MatIndx, const VHDMaterialIndices& mateIDs)
+{
+  Header h;
+  memset(&h,0,sizeof(h));
+  strncpy(h.magic,kMagic,8);
+  h.version = Version;
+  h.byteOrder = 0x01020304;
+  h.indexBytes = mateIDs.GetBytes();
+  h.nTags = organtag2MatIndx.size();
+  h.nx = header.GetNoVoxelX();
+  h.ny = header.GetNoVoxelY();
+  h.nz = header.GetNoVoxelZ();
+  h.minX = header.GetMinX();
+  h.maxX = header.GetMaxX();
+  h.minY = header.GetMinY();
+  h.maxY = header.GetMaxY();
+  h.minZ = header.GetMinZ();
+  h.maxZ = header.GetMaxZ();
+  h.nVoxels = static_cast<unsigned long long>(h.nx)*h.ny*h.nz;
+  size_t tableBytes = sizeof(Header) + 2*sizeof(unsigned int)*h.nTags;
+  h.dataOffset = (tableBytes + PageBytes - 1)/PageBytes*PageBytes;
+
+  std::vector<unsigned int> tags;
+  std::map<unsigned int,unsigned int>::const_iterator it;
+  for(it = organtag2MatIndx.begin(); it != organtag2MatIndx.end(); it++){
+	tags.push_back(it->first);
+	tags.push_back(it->second);
+  }
+  std::vector<char> pad(h.dataOffset - tableBytes,0);
+
+  std::ofstream fout(fname.c_str(),std::ios_base::out | std::ios_base::binary);
+  if(!fout.is_open())
+	G4Exception("VHDPhantomFile::Write()","",FatalErrorInArgument,G4String("Cannot write: " + fname).c_str());
+  fout.write(reinterpret_cast<const char*>(&h),sizeof(h));
+  if(!tags.empty()) fout.write(reinterpret_cast<const char*>(&tags[0]),tags.size()*sizeof(unsigned int));
+  if(!pad.empty()) fout.write(&pad[0],pad.size());
+  fout.write(static_cast<const char*>(mateIDs.GetData()),h.nVoxels*h.indexBytes);
+  fout.close();
+  if(!fout.good())
+	G4Exception("VHDPhantomFile::Write()","",FatalException,G4String("Error writing: " + fname).c_str());
+  G4cout << "phantom written to " << fname << ": " << h.nx << " x " << h.ny << " x " << h.nz << " voxels" << G4endl;
+}
@@ -38,6 +38,7 @@
 #include "G4Material.hh"
 #include "G4GeometryTolerance.hh"
 #include "VHDPhantomZSliceHeader.hh"
+#include <algorithm>
 
 //-------------------------------------------------------------
 VHDPhantomZSliceHeader::VHDPhantomZSliceHeader( const VHDPhantomZSliceHeader& rhs )
@@ -55,6 +56,14 @@ VHDPhantomZSliceHeader::VHDPhantomZSliceHeader( const VHDPhantomZSliceHeader& rh
 
 }
 
+//-------------------------------------------------------------
+VHDPhantomZSliceHeader::VHDPhantomZSliceHeader( G4int nx, G4int ny, G4int nz, G4double minX, G4double maxX,
+						G4double minY, G4double maxY, G4double minZ, G4double maxZ )
+  : fNoVoxelX(nx), fNoVoxelY(ny), fNoVoxelZ(nz), fMinX(minX), fMinY(minY), fMinZ(minZ),
+    fMaxX(maxX), fMaxY(maxY), fMaxZ(maxZ)
+{
+}
+
 //-------------------------------------------------------------
 VHDPhantomZSliceHeader::VHDPhantomZSliceHeader( std::ifstream& fin )
 {
@@ -75,11 +84,7 @@ VHDPhantomZSliceHeader::VHDPhantomZSliceHeader( std::ifstream& fin )
 //     G4cout << " VHDPhantomZSliceHeader reading material " << im << " : " << mateindex << "  " << matename << G4endl;
 // #endif
 
-    if( ! CheckMaterialExists( matename ) ) {  //check if the material specified in .g4dcm file is part of the material defined in detectorconstruction.cc
-      G4cerr << "A material is found in file that is not built in the C++ code! " << G4endl;
-      G4Exception("VHDPhantomZSliceHeader::VHDPhantomZSliceHeader( std::ifstream& fin )","",FatalErrorInArgument,"");
-    }
-    fMaterialNames.push_back(matename);
+    fMaterialNames.push_back(matename);  //checked against the organ names by the detector (CheckMaterialNames)
   }
 
   //----- Read number of voxels
@@ -101,20 +106,30 @@ VHDPhantomZSliceHeader::VHDPhantomZSliceHeader( std::ifstream& fin )
 }
 
 //-------------------------------------------------------------
-G4bool VHDPhantomZSliceHeader::CheckMaterialExists( const G4String& mateName )
+void VHDPhantomZSliceHeader::Write( std::ostream& fout ) const
 {
-  G4bool bFound = FALSE;
-
-  const G4MaterialTable* matTab = G4Material::GetMaterialTable();
-  std::vector<G4Material*>::const_iterator matite;
-  for( matite = matTab->begin(); matite != matTab->end(); matite++ ) {
-    if( (*matite)->GetName() == mateName ) {
-      bFound = TRUE;
-      break;
-    }
+  std::streamsize prec = fout.precision(17);  //the extents of the slices are compared when merged
+  fout << fMaterialNames.size() << G4endl;
+  for( unsigned int im = 0; im < fMaterialNames.size(); im++ ){
+    fout << im << " " << fMaterialNames[im] << G4endl;
   }
+  fout << fNoVoxelX << " " << fNoVoxelY << " " << fNoVoxelZ << G4endl;
+  fout << fMinX << " " << fMaxX << G4endl;
+  fout << fMinY << " " << fMaxY << G4endl;
+  fout << fMinZ << " " << fMaxZ << G4endl;
+  fout.precision(prec);
+}
 
-  return bFound;
+//-------------------------------------------------------------
+G4bool VHDPhantomZSliceHeader::CheckMaterialNames( const std::vector<G4String>& known ) const
+{
+  for( unsigned int im = 0; im < fMaterialNames.size(); im++ ){
+    if( std::find( known.begin(), known.end(), fMaterialNames[im] ) == known.end() ) {
+      G4cerr << "A material is found in file that is not defined in the material files: " << fMaterialNames[im] << G4endl;
+      return FALSE;
+    }
+  }
+  return TRUE;
 }
 
 
@@ -126,6 +141,45 @@ void VHDPhantomZSliceHeader::operator+=( const VHDPhantomZSliceHeader& rhs )
 
 //-------------------------------------------------------------
 VHDPhantomZSliceHeader VHDPhantomZSliceHeader::operator+( const VHDPhantomZSliceHeader& rhs )
+{
+  CheckSameGrid( rhs );
+  CheckContiguous( rhs );
+
+  //----- Build slice header copying first one
+  VHDPhantomZSliceHeader temp( *this );
+
+  //----- Add data from second slice header
+  temp.SetMinZ( std::min( fMinZ, rhs.GetMinZ() ) );
+  temp.SetMaxZ( std::max( fMaxZ, rhs.GetMaxZ() ) );
+  temp.SetNoVoxelZ( fNoVoxelZ + rhs.GetNoVoxelZ() );
+
+  return temp;
+}
+
+//-------------------------------------------------------------
+VHDPhantomZSliceHeader* VHDPhantomZSliceHeader::Merge( const std::vector<VHDPhantomZSliceHeader*>& slices )
+{
+  //----- One pass: every slice against the first one (grid) and against the previous one (contiguity)
+  const VHDPhantomZSliceHeader* first = slices[0];
+  G4double minZ = first->GetMinZ(), maxZ = first->GetMaxZ();
+  G4int nz = first->GetNoVoxelZ();
+  for( unsigned int ii = 1; ii < slices.size(); ii++ ) {
+    first->CheckSameGrid( *slices[ii] );
+    slices[ii-1]->CheckContiguous( *slices[ii] );
+    minZ = std::min( minZ, slices[ii]->GetMinZ() );
+    maxZ = std::max( maxZ, slices[ii]->GetMaxZ() );
+    nz += slices[ii]->GetNoVoxelZ();
+  }
+
+  VHDPhantomZSliceHeader* merged = new VHDPhantomZSliceHeader( *first );
+  merged->SetMinZ( minZ );
+  merged->SetMaxZ( maxZ );
+  merged->SetNoVoxelZ( nz );
+  return merged;
+}
+
+//-------------------------------------------------------------
+void VHDPhantomZSliceHeader::CheckSameGrid( const VHDPhantomZSliceHeader& rhs ) const
 {
   //----- Check that both slices has the same dimensions
   if( fNoVoxelX != rhs.GetNoVoxelX() || fNoVoxelY != rhs.GetNoVoxelY() ) {
@@ -134,7 +188,7 @@ VHDPhantomZSliceHeader VHDPhantomZSliceHeader::operator+( const VHDPhantomZSlice
 	   << "  Y=  " << fNoVoxelY << " =? " << rhs.GetNoVoxelY()  
 	   << "  Z=  " << fNoVoxelZ << " =? " << rhs.GetNoVoxelZ() 
 	   << G4endl;
-    G4Exception("VHDPhantomZSliceHeader::operator+=( const VHDPhantomZSliceHeader& rhs )","",FatalErrorInArgument,"");
+    G4Exception("VHDPhantomZSliceHeader::CheckSameGrid( const VHDPhantomZSliceHeader& rhs )","",FatalErrorInArgument,"");
   }
   //----- Check that both slices has the same extensions
   if( fMinX != rhs.GetMinX() || fMaxX != rhs.GetMaxX() || fMinY != rhs.GetMinY() || fMaxY != rhs.GetMaxY() ) {
@@ -144,22 +198,26 @@ VHDPhantomZSliceHeader VHDPhantomZSliceHeader::operator+( const VHDPhantomZSlice
 	   << "  Ymin= " << fMinY << " =? " << rhs.GetMinY() 
 	   << "  Ymax= " << fMaxY << " =? " << rhs.GetMaxY() 
 	   << G4endl;
-    G4Exception("VHDPhantomZSliceHeader::operator+=( const VHDPhantomZSliceHeader& rhs )","",FatalErrorInArgument,"");
+    G4Exception("VHDPhantomZSliceHeader::CheckSameGrid( const VHDPhantomZSliceHeader& rhs )","",FatalErrorInArgument,"");
   }
   
   //----- Check that both slices has the same materials
-  std::vector<G4String> fMaterialNames2 = rhs.GetMaterialNames();
+  const std::vector<G4String>& fMaterialNames2 = rhs.GetMaterialNames();
   if( fMaterialNames.size() != fMaterialNames2.size() ) {
     G4cerr << "Eror adding two slice headers: !!! Different number of materials: " << fMaterialNames.size() << " =? " << fMaterialNames2.size() << G4endl;
-    G4Exception("VHDPhantomZSliceHeader::operator+=( const VHDPhantomZSliceHeader& rhs )","",FatalErrorInArgument,"");
+    G4Exception("VHDPhantomZSliceHeader::CheckSameGrid( const VHDPhantomZSliceHeader& rhs )","",FatalErrorInArgument,"");
   }
   for( unsigned int ii = 0; ii < fMaterialNames.size(); ii++ ) {
     if( fMaterialNames[ii] != fMaterialNames2[ii] ) {
       G4cerr << "Error adding two slice headers: !!! Different material number " << ii << " : " << fMaterialNames[ii] << " =? " << fMaterialNames2[ii] << G4endl;
-      G4Exception("VHDPhantomZSliceHeader::operator+=( const VHDPhantomZSliceHeader& rhs )","",FatalErrorInArgument,"");
+      G4Exception("VHDPhantomZSliceHeader::CheckSameGrid( const VHDPhantomZSliceHeader& rhs )","",FatalErrorInArgument,"");
     }
   }
-   
+}
+
+//-------------------------------------------------------------
+void VHDPhantomZSliceHeader::CheckContiguous( const VHDPhantomZSliceHeader& rhs ) const
+{
   //----- Check that the slices are contiguous in Z
   if( std::fabs( fMinZ - rhs.GetMaxZ() ) > G4GeometryTolerance::GetInstance()->GetRadialTolerance() && 
       std::fabs( fMaxZ - rhs.GetMinZ() ) > G4GeometryTolerance::GetInstance()->GetRadialTolerance() ){
@@ -167,16 +225,6 @@ VHDPhantomZSliceHeader VHDPhantomZSliceHeader::operator+( const VHDPhantomZSlice
 	   << "  Zmin= " << fMinZ << " & " << rhs.GetMinZ() 
 	   << "  Zmax= " << fMaxZ << " & " << rhs.GetMaxZ() 
 	   << G4endl;
-    G4Exception("VHDPhantomZSliceHeader::operator+=( const VHDPhantomZSliceHeader& rhs )","",FatalErrorInArgument,"");
+    G4Exception("VHDPhantomZSliceHeader::CheckContiguous( const VHDPhantomZSliceHeader& rhs )","",FatalErrorInArgument,"");
   }
-
-  //----- Build slice header copying first one
-  VHDPhantomZSliceHeader temp( *this );
-
-  //----- Add data from second slice header
-  temp.SetMinZ( std::min( fMinZ, rhs.GetMinZ() ) );
-  temp.SetMaxZ( std::max( fMaxZ, rhs.GetMaxZ() ) );
-  temp.SetNoVoxelZ( fNoVoxelZ + rhs.GetNoVoxelZ() );
-
-  return temp;
 }
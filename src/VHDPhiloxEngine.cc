@@ -0,0 +1,203 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+/**
+ * @file   VHDPhiloxEngine.cc
+ * @brief  counter-based (Philox4x32-10) random engine keyed by the run seed and the event ID
+ *
+ * @name   Geant4.9.6-p02
+ */
+
+#include "VHDPhiloxEngine.hh"
+#include "Randomize.hh"
+#include <fstream>
+
+uint32_t VHDPhiloxEngine::sRunKey[2] = {0,0};
+G4long VHDPhiloxEngine::sEventOffset = 0;
+
+namespace {
+  const uint32_t PhiloxM0 = 0xD2511F53;
+  const uint32_t PhiloxM1 = 0xCD9E8D57;
+  const uint32_t PhiloxW0 = 0x9E3779B9;  //golden ratio
+  const uint32_t PhiloxW1 = 0xBB67AE85;  //sqrt(3)-1
+  const double TwoToMinus53 = 1.0/9007199254740992.0;
+
+  inline void PhiloxRound(uint32_t* ctr, const uint32_t* key)
+  {
+    uint64_t p0 = (uint64_t)PhiloxM0*ctr[0];
+    uint64_t p1 = (uint64_t)PhiloxM1*ctr[2];
+    uint32_t c0 = (uint32_t)(p1 >> 32) ^ ctr[1] ^ key[0];
+    uint32_t c2 = (uint32_t)(p0 >> 32) ^ ctr[3] ^ key[1];
+    ctr[1] = (uint32_t)p1;
+    ctr[3] = (uint32_t)p0;
+    ctr[0] = c0;
+    ctr[2] = c2;
+  }
+
+  //53 random bits ==> double in the open interval (0,1)
+  inline double ToDouble(uint32_t hi, uint32_t lo)
+  {
+    uint64_t u = (((uint64_t)hi << 32) | lo) >> 11;
+    return ((double)u + 0.5)*TwoToMinus53;
+  }
+}
+
+VHDPhiloxEngine::VHDPhiloxEngine()
+{
+  setSeed(0);
+}
+
+VHDPhiloxEngine::VHDPhiloxEngine(long seed)
+{
+  setSeed(seed);
+}
+
+VHDPhiloxEngine::~VHDPhiloxEngine()
+{;
+}
+
+void VHDPhiloxEngine::NextBlock()
+{
+  uint32_t ctr[4] = {fCtr[0],fCtr[1],fCtr[2],fCtr[3]};
+  uint32_t key[2] = {fKey[0],fKey[1]};
+  PhiloxRound(ctr,key);
+  for(G4int r = 1; r < 10; r++)
+  {
+	key[0] += PhiloxW0;
+	key[1] += PhiloxW1;
+	PhiloxRound(ctr,key);
+  }
+  fBuffer[0] = ToDouble(ctr[0],ctr[1]);
+  fBuffer[1] = ToDouble(ctr[2],ctr[3]);
+  fNext = 0;
+
+  if(++fCtr[0] == 0) ++fCtr[1];
+}
+
+double VHDPhiloxEngine::flat()
+{
+  if(fNext > 1) NextBlock();
+  return fBuffer[fNext++];
+}
+
+void VHDPhiloxEngine::flatArray(const int size, double* vect)
+{
+  for(G4int i = 0; i < size; i++) vect[i] = flat();
+}
+
+void VHDPhiloxEngine::SetStream(G4long stream)
+{
+  uint64_t s = (uint64_t)stream;
+  fCtr[0] = 0;
+  fCtr[1] = 0;
+  fCtr[2] = (uint32_t)s;
+  fCtr[3] = (uint32_t)(s >> 32);
+  fNext = 2;
+}
+
+void VHDPhiloxEngine::setSeed(long seed, int)
+{
+  theSeed = seed;
+  uint64_t s = (uint64_t)seed;
+  fKey[0] = (uint32_t)s;
+  fKey[1] = (uint32_t)(s >> 32);
+  SetStream(0);
+}
+
+//CLHEP convention: zero-terminated array of seeds; the first two make the key
+void VHDPhiloxEngine::setSeeds(const long* seeds, int)
+{
+  theSeeds = seeds;
+  theSeed = seeds[0];
+  fKey[0] = (uint32_t)seeds[0];
+  fKey[1] = (seeds[0] != 0) ? (uint32_t)seeds[1] : 0;
+  SetStream(0);
+}
+
+void VHDPhiloxEngine::saveStatus(const char filename[]) const
+{
+  std::ofstream fout(filename,std::ios::out);
+  if(!fout.good())
+  {
+	G4cout << "cannot open file " << filename << G4endl;
+	return;
+  }
+  fout << name() << G4endl;
+  fout << fKey[0] << " " << fKey[1] << G4endl;
+  fout << fCtr[0] << " " << fCtr[1] << " " << fCtr[2] << " " << fCtr[3] << " " << fNext << G4endl;
+  fout.close();
+}
+
+void VHDPhiloxEngine::restoreStatus(const char filename[])
+{
+  std::ifstream fin(filename,std::ios::in);
+  std::string ename;
+  fin >> ename;
+  if(!fin.good() || ename != name())
+  {
+	G4Exception("VHDPhiloxEngine::restoreStatus(const char[])","",JustWarning,G4String("no VHDPhiloxEngine status in " + G4String(filename)).c_str());
+	return;
+  }
+  G4int next;
+  fin >> fKey[0] >> fKey[1] >> fCtr[0] >> fCtr[1] >> fCtr[2] >> fCtr[3] >> next;
+  fin.close();
+
+  //regenerate the buffered block
+  if(next < 2)
+  {
+	if(fCtr[0]-- == 0) fCtr[1]--;
+	NextBlock();
+  }
+  fNext = next;
+}
+
+void VHDPhiloxEngine::showStatus() const
+{
+  G4cout << "--------- VHDPhiloxEngine status ---------" << G4endl;
+  G4cout << " key    = " << fKey[0] << " " << fKey[1] << G4endl;
+  G4cout << " stream = " << (((uint64_t)fCtr[3] << 32) | fCtr[2])
+	 << ", block = " << (((uint64_t)fCtr[1] << 32) | fCtr[0]) << G4endl;
+  G4cout << "------------------------------------------" << G4endl;
+}
+
+void VHDPhiloxEngine::SetRunSeed(G4long seed)
+{
+  uint64_t s = (uint64_t)seed;
+  sRunKey[0] = (uint32_t)s;
+  sRunKey[1] = (uint32_t)(s >> 32);
+}
+
+G4bool VHDPhiloxEngine::IsActive()
+{
+  return (dynamic_cast<VHDPhiloxEngine*>(CLHEP::HepRandom::getTheEngine()) != 0);
+}
+
+void VHDPhiloxEngine::SetEventStream(G4int eventID)
+{
+  VHDPhiloxEngine* engine = dynamic_cast<VHDPhiloxEngine*>(CLHEP::HepRandom::getTheEngine());
+  if(!engine) return;
+  engine->fKey[0] = sRunKey[0];
+  engine->fKey[1] = sRunKey[1];
+  engine->SetStream(sEventOffset + eventID);
+}
@@ -41,6 +41,24 @@
 #include "G4EmLivermorePhysics.hh"
 #include "G4EmPenelopePhysics.hh"
 #include "VHDPhysicsListMessenger.hh"
+#include "G4ProductionCutsTable.hh"
+#include "G4Threading.hh"
+#include "G4Timer.hh"
+#include <fstream>
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+//resident memory of the process in MB (0 where /proc/self/statm is not available)
+static G4double ResidentMemory()
+{
+#ifdef __linux__
+  std::ifstream fin("/proc/self/statm");
+  long size = 0, resident = 0;
+  if(fin >> size >> resident) return resident*(sysconf(_SC_PAGESIZE)/1048576.);
+#endif
+  return 0.;
+}
 
 VHDPhysicsList::VHDPhysicsList():  G4VModularPhysicsList()
 {
@@ -77,6 +95,25 @@ void VHDPhysicsList::SetCuts()
   G4cout << "current set cut value: " << defaultCutValue/mm << " mm" << G4endl;
 }
 
+void VHDPhysicsList::BuildPhysicsTable()
+{
+  //the workers share the tables of the master: only the master build is reported
+  if(!G4Threading::IsMasterThread()){
+	G4VModularPhysicsList::BuildPhysicsTable();
+	return;
+  }
+  G4double before = ResidentMemory();
+  G4Timer timer;
+  timer.Start();
+  G4VModularPhysicsList::BuildPhysicsTable();
+  timer.Stop();
+  G4double after = ResidentMemory();
+  //one set of tables per material-cuts couple, i.e. per G4Material of the phantom (see
+  //VHDDetectorConstruction::BuildReferencedMaterials)
+  G4cout << "physics tables: " << G4ProductionCutsTable::GetProductionCutsTable()->GetTableSize() << " material-cuts couples built in "
+	 << timer.GetRealElapsed() << " s, resident memory " << before << " MB ==> " << after << " MB (+" << after - before << " MB)" << G4endl;
+}
+
 void VHDPhysicsList::AddPhysicsList(const G4String& name)
 {
 
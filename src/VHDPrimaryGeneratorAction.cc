@@ -34,6 +34,7 @@
 
 
 #include "VHDPrimaryGeneratorAction.hh"
+#include "VHDPhiloxEngine.hh"
 #include "G4ParticleTable.hh"
 #include "G4ParticleDefinition.hh"
 #include "Randomize.hh"
@@ -63,9 +64,33 @@ VHDPrimaryGeneratorAction::VHDPrimaryGeneratorAction(const G4String& dname, cons
 	SetSourceProbMapSparse(dname);
    else
    	SetSourceProbMap(dname);
+   fProbAccum = &theProbAccum;
    G4cout << "in VHDPrimaryGeneratorAction: dname = " << dname << G4endl;   
 }
 
+VHDPrimaryGeneratorAction::VHDPrimaryGeneratorAction(const VHDPrimaryGeneratorAction* master)
+{
+   pgun = new G4ParticleGun(); 
+   MinTheta = master->MinTheta;
+   MaxTheta = master->MaxTheta;
+   MinPhi = master->MinPhi;
+   MaxPhi = master->MaxPhi;
+
+   //the cumulative probability map is only read from here on, so the workers share the master's copy
+   fProbAccum = master->fProbAccum;
+   theProbSum = master->theProbSum;
+   NVoxelX = master->NVoxelX;
+   NVoxelY = master->NVoxelY;
+   NVoxelZ = master->NVoxelZ;
+   NVoxelXY = master->NVoxelXY;
+   dX = master->dX;
+   dY = master->dY;
+   dZ = master->dZ;
+   offsetX = master->offsetX;
+   offsetY = master->offsetY;
+   offsetZ = master->offsetZ;
+}
+
 
 VHDPrimaryGeneratorAction::~VHDPrimaryGeneratorAction()
 {
@@ -79,6 +104,8 @@ VHDPrimaryGeneratorAction::~VHDPrimaryGeneratorAction()
 //
 void VHDPrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent)
 { 
+  //counter-based engine: the random numbers of this event only depend on the run seed and the event ID
+  VHDPhiloxEngine::SetEventStream(anEvent->GetEventID());
   
   position = GeneratePosition();
   momentum = GenerateIsotropicMomentum();
@@ -207,7 +234,7 @@ G4ThreeVector VHDPrimaryGeneratorAction::GeneratePosition()
   
   // Sample the position observing from a given probability distributiion using Rejection Sampling method
   G4double rnd = CLHEP::RandFlat::shoot();
-  std::map<G4double,G4int>::iterator ite = theProbAccum.upper_bound(rnd);  //upper_bound: return the iterator pointing to the first element that is GREATER than rnd
+  std::map<G4double,G4int>::const_iterator ite = fProbAccum->upper_bound(rnd);  //upper_bound: return the iterator pointing to the first element that is GREATER than rnd
 
   G4int nVox = (*ite).second;
   G4int nx = nVox%NVoxelX;
@@ -0,0 +1,101 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+/**
+ * @file   VHDRandomMessenger.cc
+ * @brief  define the messenger for the random engine and the seed of the runs
+ *
+ * @name   Geant4.9.6-p02
+ */
+
+#include "VHDRandomMessenger.hh"
+#include "VHDMultiSDRunAction.hh"
+#include "VHDPhiloxEngine.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithAnInteger.hh"
+#include "Randomize.hh"
+#include <stdlib.h>
+
+
+VHDRandomMessenger::VHDRandomMessenger(VHDMultiSDRunAction* pRun)
+:pRunAction(pRun)
+{
+  randomDir = new G4UIdirectory("/VHDMSDv1/random/");
+  randomDir->SetGuidance("random engine commands");
+
+  engineCmd = new G4UIcmdWithAString("/VHDMSDv1/random/engine",this);
+  engineCmd->SetGuidance("Select the random engine: ranecu (default) or philox.");
+  engineCmd->SetGuidance("philox: counter-based engine keyed by the run seed and the event ID.");
+  engineCmd->SetParameterName("engine",false);
+  engineCmd->SetCandidates("ranecu philox");
+  engineCmd->AvailableForStates(G4State_PreInit);
+  engineCmd->SetToBeBroadcasted(false);
+
+  seedCmd = new G4UIcmdWithAString("/VHDMSDv1/random/seed",this);
+  seedCmd->SetGuidance("Seed of the next runs; 0 (default) draws a new seed from the clock and the process ID for every run.");
+  seedCmd->SetParameterName("seed",false);
+  seedCmd->AvailableForStates(G4State_PreInit,G4State_Idle);
+  seedCmd->SetToBeBroadcasted(false);
+
+  firstEventCmd = new G4UIcmdWithAnInteger("/VHDMSDv1/random/firstEvent",this);
+  firstEventCmd->SetGuidance("philox engine: event i of the next runs uses the random stream firstEvent + i.");
+  firstEventCmd->SetGuidance("e.g. /VHDMSDv1/random/seed S, /VHDMSDv1/random/firstEvent K, /run/beamOn 1 regenerates event K of a run with seed S.");
+  firstEventCmd->SetParameterName("first",false);
+  firstEventCmd->SetRange("first>=0");
+  firstEventCmd->AvailableForStates(G4State_PreInit,G4State_Idle);
+  firstEventCmd->SetToBeBroadcasted(false);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+VHDRandomMessenger::~VHDRandomMessenger()
+{
+  delete engineCmd;
+  delete seedCmd;
+  delete firstEventCmd;
+  delete randomDir;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void VHDRandomMessenger::SetNewValue(G4UIcommand* command, G4String newValue)
+{
+  if( command == engineCmd )
+  {
+	G4cout << "random engine: " << newValue << G4endl;
+	if(newValue == "philox")
+		CLHEP::HepRandom::setTheEngine(new VHDPhiloxEngine);
+	else
+		CLHEP::HepRandom::setTheEngine(new CLHEP::RanecuEngine);
+  }
+
+  if( command == seedCmd )
+	pRunAction->SetSeed(atol(newValue.c_str()));
+
+  if( command == firstEventCmd )
+	VHDPhiloxEngine::SetEventOffset(firstEventCmd->GetNewIntValue(newValue));
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,137 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+
+/**
+ * @file   VHDRoiTally.cc
+ * @brief  fluence tally stored over the ROI voxels only (compact index of the voxel table)
+ *
+ * @name   Geant4.9.6-p02
+ */
+
+#include "VHDRoiTally.hh"
+
+G4bool VHDRoiTally::sEnabled = false;
+
+VHDRoiTally::VHDRoiTally(const G4String& name, VHDVTally* data, const VHDVoxelTable* table, G4int nBins)
+  : VHDVTally(name), fData(data), fTable(table), fNBins(nBins > 0 ? nBins : 1)
+{
+  fNVoxels = fTable->GetNumberOfVoxels();
+}
+
+VHDRoiTally::~VHDRoiTally()
+{
+  delete fData;
+}
+
+void VHDRoiTally::Add(G4long copyNo, G4double val)
+{
+  G4long c = ToRoi(copyNo);
+  if(c >= 0) fData->Add(c,val);
+}
+
+void VHDRoiTally::Add(const VHDEventBuffer& evtBuf)
+{
+  G4int n = evtBuf.GetNumberOfEntries();
+  for(G4int i = 0; i < n; i++) Add(evtBuf.GetCopyNo(i),evtBuf.GetValue(i));
+}
+
+G4double VHDRoiTally::Get(G4long copyNo) const
+{
+  G4long c = ToRoi(copyNo);
+  return c < 0 ? 0. : fData->Get(c);
+}
+
+//  ROI to voxel copy numbers; the ROI is numbered in increasing copy number, so the order is kept.
+void VHDRoiTally::ToVoxel(std::vector<G4long>& copyNo) const
+{
+  for(size_t i = 0; i < copyNo.size(); i++)
+  {
+	G4long roi = copyNo[i]/fNBins;
+	copyNo[i] = static_cast<G4long>(fTable->GetRoiVoxel(static_cast<G4int>(roi)))*fNBins + (copyNo[i] - roi*fNBins);
+  }
+}
+
+void VHDRoiTally::Merge(const VHDVTally& other)
+{
+  if(&other == this) return;
+  const VHDRoiTally* roi = dynamic_cast<const VHDRoiTally*>(&other);
+  if(roi){
+	fData->Merge(*(roi->fData));
+	return;
+  }
+  std::vector<G4long> copyNo;
+  std::vector<G4double> val;
+  other.GetEntries(copyNo,val);
+  for(size_t i = 0; i < copyNo.size(); i++) Add(copyNo[i],val[i]);
+}
+
+void VHDRoiTally::GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& val) const
+{
+  fData->GetEntries(copyNo,val);
+  ToVoxel(copyNo);
+}
+
+void VHDRoiTally::GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& sum, std::vector<G4double>& comp) const
+{
+  fData->GetEntries(copyNo,sum,comp);
+  ToVoxel(copyNo);
+}
+
+void VHDRoiTally::SetEntries(const std::vector<G4long>& copyNo, const std::vector<G4double>& sum, const std::vector<G4double>& comp)
+{
+  std::vector<G4long> c;
+  std::vector<G4double> s, k;
+  for(size_t i = 0; i < copyNo.size(); i++)
+  {
+	G4long roi = ToRoi(copyNo[i]);
+	if(roi < 0) continue;
+	c.push_back(roi);
+	s.push_back(sum[i]);
+	k.push_back(comp[i]);
+  }
+  fData->SetEntries(c,s,k);
+}
+
+void VHDRoiTally::Reset()
+{
+  fData->Reset();
+}
+
+void VHDRoiTally::Report() const
+{
+  fData->Report();
+}
+
+void VHDRoiTally::FirstTouch()
+{
+  fData->FirstTouch();
+}
+
+void VHDRoiTally::Describe() const
+{
+  G4cout << "++ " << fName << ": ROI tally of " << fTable->GetNumberOfRoiVoxels() << " of " << fNVoxels
+	 << " voxels (" << 100.*fTable->GetNumberOfRoiVoxels()/fNVoxels << " %)" << G4endl;
+  fData->Describe();
+}
@@ -0,0 +1,93 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+/**
+ * @file   VHDRunLengthLabels.cc
+ * @brief  material indices of the phantom stored as runs, expanded in parallel or looked up by row
+ *
+ * @name   Geant4.9.6-p02
+ */
+
+#include "VHDRunLengthLabels.hh"
+#include "VHDMaterialIndices.hh"
+#ifdef G4MULTITHREADED
+#include <thread>
+#endif
+
+void VHDRunLengthLabels::AddRun(unsigned int index, G4int length)
+{
+  if(length <= 0) return;
+  if(fIndex.empty() || fIndex.back() != index){
+	fStart.push_back(fNVoxels);
+	fIndex.push_back(index);
+  }
+  fNVoxels += length;
+}
+
+void VHDRunLengthLabels::Finish(G4int nx)
+{
+  fNx = nx;
+  fStart.push_back(fNVoxels);  //end of the last run
+  G4int nRows = fNVoxels/fNx;
+  fRowRun.resize(nRows + 1);
+  G4int r = 0;
+  for(G4int row = 0; row < nRows; row++)
+  {
+	G4int copyNo = row*fNx;
+	while(fStart[r+1] <= copyNo) r++;
+	fRowRun[row] = r;
+  }
+  fRowRun[nRows] = fIndex.size() - 1;
+}
+
+//  One contiguous chunk of runs per thread: the chunks write disjoint ranges of voxels.
+void VHDRunLengthLabels::Expand(VHDMaterialIndices* mateIDs, G4int nThreads) const
+{
+  G4int nRuns = fIndex.size();
+#ifdef G4MULTITHREADED
+  if(nThreads <= 0) nThreads = std::thread::hardware_concurrency();
+  if(nThreads > nRuns) nThreads = nRuns;
+  if(nThreads > 1){
+	std::vector<std::thread> pool;
+	for(G4int t = 0; t < nThreads; t++)
+		pool.push_back(std::thread(&VHDRunLengthLabels::ExpandRuns,this,
+					   static_cast<G4int>(static_cast<G4long>(nRuns)*t/nThreads),
+					   static_cast<G4int>(static_cast<G4long>(nRuns)*(t+1)/nThreads),mateIDs));
+	for(size_t t = 0; t < pool.size(); t++) pool[t].join();
+	return;
+  }
+#endif
+  ExpandRuns(0,nRuns,mateIDs);  //sequential build: no threads
+}
+
+void VHDRunLengthLabels::ExpandRuns(G4int first, G4int last, VHDMaterialIndices* mateIDs) const
+{
+  for(G4int r = first; r < last; r++)
+	mateIDs->Fill(fStart[r],fStart[r+1],fIndex[r]);
+}
+
+G4double VHDRunLengthLabels::GetMemory() const
+{
+  return fStart.size()*sizeof(G4int) + fIndex.size()*sizeof(unsigned int) + fRowRun.size()*sizeof(G4int);
+}
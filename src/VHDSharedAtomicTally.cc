@@ -0,0 +1,193 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+/**
+ * @file   VHDSharedAtomicTally.cc
+ * @brief  dense tally shared by all the worker threads, updated with atomic adds
+ *
+ * @name   Geant4.10.x (G4MULTITHREADED)
+ */
+
+#ifdef G4MULTITHREADED
+
+#include "VHDSharedAtomicTally.hh"
+#include "VHDNumaUtil.hh"
+#include "G4MTRunManager.hh"
+#include <algorithm>
+
+template <class T>
+VHDSharedAtomicTally<T>::VHDSharedAtomicTally(const G4String& name, G4long nVoxels, const VHDVoxelLayout* layout)
+  : VHDVTally(name), fSize(nVoxels), fLayout(layout ? *layout : VHDVoxelLayout(nVoxels))
+{
+  //zero pages from mmap, not touched here: each page lands on the node of the first worker adding into it.
+  //(std::atomic<T> of a lock-free T is trivially constructible with the representation of T)
+  fData = static_cast<std::atomic<T>*>(VHDNumaUtil::Allocate(fLayout.GetStorageSize()*sizeof(std::atomic<T>)));
+  fNBlock = static_cast<G4int>((fSize + BlockSize - 1)/BlockSize);
+  fBlockRetry = new std::atomic<unsigned long>[fNBlock];
+  for(G4int i = 0; i < fNBlock; i++) fBlockRetry[i].store(0,std::memory_order_relaxed);
+  fNCounter = G4MTRunManager::GetMasterRunManager()->GetNumberOfThreads() + 1;
+  fCounter = new Counter[fNCounter];
+  for(G4int i = 0; i < fNCounter; i++) fCounter[i].nadd = fCounter[i].nretry = 0;
+}
+
+template <class T>
+VHDSharedAtomicTally<T>::~VHDSharedAtomicTally()
+{
+  VHDNumaUtil::Free(fData,fLayout.GetStorageSize()*sizeof(std::atomic<T>));
+  delete [] fBlockRetry;
+  delete [] fCounter;
+}
+
+template <class T>
+G4int VHDSharedAtomicTally<T>::AtomicAdd(G4long copyNo, T val)
+{
+  if(copyNo < 0 || copyNo >= fSize)
+	G4Exception("VHDSharedAtomicTally::Add(G4long,G4double)","",FatalException,"copy number out of the tally range!");
+  std::atomic<T>& slot = fData[fLayout.ToStorage(copyNo)];
+  T old = slot.load(std::memory_order_relaxed);
+  G4int nretry = 0;
+  //on failure old is reloaded with the current value
+  while(!slot.compare_exchange_weak(old,old+val,std::memory_order_relaxed)) nretry++;
+  if(nretry > 0) fBlockRetry[copyNo/BlockSize].fetch_add(nretry,std::memory_order_relaxed);
+  return nretry;
+}
+
+template <class T>
+void VHDSharedAtomicTally<T>::Add(G4long copyNo, G4double val)
+{
+  Count(1,AtomicAdd(copyNo,static_cast<T>(val)));
+}
+
+template <class T>
+void VHDSharedAtomicTally<T>::Add(const G4THitsMap<G4double>& evtMap)
+{
+  unsigned long nadd = 0, nretry = 0;
+  std::map<G4int,G4double*>::iterator itr = evtMap.GetMap()->begin();
+  for(; itr != evtMap.GetMap()->end(); itr++, nadd++)
+	nretry += AtomicAdd(itr->first,static_cast<T>(*(itr->second)));
+  Count(nadd,nretry);
+}
+
+template <class T>
+void VHDSharedAtomicTally<T>::Add(const VHDEventBuffer& evtBuf)
+{
+  unsigned long nadd = evtBuf.GetNumberOfEntries(), nretry = 0;
+  for(unsigned long i = 0; i < nadd; i++)
+	nretry += AtomicAdd(evtBuf.GetCopyNo(i),static_cast<T>(evtBuf.GetValue(i)));
+  Count(nadd,nretry);
+}
+
+template <class T>
+G4double VHDSharedAtomicTally<T>::Get(G4long copyNo) const
+{
+  if(copyNo < 0 || copyNo >= fSize) return 0.;
+  return static_cast<G4double>(fData[fLayout.ToStorage(copyNo)].load(std::memory_order_relaxed));
+}
+
+template <class T>
+void VHDSharedAtomicTally<T>::Merge(const VHDVTally& other)
+{
+  if(&other == this) return;  //the worker runs add directly into the master's tally
+  std::vector<G4long> copyNo;
+  std::vector<G4double> val;
+  other.GetEntries(copyNo,val);
+  for(size_t i = 0; i < copyNo.size(); i++) Add(copyNo[i],val[i]);
+}
+
+template <class T>
+void VHDSharedAtomicTally<T>::GetEntries(std::vector<G4long>& copyNo, std::vector<G4double>& val) const
+{
+  copyNo.clear();
+  val.clear();
+  for(G4long i = 0; i < fSize; i++)
+  {
+	T v = fData[fLayout.ToStorage(i)].load(std::memory_order_relaxed);
+	if(v != 0)
+	{
+		copyNo.push_back(i);
+		val.push_back(static_cast<G4double>(v));
+	}
+  }
+}
+
+template <class T>
+void VHDSharedAtomicTally<T>::Reset()
+{
+  for(G4long i = 0; i < fSize; i++) fData[fLayout.ToStorage(i)].store(0,std::memory_order_relaxed);
+  for(G4int i = 0; i < fNBlock; i++) fBlockRetry[i].store(0,std::memory_order_relaxed);
+  for(G4int i = 0; i < fNCounter; i++) fCounter[i].nadd = fCounter[i].nretry = 0;
+}
+
+namespace {
+  struct RetryGreater {
+    const std::vector<unsigned long>* retry;
+    G4bool operator()(G4int a, G4int b) const {return (*retry)[a] > (*retry)[b];}
+  };
+}
+
+template <class T>
+void VHDSharedAtomicTally<T>::Describe() const
+{
+  G4cout << "++ " << fName << ": shared atomic tally of " << fSize << " voxels ("
+	 << fLayout.GetStorageSize()*sizeof(T)/(1024.*1024.) << " MB)" << G4endl;
+}
+
+template <class T>
+void VHDSharedAtomicTally<T>::Report() const
+{
+  //the workers are done: their counters are read without synchronisation
+  unsigned long nadd = 0, nretry = 0;
+  for(G4int i = 0; i < fNCounter; i++)
+  {
+	nadd += fCounter[i].nadd;
+	nretry += fCounter[i].nretry;
+  }
+  G4cout << "  " << fName << ": " << nadd << " atomic adds, " << nretry << " retries";
+  if(nadd > 0) G4cout << " (" << 100.*nretry/nadd << " %)";
+  G4cout << G4endl;
+  VHDNumaUtil::PrintPageNodes(fName,fData,fLayout.GetStorageSize()*sizeof(std::atomic<T>));
+  if(nretry == 0) return;
+
+  //hottest blocks of copy numbers
+  std::vector<unsigned long> retry(fNBlock);
+  std::vector<G4int> order(fNBlock);
+  for(G4int i = 0; i < fNBlock; i++)
+  {
+	retry[i] = fBlockRetry[i].load(std::memory_order_relaxed);
+	order[i] = i;
+  }
+  G4int ntop = std::min(3,fNBlock);
+  RetryGreater cmp;
+  cmp.retry = &retry;
+  std::partial_sort(order.begin(),order.begin()+ntop,order.end(),cmp);
+  G4cout << "    hottest copy no. blocks:";
+  for(G4int i = 0; i < ntop && retry[order[i]] > 0; i++)
+	G4cout << " [" << static_cast<G4long>(order[i])*BlockSize << "," << std::min((order[i]+1)*static_cast<G4long>(BlockSize),fSize)-1 << "] " << retry[order[i]];
+  G4cout << G4endl;
+}
+
+template class VHDSharedAtomicTally<G4double>;
+template class VHDSharedAtomicTally<G4float>;
+
+#endif
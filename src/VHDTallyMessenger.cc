@@ -0,0 +1,242 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+/**
+ * @file   VHDTallyMessenger.cc
+ * @brief  define the messenger for the run store (tally backend) of the scored quantities
+ *
+ * @name   Geant4.9.6-p02
+ */
+
+#include "VHDTallyMessenger.hh"
+#include "VHDMultiSDRunAction.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithAnInteger.hh"
+#include "G4UIcmdWithABool.hh"
+#include "VHDTallyReducer.hh"
+#include "VHDEventBuffer.hh"
+#include "VHDMixedTally.hh"
+#include "VHDVoxelLayout.hh"
+#include "VHDPerfCounter.hh"
+#include "VHDHashTally.hh"
+#include "VHDRoiTally.hh"
+#include "VHDLogTally.hh"
+#include "VHDCacheTally.hh"
+#include "VHDDenseTally.hh"
+
+
+VHDTallyMessenger::VHDTallyMessenger(VHDMultiSDRunAction* pRun)
+:pRunAction(pRun)
+{
+  tallyDir = new G4UIdirectory("/VHDMSDv1/tally/");
+  tallyDir->SetGuidance("tally commands");
+
+  backendCmd = new G4UIcmdWithAString("/VHDMSDv1/tally/backend",this);
+  backendCmd->SetGuidance("Run store of the scored quantities for the next runs:");
+  backendCmd->SetGuidance("  replica     : one G4THitsMap per thread, merged at the end of the run (default)");
+  backendCmd->SetGuidance("  atomic      : one dense double grid shared by all the threads, atomic adds (MT)");
+  backendCmd->SetGuidance("  atomicFloat : same in single precision, half the memory (MT)");
+  backendCmd->SetGuidance("  brick       : 8x8x8 voxel bricks per thread allocated on first touch, memory follows the region hit");
+  backendCmd->SetParameterName("backend",false);
+  backendCmd->SetCandidates("replica atomic atomicFloat brick");
+  backendCmd->AvailableForStates(G4State_PreInit,G4State_Idle);
+  backendCmd->SetToBeBroadcasted(false);
+
+  reductionCmd = new G4UIcmdWithAString("/VHDMSDv1/tally/reduction",this);
+  reductionCmd->SetGuidance("Reduction of the replica tallies of the worker threads / forked shards for the next runs:");
+  reductionCmd->SetGuidance("  ordered : exact two-bin sums added up in a fixed pairwise tree ordered by thread/shard ID,");
+  reductionCmd->SetGuidance("            bit-identical for any number of threads/shards with /VHDMSDv1/random/engine philox");
+  reductionCmd->SetGuidance("  arrival : plain sums added into the master run as the workers complete (default)");
+  reductionCmd->SetParameterName("reduction",false);
+  reductionCmd->SetCandidates("ordered arrival");
+  reductionCmd->AvailableForStates(G4State_PreInit,G4State_Idle);
+  reductionCmd->SetToBeBroadcasted(false);
+
+  reductionBlockCmd = new G4UIcmdWithAnInteger("/VHDMSDv1/tally/reductionBlock",this);
+  reductionBlockCmd->SetGuidance("Number of voxels per block of the ordered reduction (blocks are reduced in parallel).");
+  reductionBlockCmd->SetParameterName("nVoxels",false);
+  reductionBlockCmd->SetRange("nVoxels>0");
+  reductionBlockCmd->AvailableForStates(G4State_PreInit,G4State_Idle);
+  reductionBlockCmd->SetToBeBroadcasted(false);
+
+  eventPoolCmd = new G4UIcmdWithABool("/VHDMSDv1/tally/eventPool",this);
+  eventPoolCmd->SetGuidance("Score the events into reusable buffers allocated once per run (default true),");
+  eventPoolCmd->SetGuidance("or into a new G4THitsMap per scorer and event (false), for the next runs.");
+  eventPoolCmd->SetParameterName("pooled",false);
+  eventPoolCmd->AvailableForStates(G4State_PreInit,G4State_Idle);
+  eventPoolCmd->SetToBeBroadcasted(false);
+
+  precisionCmd = new G4UIcmdWithAString("/VHDMSDv1/tally/precision",this);
+  precisionCmd->SetGuidance("Storage of the dense tallies (energy deposit, fused cell flux) for the next runs:");
+  precisionCmd->SetGuidance("  double : double sums, with a double compensation with the ordered reduction (default)");
+  precisionCmd->SetGuidance("  mixed  : float sum + float compensation per voxel (8 bytes): half the memory with the ordered reduction,");
+  precisionCmd->SetGuidance("           the same as the double sums with the arrival reduction");
+  precisionCmd->SetParameterName("precision",false);
+  precisionCmd->SetCandidates("double mixed");
+  precisionCmd->AvailableForStates(G4State_PreInit,G4State_Idle);
+  precisionCmd->SetToBeBroadcasted(false);
+
+  precisionCheckCmd = new G4UIcmdWithABool("/VHDMSDv1/tally/precisionCheck",this);
+  precisionCheckCmd->SetGuidance("With the mixed precision, also fill a double shadow of every voxel and print the");
+  precisionCheckCmd->SetGuidance("deviation of the float tallies from it at the end of the run (reference runs only).");
+  precisionCheckCmd->SetParameterName("check",false);
+  precisionCheckCmd->AvailableForStates(G4State_PreInit,G4State_Idle);
+  precisionCheckCmd->SetToBeBroadcasted(false);
+
+  layoutCmd = new G4UIcmdWithAString("/VHDMSDv1/tally/layout",this);
+  layoutCmd->SetGuidance("Memory order of the dense tallies for the next runs (the output is always in linear order):");
+  layoutCmd->SetGuidance("  linear : ix + iy*nx + iz*nx*ny (default)");
+  layoutCmd->SetGuidance("  morton : Z-order of (ix,iy,iz), neighbouring voxels in all three axes close in memory");
+  layoutCmd->SetParameterName("layout",false);
+  layoutCmd->SetCandidates("linear morton");
+  layoutCmd->AvailableForStates(G4State_PreInit,G4State_Idle);
+  layoutCmd->SetToBeBroadcasted(false);
+
+  cacheMissCmd = new G4UIcmdWithABool("/VHDMSDv1/tally/countCacheMisses",this);
+  cacheMissCmd->SetGuidance("Count the cache misses of the event loop of every thread (Linux perf counters)");
+  cacheMissCmd->SetGuidance("and print them at the end of the next runs, to compare the tally layouts.");
+  cacheMissCmd->SetParameterName("count",false);
+  cacheMissCmd->AvailableForStates(G4State_PreInit,G4State_Idle);
+  cacheMissCmd->SetToBeBroadcasted(false);
+
+  hashCmd = new G4UIcmdWithAString("/VHDMSDv1/tally/hashQuantities",this);
+  hashCmd->SetGuidance("Scored quantities kept in a sparse open-addressing hash table per thread for the next runs,");
+  hashCmd->SetGuidance("for grids too large for the dense arrays (e.g. \"CellFlux\", \"totalEDep CellFlux\").");
+  hashCmd->SetGuidance("A collection is hashed if its name contains one of the names; none (default) for no quantity.");
+  hashCmd->SetParameterName("names",false);
+  hashCmd->AvailableForStates(G4State_PreInit,G4State_Idle);
+  hashCmd->SetToBeBroadcasted(false);
+
+  denseLimitCmd = new G4UIcmdWithAnInteger("/VHDMSDv1/tally/denseLimit",this);
+  denseLimitCmd->SetGuidance("Memory [MB] of the dense tallies of one scored quantity over all the threads (default 4096,");
+  denseLimitCmd->SetGuidance("0: no limit); a quantity above it is kept in a hash table per thread instead (next runs).");
+  denseLimitCmd->SetParameterName("MB",false);
+  denseLimitCmd->SetRange("MB>=0");
+  denseLimitCmd->AvailableForStates(G4State_PreInit,G4State_Idle);
+  denseLimitCmd->SetToBeBroadcasted(false);
+
+  roiCmd = new G4UIcmdWithABool("/VHDMSDv1/tally/roiFluence",this);
+  roiCmd->SetGuidance("Size the cell flux tallies of the next runs by the voxels of the materials of interest (ROI)");
+  roiCmd->SetGuidance("and write the fluence of these voxels only (roiVoxels.raw, pCellFluxNN/fluenceROI.raw).");
+  roiCmd->SetParameterName("roi",false);
+  roiCmd->AvailableForStates(G4State_PreInit,G4State_Idle);
+  roiCmd->SetToBeBroadcasted(false);
+
+  depositLogCmd = new G4UIcmdWithABool("/VHDMSDv1/tally/depositLog",this);
+  depositLogCmd->SetGuidance("Append every deposit to a log of (voxel, bin, value) records per thread, radix sort it");
+  depositLogCmd->SetGuidance("and add it into the run tallies once per batch of events, with the sum of squares");
+  depositLogCmd->SetGuidance("of the event sums, instead of adding every step into the tallies (next runs).");
+  depositLogCmd->SetParameterName("log",false);
+  depositLogCmd->AvailableForStates(G4State_PreInit,G4State_Idle);
+  depositLogCmd->SetToBeBroadcasted(false);
+
+  logBatchCmd = new G4UIcmdWithAnInteger("/VHDMSDv1/tally/logBatch",this);
+  logBatchCmd->SetGuidance("Number of events per batch of the deposit log (default 64, at most 65535).");
+  logBatchCmd->SetParameterName("nEvents",false);
+  logBatchCmd->SetRange("nEvents>0 && nEvents<65536");
+  logBatchCmd->AvailableForStates(G4State_PreInit,G4State_Idle);
+  logBatchCmd->SetToBeBroadcasted(false);
+
+  writeCacheCmd = new G4UIcmdWithAnInteger("/VHDMSDv1/tally/writeCache",this);
+  writeCacheCmd->SetGuidance("Slots of the per-thread direct-mapped write-combining cache put in front of every run tally");
+  writeCacheCmd->SetGuidance("(rounded up to a power of 2; flushed at the end of every event; 0: no cache; next runs).");
+  writeCacheCmd->SetParameterName("nSlots",false);
+  writeCacheCmd->SetRange("nSlots>=0");
+  writeCacheCmd->AvailableForStates(G4State_PreInit,G4State_Idle);
+  writeCacheCmd->SetToBeBroadcasted(false);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+VHDTallyMessenger::~VHDTallyMessenger()
+{
+  delete backendCmd;
+  delete reductionCmd;
+  delete reductionBlockCmd;
+  delete eventPoolCmd;
+  delete precisionCmd;
+  delete precisionCheckCmd;
+  delete layoutCmd;
+  delete cacheMissCmd;
+  delete hashCmd;
+  delete denseLimitCmd;
+  delete roiCmd;
+  delete depositLogCmd;
+  delete logBatchCmd;
+  delete writeCacheCmd;
+  delete tallyDir;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void VHDTallyMessenger::SetNewValue(G4UIcommand* command, G4String newValue)
+{
+  if( command == backendCmd )
+  {
+	G4cout << "tally backend: " << newValue << G4endl;
+	pRunAction->SetTallyBackend(newValue);
+  }
+
+  if( command == reductionCmd )
+	VHDTallyReducer::SetOrdered(newValue == "ordered");
+
+  if( command == reductionBlockCmd )
+	VHDTallyReducer::SetBlockSize(reductionBlockCmd->GetNewIntValue(newValue));
+
+  if( command == eventPoolCmd )
+	VHDEventBuffer::SetPooled(eventPoolCmd->GetNewBoolValue(newValue));
+
+  if( command == precisionCmd )
+	VHDMixedTally::SetMixed(newValue == "mixed");
+
+  if( command == precisionCheckCmd )
+	VHDMixedTally::SetCheck(precisionCheckCmd->GetNewBoolValue(newValue));
+
+  if( command == layoutCmd )
+	VHDVoxelLayout::SetMorton(newValue == "morton");
+
+  if( command == cacheMissCmd )
+	VHDPerfCounter::SetEnabled(cacheMissCmd->GetNewBoolValue(newValue));
+
+  if( command == hashCmd )
+	VHDHashTally::SetQuantities(newValue);
+
+  if( command == denseLimitCmd )
+	VHDDenseTally::SetMemoryLimit(denseLimitCmd->GetNewIntValue(newValue));
+
+  if( command == roiCmd )
+	VHDRoiTally::SetEnabled(roiCmd->GetNewBoolValue(newValue));
+
+  if( command == depositLogCmd )
+	VHDLogTally::SetEnabled(depositLogCmd->GetNewBoolValue(newValue));
+
+  if( command == logBatchCmd )
+	VHDLogTally::SetBatchSize(logBatchCmd->GetNewIntValue(newValue));
+
+  if( command == writeCacheCmd )
+	VHDCacheTally::SetSize(writeCacheCmd->GetNewIntValue(newValue));
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,183 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+
+/**
+ * @file   VHDTallyReducer.cc
+ * @brief  deterministic pairwise-tree reduction of the partial tallies of the worker threads / forked shards
+ *
+ * @name   Geant4.9.6-p02
+ */
+
+#include "VHDTallyReducer.hh"
+#include <algorithm>
+#ifdef G4MULTITHREADED
+#include <thread>
+#endif
+
+G4bool VHDTallyReducer::sOrdered = false;
+G4int VHDTallyReducer::sBlockSize = 4096;
+
+VHDTallyReducer::VHDTallyReducer()
+{;}
+
+VHDTallyReducer::~VHDTallyReducer()
+{
+  Clear();
+}
+
+void VHDTallyReducer::AddPartial(G4int order, std::vector<G4long>& copyNo, std::vector<G4double>& sum, std::vector<G4double>& comp)
+{
+  Partial* p = new Partial;
+  p->order = order;
+  p->copyNo.swap(copyNo);
+  p->sum.swap(sum);
+  p->comp.swap(comp);
+  fPartials.push_back(p);
+}
+
+void VHDTallyReducer::Clear()
+{
+  for(size_t i = 0; i < fPartials.size(); i++) delete fPartials[i];
+  fPartials.clear();
+}
+
+//  The partials are sorted by order (thread/shard ID) and the copy numbers are cut in blocks; only the
+//  blocks holding an entry of some partial are listed. Listed block i is reduced by thread i % nThreads
+//  into its own output, and the outputs are concatenated in block order: neither the tree nor the result
+//  depend on the scheduling.
+void VHDTallyReducer::Reduce(std::vector<G4long>& copyNo, std::vector<G4double>& sum, std::vector<G4double>& comp, G4int nThreads)
+{
+  copyNo.clear();
+  sum.clear();
+  comp.clear();
+  if( fPartials.empty() ) return;
+  std::stable_sort(fPartials.begin(),fPartials.end(),LessOrder);
+
+  std::vector<G4long> blocks;
+  for(size_t i = 0; i < fPartials.size(); i++)
+  {
+	const std::vector<G4long>& c = fPartials[i]->copyNo;
+	for(size_t j = 0; j < c.size(); j++)
+	{
+		G4long b = c[j]/sBlockSize;
+		if( blocks.empty() || blocks.back() != b ) blocks.push_back(b);
+	}
+  }
+  std::sort(blocks.begin(),blocks.end());
+  blocks.erase(std::unique(blocks.begin(),blocks.end()),blocks.end());
+  if( blocks.empty() ) { Clear(); return; }
+
+  G4int nBlock = blocks.size();
+  if( nThreads > nBlock ) nThreads = nBlock;
+  if( nThreads < 1 ) nThreads = 1;
+  std::vector<Block> out(nBlock);
+#ifdef G4MULTITHREADED
+  std::vector<std::thread> pool;
+  for(G4int t = 1; t < nThreads; t++)
+	pool.push_back(std::thread(&VHDTallyReducer::ReduceBlocks,this,t,nThreads,&blocks,&out));
+  ReduceBlocks(0,nThreads,&blocks,&out);
+  for(size_t t = 0; t < pool.size(); t++) pool[t].join();
+#else
+  ReduceBlocks(0,1,&blocks,&out);
+#endif
+
+  size_t n = 0;
+  for(G4int b = 0; b < nBlock; b++) n += out[b].copyNo.size();
+  copyNo.reserve(n);
+  sum.reserve(n);
+  comp.reserve(n);
+  for(G4int b = 0; b < nBlock; b++)
+  {
+	copyNo.insert(copyNo.end(),out[b].copyNo.begin(),out[b].copyNo.end());
+	sum.insert(sum.end(),out[b].sum.begin(),out[b].sum.end());
+	comp.insert(comp.end(),out[b].comp.begin(),out[b].comp.end());
+  }
+  Clear();
+}
+
+//  Reduce listed blocks ithread, ithread + nThreads, ... : scatter the entries of every partial into a
+//  [partial][copy number] scratch, then add partial p+stride into p for stride = 1, 2, 4, ..., over the
+//  copy numbers hit only; the slots set are zeroed again afterwards (the scratch is never cleared whole).
+//  The blocks of a thread are increasing, so each partial is walked once from a cursor.
+void VHDTallyReducer::ReduceBlocks(G4int ithread, G4int nThreads, const std::vector<G4long>* blocks, std::vector<Block>* out) const
+{
+  G4int nPart = fPartials.size();
+  G4int nBlock = blocks->size();
+  std::vector<G4double> s(nPart*sBlockSize,0.), c(nPart*sBlockSize,0.);
+  std::vector<char> hit(sBlockSize,0);
+  std::vector<G4int> used;
+  std::vector<size_t> cursor(nPart,0);
+
+  for(G4int ib = ithread; ib < nBlock; ib += nThreads)
+  {
+	G4long first = (*blocks)[ib]*sBlockSize, last = first + sBlockSize;
+	used.clear();
+	for(G4int p = 0; p < nPart; p++)
+	{
+		const Partial* part = fPartials[p];
+		size_t j = std::lower_bound(part->copyNo.begin() + cursor[p],part->copyNo.end(),first) - part->copyNo.begin();
+		for(; j < part->copyNo.size() && part->copyNo[j] < last; j++)
+		{
+			G4int k = static_cast<G4int>(part->copyNo[j] - first);
+			s[p*sBlockSize+k] = part->sum[j];
+			c[p*sBlockSize+k] = part->comp[j];
+			if( !hit[k] ) { hit[k] = 1; used.push_back(k); }
+		}
+		cursor[p] = j;
+	}
+	std::sort(used.begin(),used.end());
+	G4int nUsed = used.size();
+	for(G4int stride = 1; stride < nPart; stride *= 2)
+	{
+		for(G4int p = 0; p + stride < nPart; p += 2*stride)
+		{
+			G4double* s0 = &s[p*sBlockSize];
+			G4double* c0 = &c[p*sBlockSize];
+			G4double* s1 = &s[(p+stride)*sBlockSize];
+			G4double* c1 = &c[(p+stride)*sBlockSize];
+			for(G4int u = 0; u < nUsed; u++)
+			{
+				G4int k = used[u];
+				Add(s0[k],c0[k],s1[k]);
+				Add(s0[k],c0[k],c1[k]);
+				s1[k] = c1[k] = 0.;
+			}
+		}
+	}
+	Block& blk = (*out)[ib];
+	blk.copyNo.reserve(nUsed);
+	blk.sum.reserve(nUsed);
+	blk.comp.reserve(nUsed);
+	for(G4int u = 0; u < nUsed; u++)
+	{
+		G4int k = used[u];
+		blk.copyNo.push_back(first + k);
+		blk.sum.push_back(s[k]);
+		blk.comp.push_back(c[k]);
+		s[k] = c[k] = 0.;
+		hit[k] = 0;
+	}
+  }
+}
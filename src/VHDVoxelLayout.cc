@@ -0,0 +1,82 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+
+/**
+ * @file   VHDVoxelLayout.cc
+ * @brief  storage order (linear or Morton/Z-order) of the dense voxel tallies
+ *
+ * @name   Geant4.9.6-p02
+ */
+
+#include "VHDVoxelLayout.hh"
+
+G4bool VHDVoxelLayout::sMorton = false;
+
+VHDVoxelLayout::VHDVoxelLayout(G4long nVoxels)
+  : fMorton(false), fNx(1), fNy(1), fNz(1), fNBins(1), fStorage(nVoxels)
+{
+  fPad[0] = fPad[1] = fPad[2] = 1;
+}
+
+VHDVoxelLayout::VHDVoxelLayout(G4int nx, G4int ny, G4int nz, G4int nBins, G4bool morton)
+  : fMorton(morton), fNx(nx), fNy(ny), fNz(nz), fNBins(nBins)
+{
+  fPad[0] = nx;
+  fPad[1] = ny;
+  fPad[2] = nz;
+  fStorage = static_cast<G4long>(nx)*ny*nz*nBins;
+  if(!fMorton) return;
+
+  //number of bits of each axis (padded to a power of two)
+  G4int n[3] = {nx,ny,nz};
+  G4int bits[3] = {0,0,0};
+  for(G4int a = 0; a < 3; a++)
+	while((1 << bits[a]) < n[a]) bits[a]++;
+
+  //interleave the bits x0 y0 z0 x1 y1 z1 ...; an axis that runs out of bits leaves its turn to the others
+  std::vector<G4int> pos[3];
+  G4int p = 0;
+  for(G4int b = 0; b < 32; b++)
+	for(G4int a = 0; a < 3; a++)
+		if(b < bits[a]) pos[a].push_back(p++);
+
+  std::vector<G4long>* table[3] = {&fX,&fY,&fZ};
+  for(G4int a = 0; a < 3; a++)
+  {
+	table[a]->assign(n[a],0);
+	for(G4int i = 0; i < n[a]; i++)
+		for(G4int b = 0; b < bits[a]; b++)
+			if((i >> b) & 1) (*table[a])[i] |= (1L << pos[a][b]);
+  }
+  fStorage = (1L << p)*nBins;
+  for(G4int a = 0; a < 3; a++) fPad[a] = 1 << bits[a];
+}
+
+void VHDVoxelLayout::Print() const
+{
+  if(!fMorton) return;
+  G4cout << "Morton layout: " << fNx << " x " << fNy << " x " << fNz << " voxels padded to "
+	 << fPad[0] << " x " << fPad[1] << " x " << fPad[2] << G4endl;
+}
@@ -0,0 +1,85 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+
+/**
+ * @file   VHDVoxelSD.cc
+ * @brief  fused voxel sensitive detector scoring the energy deposit and the energy-binned cell flux in one pass
+ *
+ * @name   Geant4.9.6-p02
+ */
+
+#include "VHDVoxelSD.hh"
+#include "VHDVoxelTable.hh"
+#include "G4Step.hh"
+#include "G4Track.hh"
+#include "G4Material.hh"
+#include "G4VTouchable.hh"
+#include "G4Electron.hh"
+#include "G4Gamma.hh"
+#include <algorithm>
+
+VHDVoxelSD::VHDVoxelSD(const G4String& name, G4int nx, G4int ny, G4int nz, G4bool nested)
+  : G4VSensitiveDetector(name), fNx(nx), fNy(ny), fNz(nz), fNested(nested), fNestedIndex(nx,ny,nz), fTable(0),
+    fElectron(0), fPhoton(0), fEdepTally(0), fFluxTally(0)
+{;}
+
+VHDVoxelSD::~VHDVoxelSD()
+{
+  G4cout << "destroying VHDVoxelSD..." << G4endl;
+}
+
+void VHDVoxelSD::SetParticles(G4bool electron, G4bool photon)
+{
+  fElectron = electron ? G4Electron::Definition() : 0;
+  fPhoton = photon ? G4Gamma::Definition() : 0;
+}
+
+G4int VHDVoxelSD::GetIndex(G4Step* aStep) const
+{
+  const G4VTouchable* touchable = aStep->GetPreStepPoint()->GetTouchable();
+  return fNested ? fNestedIndex(touchable) : fRegularIndex(touchable);
+}
+
+G4bool VHDVoxelSD::ProcessHits(G4Step* aStep,G4TouchableHistory*)
+{
+  G4double edep = aStep->GetTotalEnergyDeposit();
+  G4double steplen = aStep->GetStepLength();
+  if(edep == 0. && steplen == 0.) return FALSE;
+
+  G4StepPoint* preStep = aStep->GetPreStepPoint();
+  G4int index = GetIndex(aStep);
+  if(edep != 0. && fEdepTally) fEdepTally->Add(index,edep*preStep->GetWeight());
+
+  //--- cell flux (unweighted) of the scored particles in the organs of interest
+  if(steplen == 0. || !fFluxTally || !fTable) return TRUE;
+  const G4ParticleDefinition* particle = aStep->GetTrack()->GetDefinition();
+  if(particle != fElectron && particle != fPhoton) return TRUE;
+  if(!fTable->IsOfInterest(index)) return TRUE;
+  std::vector<G4double>::const_iterator itr = std::upper_bound(fEdges.begin(),fEdges.end(),preStep->GetKineticEnergy());
+  if(itr == fEdges.end()) return TRUE;
+  G4int nBins = fEdges.size();
+  fFluxTally->Add(static_cast<G4long>(index)*nBins + (itr - fEdges.begin()),steplen/fTable->GetVoxelVolume());
+  return TRUE;
+}
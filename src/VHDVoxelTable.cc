@@ -0,0 +1,120 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+
+/**
+ * @file   VHDVoxelTable.cc
+ * @brief  per-voxel scoring metadata (voxel volume, mass, organ of interest, organ) built once per geometry
+ *
+ * @name   Geant4.9.6-p02
+ */
+
+#include "VHDVoxelTable.hh"
+#include "VHDVTally.hh"
+#include "G4Material.hh"
+#include "G4SystemOfUnits.hh"
+
+VHDVoxelTable::VHDVoxelTable(G4int nx, G4int ny, G4int nz, G4double voxelVolume, const VHDMaterialIndices* mateIDs,
+			     const std::vector<G4Material*>& materials, const std::map<unsigned int,unsigned int>& organtag2MatIndx,
+			     const std::vector<unsigned int>& labelsOfInterest, const VHDRunLengthLabels* runs)
+  : fNVoxels(nx*ny*nz), fVoxelVolume(voxelVolume), fMateIDs(mateIDs), fRuns(runs)
+{
+  size_t nmat = materials.size();
+  fDensity.resize(nmat);
+  fMass.resize(nmat);
+  fOrganID.assign(nmat,-1);
+  for(size_t i = 0; i < nmat; i++)
+  {
+	fDensity[i] = materials[i]->GetDensity();
+	fMass[i] = fDensity[i]*fVoxelVolume;
+  }
+  std::map<unsigned int,unsigned int>::const_iterator itr = organtag2MatIndx.begin();
+  for(; itr != organtag2MatIndx.end(); itr++)
+	if(itr->second < nmat) fOrganID[itr->second] = itr->first;
+
+  //mass of every organ label: voxel mass x number of voxels
+  fLabelMass.assign(nmat,0.);
+  for(G4int i = 0; i < fNVoxels; i++)
+  {
+	G4int label = GetLabel(i);
+	fLabelMass[label] += fMass[label];
+  }
+
+  fOfInterest.assign(nmat,0);
+  for(size_t i = 0; i < labelsOfInterest.size(); i++)
+	if(labelsOfInterest[i] < nmat) fOfInterest[labelsOfInterest[i]] = 1;
+
+  G4cout << "voxel table: " << fNVoxels << " voxels of " << fVoxelVolume/mm3 << " mm3, "
+	 << nmat << " organ labels, " << labelsOfInterest.size() << " of interest" << G4endl;
+}
+
+//  ROI: the voxels of an organ of interest (4 bytes per voxel, only for the ROI-sized fluence).
+void VHDVoxelTable::BuildRoi() const
+{
+  if(!fRoiIndex.empty()) return;
+  fRoiIndex.assign(fNVoxels,-1);
+  for(G4int i = 0; i < fNVoxels; i++)
+  {
+	if(!IsOfInterest(i)) continue;
+	fRoiIndex[i] = fRoiVoxel.size();
+	fRoiVoxel.push_back(i);
+  }
+  G4cout << "voxel table: " << fRoiVoxel.size() << " ROI voxels" << G4endl;
+}
+
+VHDVoxelTable::~VHDVoxelTable()
+{;}
+
+void VHDVoxelTable::PrintOrganDose(const VHDVTally* edep, G4int nEvent) const
+{
+  if(!edep) return;
+  //energy per organ label over the voxels hit; several labels may share an organ tag
+  std::vector<G4long> copyNo;
+  std::vector<G4double> val;
+  edep->GetEntries(copyNo,val);
+  std::vector<G4double> labelEdep(fLabelMass.size(),0.);
+  for(size_t i = 0; i < copyNo.size(); i++)
+	if(copyNo[i] < fNVoxels) labelEdep[GetLabel(static_cast<G4int>(copyNo[i]))] += val[i];
+
+  std::map<G4int,G4double> organEdep, organMass;
+  for(size_t l = 0; l < labelEdep.size(); l++)
+  {
+	if(labelEdep[l] == 0.) continue;
+	organEdep[fOrganID[l]] += labelEdep[l];
+  }
+  for(size_t l = 0; l < fLabelMass.size(); l++)
+	if(organEdep.count(fOrganID[l])) organMass[fOrganID[l]] += fLabelMass[l];
+
+  G4cout << "=== Absorbed dose per organ (" << nEvent << " events) ===" << G4endl;
+  std::map<G4int,G4double>::iterator itr = organEdep.begin();
+  for(; itr != organEdep.end(); itr++)
+  {
+	G4double mass = organMass[itr->first];
+	if(mass <= 0.) continue;
+	G4double dose = itr->second/mass;
+	G4cout << "  organ " << itr->first << ": mass " << mass/kg << " kg, dose " << dose/gray << " Gy";
+	if(nEvent > 0) G4cout << ", " << dose/gray/nEvent << " Gy/event";
+	G4cout << G4endl;
+  }
+}
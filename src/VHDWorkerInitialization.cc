@@ -23,27 +23,30 @@
 // * acceptance of all terms of the Geant4 Software license.          *
 // ********************************************************************
 /**
- * @file   VHDPSEnergyDeposit_RegParam.cc
- * @brief  energy deposit scorer defition
+ * @file   VHDWorkerInitialization.cc
+ * @brief  per-worker hooks: NUMA pinning of the worker threads
  *
- * @date   15th Oct 2013
- * @author Shih-ying Huang
- * @name   Geant4.9.6-p02
+ * @name   Geant4.10.x (G4MULTITHREADED)
  */
 
-#include "VHDPSEnergyDeposit_RegParam.hh"
+#ifdef G4MULTITHREADED
 
+#include "VHDWorkerInitialization.hh"
+#include "VHDNumaUtil.hh"
+#include "G4Threading.hh"
 
-VHDPSEnergyDeposit_RegParam::VHDPSEnergyDeposit_RegParam(G4String name,G4int nx, G4int ny, G4int nz)
-  :G4PSEnergyDeposit(name),fNx(nx),fNy(ny),fNz(nz)
-{
-	fNxNy = fNx*fNy;
+VHDWorkerInitialization::VHDWorkerInitialization()
+  : G4UserWorkerInitialization()
+{;
+}
+
+VHDWorkerInitialization::~VHDWorkerInitialization()
+{;
 }
 
-VHDPSEnergyDeposit_RegParam::~VHDPSEnergyDeposit_RegParam()
+void VHDWorkerInitialization::WorkerInitialize() const
 {
-	if(filter){  //'filter' is a private variable that is definied in G4VPrimitiveScorer
-		delete filter;  //delete it if it's defined
-	}
-	G4cout << "destroying VHDPSEnergyDeposit_RegParam..." << G4endl;
+  VHDNumaUtil::PinThisThread(G4Threading::G4GetThreadId());
 }
+
+#endif
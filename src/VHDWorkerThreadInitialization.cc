@@ -23,38 +23,33 @@
 // * acceptance of all terms of the Geant4 Software license.          *
 // ********************************************************************
 /**
- * @file   VHDMSDCellFlux.cc
- * @brief  score cell flux similar to G4PSCellFlux class with modification of ProcessHits(...)
+ * @file   VHDWorkerThreadInitialization.cc
+ * @brief  create the random engine of each worker thread in multi-threaded mode
  *
- * @date   7th Aug 2013
- * @author Shih-ying Huang
- * @name   Geant4.9.6-p02
+ * @name   Geant4.10.x (G4MULTITHREADED)
  */
 
-#include "VHDMSDNofStep.hh"
+#ifdef G4MULTITHREADED
 
-VHDMSDNofStep::VHDMSDNofStep(G4String name,G4int nx, G4int ny, G4int nz)
-  :G4PSNofStep(name),fNx(nx),fNy(ny),fNz(nz)
-{
-	SetUnit("");
-	fNxNy = fNx*fNy;
+#include "VHDWorkerThreadInitialization.hh"
+#include "VHDPhiloxEngine.hh"
+#include "Randomize.hh"
+
+VHDWorkerThreadInitialization::VHDWorkerThreadInitialization()
+  : G4UserWorkerThreadInitialization()
+{;
 }
 
-VHDMSDNofStep::~VHDMSDNofStep()
-{
-	if(filter){  //'filter' is a private variable that is definied in G4VPrimitiveScorer
-		delete filter;  //delete it if it's defined
-	}
-	G4cout << "destroying VHDMSDNofStep..." << G4endl;
+VHDWorkerThreadInitialization::~VHDWorkerThreadInitialization()
+{;
 }
 
-G4int VHDMSDNofStep::GetIndex(G4Step* aStep)
+void VHDWorkerThreadInitialization::SetupRNGEngine(const CLHEP::HepRandomEngine* aRNGEngine) const
 {
-  const G4VTouchable* touchable = aStep->GetPreStepPoint()->GetTouchable();
-  G4int ix = touchable->GetReplicaNumber(1);
-  G4int iy = touchable->GetReplicaNumber(2);
-  G4int iz = touchable->GetReplicaNumber(0);
-
-  return ix + iy*fNx + iz*fNxNy;
+  if(dynamic_cast<const VHDPhiloxEngine*>(aRNGEngine))
+	CLHEP::HepRandom::setTheEngine(new VHDPhiloxEngine);  //keyed event by event in VHDPrimaryGeneratorAction::GeneratePrimaries
+  else
+	G4UserWorkerThreadInitialization::SetupRNGEngine(aRNGEngine);
+}
 
-}
\ No newline at end of file
+#endif